@@ -77,6 +77,21 @@ gv_get_app_user_config_dir(void)
 	return dir;
 }
 
+const gchar *
+gv_get_app_user_cache_dir(void)
+{
+	static gchar *dir;
+
+	if (dir == NULL) {
+		const gchar *user_dir;
+
+		user_dir = g_get_user_cache_dir();
+		dir = g_build_filename(user_dir, PACKAGE_NAME, NULL);
+	}
+
+	return dir;
+}
+
 const gchar *
 gv_get_app_user_data_dir(void)
 {
@@ -27,6 +27,7 @@ gboolean gv_in_test_suite(void);
 
 GSettings *gv_get_settings(const gchar *component);
 
+const gchar *gv_get_app_user_cache_dir(void);
 const gchar *gv_get_app_user_config_dir(void);
 const gchar *gv_get_app_user_data_dir(void);
 const gchar *const *gv_get_app_system_config_dirs(void);
@@ -97,6 +97,7 @@ help_and_exit(int exit_code)
 	COMMAND("rename <station> <name>", "Rename a station");
 	COMMAND("move   <station> [[first/last] [before/after <station>]]", "");
 	DESC   ("Move a station in the list");
+	COMMAND("import <playlist>", "Add the stations of a playlist, local file or uri");
 	NL();
 
 	TITLE  ("Configuration");
@@ -332,6 +333,41 @@ parse_move_args(int argc, char *argv[], GVariantBuilder *b)
 	return 0;
 }
 
+int
+parse_list_args(int argc, char *argv[] G_GNUC_UNUSED, GVariantBuilder *b)
+{
+	const gchar *fields[] = { "name", "uri", NULL };
+
+	if (argc != 0)
+		return -1;
+
+	/* Whole list, only the fields we display */
+	g_variant_builder_add(b, "u", 0);
+	g_variant_builder_add(b, "u", 0);
+	g_variant_builder_add(b, "^as", fields);
+
+	return 0;
+}
+
+int
+parse_import_args(int argc, char *argv[], GVariantBuilder *b)
+{
+	GFile *file;
+	gchar *uri;
+
+	if (argc != 1)
+		return -1;
+
+	/* Local paths are relative to our working directory, not Goodvibes's */
+	file = g_file_new_for_commandline_arg(argv[0]);
+	uri = g_file_get_uri(file);
+	g_variant_builder_add(b, "s", uri);
+	g_free(uri);
+	g_object_unref(file);
+
+	return 0;
+}
+
 int
 parse_boolean(int argc, char *argv[], GVariantBuilder *b)
 {
@@ -477,7 +513,7 @@ print_list_result(GVariant *result)
 	GVariant *value;
 	gchar *key;
 
-	g_variant_get(result, "(aa{sv})", &iter1);
+	g_variant_get(result, "(taa{sv})", NULL, &iter1);
 
 	while (g_variant_iter_loop(iter1, "a{sv}", &iter2)) {
 		gchar *uri = NULL;
@@ -499,6 +535,16 @@ print_list_result(GVariant *result)
 	g_variant_iter_free(iter1);
 }
 
+void
+print_import_result(GVariant *result)
+{
+	guint n;
+	gdouble rate;
+
+	g_variant_get(result, "((ud))", &n, &rate);
+	print("%u stations imported (%.0f entries/s)", n, rate);
+}
+
 struct cmd root_cmds[] = {
 	{ METHOD, "quit", "Quit", NULL, NULL },
 	{ METHOD, NULL,   NULL,   NULL, NULL }
@@ -521,12 +567,13 @@ struct cmd player_cmds[] = {
 };
 
 struct cmd stations_cmds[] = {
-	{ METHOD,   "list",    "List",   NULL,              print_list_result },
-	{ METHOD,   "add",     "Add",    parse_add_args,    NULL              },
-	{ METHOD,   "remove",  "Remove", parse_remove_args, NULL              },
-	{ METHOD,   "rename",  "Rename", parse_rename_args, NULL              },
-	{ METHOD,   "move",    "Move",   parse_move_args,   NULL              },
-	{ METHOD,   NULL,      NULL,     NULL,              NULL              }
+	{ METHOD,   "list",    "List",   parse_list_args,   print_list_result   },
+	{ METHOD,   "add",     "Add",    parse_add_args,    NULL                },
+	{ METHOD,   "remove",  "Remove", parse_remove_args, NULL                },
+	{ METHOD,   "rename",  "Rename", parse_rename_args, NULL                },
+	{ METHOD,   "move",    "Move",   parse_move_args,   NULL                },
+	{ METHOD,   "import",  "Import", parse_import_args, print_import_result },
+	{ METHOD,   NULL,      NULL,     NULL,              NULL                }
 };
 
 struct interface interfaces[] = {
@@ -26,9 +26,14 @@
 #pragma once
 
 #include <gio/gio.h>
+#include <libsoup/soup.h>
+
+#include "core/gv-playlist-cache.h"
 
 /* Global variables */
 
-extern GSettings   *gv_core_settings;
+extern GSettings       *gv_core_settings;
+extern GvPlaylistCache *gv_core_playlist_cache;
+extern SoupSession     *gv_core_soup_session;
 
-extern const gchar *gv_core_user_agent;
+extern const gchar     *gv_core_user_agent;
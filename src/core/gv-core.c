@@ -21,15 +21,22 @@
 
 #include <glib.h>
 #include <gio/gio.h>
+#include <libsoup/soup.h>
 
 #include "base/gv-base.h"
 
 #include "core/gv-engine.h"
 #include "core/gv-player.h"
+#include "core/gv-playlist-cache.h"
 #include "core/gv-station-list.h"
 
 #define CORE_SCHEMA_ID_SUFFIX "Core"
 
+/* HTTP connections, in total and per host, and timeout in seconds */
+#define SOUP_MAX_CONNS          32
+#define SOUP_MAX_CONNS_PER_HOST 4
+#define SOUP_TIMEOUT            15
+
 /*
  * Public variables
  */
@@ -40,6 +47,9 @@ GSettings     *gv_core_settings;
 GvStationList *gv_core_station_list;
 GvPlayer      *gv_core_player;
 
+GvPlaylistCache *gv_core_playlist_cache;
+SoupSession     *gv_core_soup_session;
+
 gchar         *gv_core_user_agent;
 
 /*
@@ -87,6 +97,20 @@ gv_core_audio_backend_compile_version_string(void)
  * Helpers
  */
 
+static SoupSession *
+make_soup_session(void)
+{
+	/* Certificates are checked per message, as some stations are
+	 * flagged insecure, and we want a single session for all.
+	 */
+	return soup_session_new_with_options(SOUP_SESSION_SSL_STRICT, FALSE,
+	                                     SOUP_SESSION_USER_AGENT, gv_core_user_agent,
+	                                     SOUP_SESSION_MAX_CONNS, SOUP_MAX_CONNS,
+	                                     SOUP_SESSION_MAX_CONNS_PER_HOST, SOUP_MAX_CONNS_PER_HOST,
+	                                     SOUP_SESSION_TIMEOUT, SOUP_TIMEOUT,
+	                                     NULL);
+}
+
 static gchar *
 make_user_agent(void)
 {
@@ -142,6 +166,9 @@ gv_core_configure(void)
 void
 gv_core_cleanup(void)
 {
+	/* Cancel pending downloads, while core objects are still alive */
+	soup_session_abort(gv_core_soup_session);
+
 	/* Destroy core objects */
 	core_objects = g_list_reverse(core_objects);
 	g_list_free_full(core_objects, (GDestroyNotify) g_object_unref);
@@ -149,6 +176,9 @@ gv_core_cleanup(void)
 	/* Clear application pointer */
 	gv_core_application = NULL;
 
+	/* Destroy the http session */
+	g_clear_object(&gv_core_soup_session);
+
 	/* Free strings */
 	g_free(gv_core_user_agent);
 }
@@ -165,10 +195,18 @@ gv_core_init(GApplication *application, const gchar *default_stations)
 	/* Keep a pointer toward application */
 	gv_core_application = application;
 
+	/* Shared by every download, so that connections are reused */
+	gv_core_soup_session = make_soup_session();
+
 	/* Create core objects */
 	gv_core_settings = gv_get_settings(CORE_SCHEMA_ID_SUFFIX);
 	core_objects = g_list_append(core_objects, gv_core_settings);
 
+	/* Must be loaded before stations are created */
+	gv_core_playlist_cache = gv_playlist_cache_new();
+	gv_playlist_cache_load(gv_core_playlist_cache);
+	core_objects = g_list_append(core_objects, gv_core_playlist_cache);
+
 	gv_core_station_list = gv_station_list_new_from_xdg_dirs(default_stations);
 	core_objects = g_list_append(core_objects, gv_core_station_list);
 
@@ -31,6 +31,7 @@
 #include "core/gv-core-enum-types.h"
 #include "core/gv-core-internal.h"
 #include "core/gv-metadata.h"
+#include "core/gv-reconnect-scheduler.h"
 #include "core/gv-station.h"
 #include "core/gv-streaminfo.h"
 
@@ -47,6 +48,29 @@
 
 #define DEFAULT_VOLUME 100
 #define DEFAULT_MUTE   FALSE
+#define DEFAULT_STANDBY_PIPELINES 1
+#define MAX_STANDBY_PIPELINES     4
+#define DEFAULT_RACE_STREAMS      3
+#define MAX_RACE_STREAMS          5
+#define DEFAULT_BUFFER_LOW_WATERMARK  10
+#define DEFAULT_BUFFER_HIGH_WATERMARK 100
+
+/* Buffer target, in seconds. It starts small, grows on underruns, and
+ * shrinks back after a while if playback is stable.
+ */
+#define MIN_BUFFER_DURATION     1
+#define MAX_BUFFER_DURATION     16
+#define BUFFER_STABLE_PERIOD    120
+#define BUFFER_BYTES_PER_SECOND (64 * 1024)
+
+/* How long a standby pipeline is kept prerolled, in seconds. Past that,
+ * the buffered data is stale, and the server might have given up on us.
+ */
+#define STANDBY_TIMEOUT 60
+
+/* Crossfade when splicing a new pipeline, in milliseconds */
+#define CROSSFADE_DURATION 500
+#define CROSSFADE_INTERVAL 25
 
 enum {
 	/* Reserved */
@@ -60,6 +84,10 @@ enum {
 	PROP_MUTE,
 	PROP_PIPELINE_ENABLED,
 	PROP_PIPELINE_STRING,
+	PROP_STANDBY_PIPELINES,
+	PROP_RACE_STREAMS,
+	PROP_BUFFER_LOW_WATERMARK,
+	PROP_BUFFER_HIGH_WATERMARK,
 	/* Number of properties */
 	PROP_N
 };
@@ -72,6 +100,7 @@ static GParamSpec *properties[PROP_N];
 
 enum {
         SIGNAL_SSL_FAILURE,
+        SIGNAL_FAILOVER,
         /* Number of signals */
         SIGNAL_N
 };
@@ -82,6 +111,8 @@ static guint signals[SIGNAL_N];
  * GObject definitions
  */
 
+typedef struct _GvEngineStandby GvEngineStandby;
+
 struct _GvEnginePrivate {
 	/* GStreamer stuff */
 	GstElement    *playbin;
@@ -95,9 +126,33 @@ struct _GvEnginePrivate {
 	gboolean       mute;
 	gboolean       pipeline_enabled;
 	gchar         *pipeline_string;
-	/* Retry on error with a delay */
-	guint          error_count;
+	guint          standby_pipelines;
+	guint          race_streams;
+	guint          buffer_low_watermark;
+	guint          buffer_high_watermark;
+	/* Buffer target, adjusted along the way */
+	guint          buffer_duration;
+	guint          buffer_stable_timeout_id;
+	/* Standby pipelines, most recently prerolled first */
+	GList         *standbys;
+	/* Pipelines racing to connect */
+	GList         *racers;
+	/* Reconnection in the background, then crossfade */
+	GvEngineStandby *replacement;
+	GstElement    *fading_playbin;
+	guint          crossfade_step;
+	guint          crossfade_timeout_id;
+	/* Current stream, and the last one that worked for each station */
+	gchar         *stream_uri;
+	GHashTable    *good_stream_uris;
+	/* Time to first data for each stream, in ms */
+	GHashTable    *stream_ttfbs;
+	gint64         connect_time;
+	/* Failover to the next stream on error */
+	guint          failover_count;
+	/* Retry on error, failover right away, otherwise when it's time */
 	guint          start_playback_timeout_id;
+	GvReconnectScheduler *reconnect_scheduler;
 };
 
 typedef struct _GvEnginePrivate GvEnginePrivate;
@@ -145,6 +200,147 @@ set_gst_state(GstElement *playbin, GstState state)
 	}
 }
 
+static GstElement *
+make_playbin(const gchar *name)
+{
+	GstElement *playbin;
+	GstElement *fakesink;
+
+	/* Make the playbin - returns floating ref */
+	playbin = gst_element_factory_make("playbin", name);
+	g_assert_nonnull(playbin);
+	g_object_ref_sink(playbin);
+
+	/* Disable video - returns floating ref */
+	fakesink = gst_element_factory_make("fakesink", NULL);
+	g_assert_nonnull(fakesink);
+	g_object_set(playbin, "video-sink", fakesink, NULL);
+
+	return playbin;
+}
+
+static void
+set_queue_limits(const GValue *item, gpointer user_data)
+{
+	GstElement *element = g_value_get_object(item);
+	guint seconds = GPOINTER_TO_UINT(user_data);
+	GstElementFactory *factory;
+	const gchar *name;
+
+	factory = gst_element_get_factory(element);
+	if (factory == NULL)
+		return;
+
+	name = gst_plugin_feature_get_name(GST_PLUGIN_FEATURE(factory));
+	if (g_strcmp0(name, "queue2") && g_strcmp0(name, "multiqueue"))
+		return;
+
+	g_object_set(element,
+	             "max-size-time", (guint64) seconds * GST_SECOND,
+	             "max-size-bytes", (guint) (seconds * BUFFER_BYTES_PER_SECOND),
+	             NULL);
+}
+
+static void
+set_buffer_duration(GstElement *playbin, guint seconds)
+{
+	GstIterator *iter;
+
+	/* The size is large enough to make the duration the limiting factor,
+	 * unless for really high bitrates.
+	 */
+	g_object_set(playbin,
+	             "buffer-duration", (gint64) seconds * GST_SECOND,
+	             "buffer-size", (gint) (seconds * BUFFER_BYTES_PER_SECOND),
+	             NULL);
+
+	/* Playbin only hands these settings to the queues it creates, while
+	 * the stream is set up. The queues that already exist must be set.
+	 */
+	iter = gst_bin_iterate_recurse(GST_BIN(playbin));
+	while (gst_iterator_foreach(iter, set_queue_limits, GUINT_TO_POINTER(seconds)) ==
+	       GST_ITERATOR_RESYNC)
+		gst_iterator_resync(iter);
+	gst_iterator_free(iter);
+}
+
+static const gchar *
+get_default_user_agent(void)
+{
+	static gchar *default_user_agent;
+
+	/* Sources are set up from the streaming threads, and there might
+	 * be several pipelines around, hence the once-init.
+	 */
+	if (g_once_init_enter(&default_user_agent)) {
+		gchar *gst_version;
+		gchar *user_agent;
+
+		gst_version = gst_version_string();
+		user_agent = g_strdup_printf("%s %s", gv_core_user_agent, gst_version);
+		g_free(gst_version);
+
+		g_once_init_leave(&default_user_agent, user_agent);
+	}
+
+	return default_user_agent;
+}
+
+static GstPadProbeReturn
+on_source_pad_event(GstPad          *pad,
+                    GstPadProbeInfo *info,
+                    gpointer         user_data G_GNUC_UNUSED)
+{
+	GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
+	GstObject *source;
+	GstMessage *msg;
+
+	/* WARNING! We're in the GStreamer streaming thread! */
+
+	if (GST_EVENT_TYPE(event) != GST_EVENT_EOS)
+		return GST_PAD_PROBE_OK;
+
+	/* The EOS message only reaches the bus once everything that is
+	 * buffered has been played. Let the main thread know right now
+	 * that the source is done.
+	 */
+	source = gst_pad_get_parent(pad);
+	if (source == NULL)
+		return GST_PAD_PROBE_OK;
+
+	msg = gst_message_new_application(source,
+			gst_structure_new_empty("source-eos"));
+	gst_element_post_message(GST_ELEMENT(source), msg);
+	gst_object_unref(source);
+
+	return GST_PAD_PROBE_OK;
+}
+
+static void
+setup_source(GstElement *source, GvStation *station)
+{
+	const gchar *user_agent;
+	gboolean ssl_strict;
+	GstPad *pad;
+
+	user_agent = gv_station_get_user_agent(station);
+	if (user_agent == NULL)
+		user_agent = get_default_user_agent();
+
+	ssl_strict = gv_station_get_insecure(station) ? FALSE : TRUE;
+
+	g_object_set(source, "user-agent", user_agent, "ssl-strict", ssl_strict, NULL);
+	DEBUG("Source setup: ssl-strict=%s, user-agent='%s'",
+			ssl_strict ? "true" : "false", user_agent);
+
+	pad = gst_element_get_static_pad(source, "src");
+	if (pad) {
+		gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+		                  on_source_pad_event, NULL, NULL);
+		gst_object_unref(pad);
+	}
+}
+
 #if 0
 static GstState
 get_gst_state(GstElement *playbin)
@@ -181,197 +377,629 @@ get_gst_state(GstElement *playbin)
 #endif
 
 /*
- * Private methods
+ * Standby pipelines
+ *
+ * A standby pipeline is a playbin that is brought to the PAUSED state in
+ * advance, for a station that is likely to be played soon. It connects and
+ * fills its buffer in the background, and when the station is eventually
+ * played, the pipeline is swapped in and playback starts right away.
  */
 
+struct _GvEngineStandby {
+	GvStation  *station;
+	gchar      *uri;
+	GstElement *playbin;
+	GstBus     *bus;
+	GstTagList *taglist;
+	gint        percent;
+	gboolean    failed;
+	/* Time of creation, and time when data started to flow */
+	gint64      start_time;
+	gint64      data_time;
+	/* Only set for standby pipelines, dropped when it fires */
+	guint       expire_timeout_id;
+	/* Set for pipelines that are prerolled for a station, or that race
+	 * to connect or reconnect
+	 */
+	GvEngine   *engine;
+};
+
 static void
-gv_engine_reload_pipeline(GvEngine *self)
+on_standby_source_setup(GstElement      *playbin G_GNUC_UNUSED,
+                        GstElement      *source,
+                        GvEngineStandby *standby)
 {
-	GvEnginePrivate *priv = self->priv;
-	GstElement *playbin = priv->playbin;
-	gboolean pipeline_enabled = priv->pipeline_enabled;
-	const gchar *pipeline_string = priv->pipeline_string;
-	GstElement *cur_audio_sink = NULL;
-	GstElement *new_audio_sink = NULL;
+	/* WARNING! We're likely in the GStreamer streaming thread! */
 
-	g_return_if_fail(playbin != NULL);
+	setup_source(source, standby->station);
+}
 
-	/* Get current audio sink */
-	g_object_get(playbin, "audio-sink", &cur_audio_sink, NULL);
+static void
+on_standby_bus_message_failure(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+                               GvEngineStandby *standby)
+{
+	DEBUG("Standby pipeline for '%s' failed on %s",
+	      gv_station_get_name_or_uri(standby->station),
+	      GST_MESSAGE_TYPE_NAME(msg));
 
-	DEBUG("Current audio sink: %s", cur_audio_sink ? GST_ELEMENT_NAME(cur_audio_sink) :
-	      "null (default)");
+	/* Stop it now, it will be disposed of later on */
+	set_gst_state(standby->playbin, GST_STATE_NULL);
+	standby->failed = TRUE;
+}
 
-	/* Create a new audio sink */
-	if (pipeline_enabled == FALSE || pipeline_string == NULL) {
-		new_audio_sink = NULL;
-	} else {
-		GError *err = NULL;
+static void
+on_standby_bus_message_tag(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+                           GvEngineStandby *standby)
+{
+	GstTagList *taglist = NULL;
+	GstTagList *merged;
 
-		new_audio_sink = gst_parse_launch(pipeline_string, &err);
-		if (err) {
-			WARNING("Failed to parse pipeline description: %s", err->message);
-			gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
-			                        _("Failed to parse pipeline description"),
-			                        err->message);
-			g_error_free(err);
-		}
-	}
+	/* Keep the tags, they'll be needed if ever we're swapped in */
+	gst_message_parse_tag(msg, &taglist);
+	merged = gst_tag_list_merge(standby->taglist, taglist, GST_TAG_MERGE_REPLACE);
+	gst_tag_list_unref(taglist);
 
-	DEBUG("New audio sink: %s", new_audio_sink ? GST_ELEMENT_NAME(new_audio_sink) :
-	      "null (default)");
+	if (standby->taglist)
+		gst_tag_list_unref(standby->taglist);
+	standby->taglist = merged;
+}
 
-	/* True when one of them is NULL */
-	if (cur_audio_sink != new_audio_sink) {
-		gv_engine_stop(self);
+static void
+on_standby_bus_message_buffering(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+                                 GvEngineStandby *standby)
+{
+	gst_message_parse_buffering(msg, &standby->percent);
 
-		if (new_audio_sink == NULL)
-			INFO("Setting gst audio sink to default");
-		else
-			INFO("Setting gst audio sink from pipeline '%s'", pipeline_string);
+	if (standby->data_time == 0)
+		standby->data_time = g_get_monotonic_time();
+}
 
-		g_object_set(playbin, "audio-sink", new_audio_sink, NULL);
+static void
+gv_engine_standby_free(GvEngineStandby *standby)
+{
+	g_clear_handle_id(&standby->expire_timeout_id, g_source_remove);
+
+	if (standby->playbin) {
+		g_signal_handlers_disconnect_by_data(standby->playbin, standby);
+		set_gst_state(standby->playbin, GST_STATE_NULL);
+		gst_object_unref(standby->playbin);
 	}
 
-	if (cur_audio_sink)
-		gst_object_unref(cur_audio_sink);
-}
+	if (standby->bus) {
+		g_signal_handlers_disconnect_by_data(standby->bus, standby);
+		gst_bus_remove_signal_watch(standby->bus);
+		gst_object_unref(standby->bus);
+	}
 
-/*
- * Property accessors
- */
+	if (standby->taglist)
+		gst_tag_list_unref(standby->taglist);
 
-GvEngineState
-gv_engine_get_state(GvEngine *self)
-{
-	return self->priv->state;
+	g_object_unref(standby->station);
+	g_free(standby->uri);
+	g_free(standby);
 }
 
-static void
-gv_engine_set_state(GvEngine *self, GvEngineState state)
+static GvEngineStandby *
+gv_engine_standby_new(GvEngine *self, GvStation *station, const gchar *uri)
 {
 	GvEnginePrivate *priv = self->priv;
+	GvEngineStandby *standby;
+	GstElement *audio_sink = NULL;
 
-	if (priv->state == state)
-		return;
+	/* An element can't belong to several pipelines, hence the custom
+	 * output pipeline must be instantiated once more.
+	 */
+	if (priv->pipeline_enabled && priv->pipeline_string) {
+		GError *err = NULL;
 
-	priv->state = state;
-	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATE]);
+		audio_sink = gst_parse_launch(priv->pipeline_string, &err);
+		if (err) {
+			DEBUG("Failed to parse pipeline description: %s", err->message);
+			g_error_free(err);
+		}
+
+		if (audio_sink == NULL)
+			return NULL;
+	}
+
+	standby = g_new0(GvEngineStandby, 1);
+	standby->station = g_object_ref(station);
+	standby->uri = g_strdup(uri);
+	standby->percent = -1;
+	standby->start_time = g_get_monotonic_time();
+
+	/* Make the playbin */
+	standby->playbin = make_playbin(NULL);
+	set_buffer_duration(standby->playbin, priv->buffer_duration);
+	if (audio_sink)
+		g_object_set(standby->playbin, "audio-sink", audio_sink, NULL);
+	g_signal_connect(standby->playbin, "source-setup",
+	                 G_CALLBACK(on_standby_source_setup), standby);
+
+	/* Watch the bus */
+	standby->bus = gst_element_get_bus(standby->playbin);
+	gst_bus_add_signal_watch(standby->bus);
+	g_signal_connect(standby->bus, "message::eos",
+	                 G_CALLBACK(on_standby_bus_message_failure), standby);
+	g_signal_connect(standby->bus, "message::error",
+	                 G_CALLBACK(on_standby_bus_message_failure), standby);
+	g_signal_connect(standby->bus, "message::tag",
+	                 G_CALLBACK(on_standby_bus_message_tag), standby);
+	g_signal_connect(standby->bus, "message::buffering",
+	                 G_CALLBACK(on_standby_bus_message_buffering), standby);
+
+	/* Start buffering */
+	DEBUG("Prerolling '%s' for station '%s'", uri,
+	      gv_station_get_name_or_uri(station));
+	g_object_set(standby->playbin, "uri", uri, NULL);
+	set_gst_state(standby->playbin, GST_STATE_READY);
+	set_gst_state(standby->playbin, GST_STATE_PAUSED);
+
+	return standby;
 }
 
-GvStation *
-gv_engine_get_station(GvEngine *self)
+static GList *
+prune_standby_list(GList *list, guint max)
 {
-	return self->priv->station;
+	GList *item, *next;
+	guint n = 0;
+
+	/* Drop the pipelines that failed, and the ones beyond max */
+	for (item = list; item; item = next) {
+		GvEngineStandby *standby = item->data;
+
+		next = item->next;
+
+		if (standby->failed == FALSE && n < max) {
+			n++;
+			continue;
+		}
+
+		gv_engine_standby_free(standby);
+		list = g_list_delete_link(list, item);
+	}
+
+	return list;
 }
 
 static void
-gv_engine_set_station(GvEngine *self, GvStation *station)
+gv_engine_prune_standbys(GvEngine *self, guint max)
 {
 	GvEnginePrivate *priv = self->priv;
 
-	if (g_set_object(&priv->station, station))
-		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATION]);
+	priv->standbys = prune_standby_list(priv->standbys, max);
 }
 
-GvStreaminfo *
-gv_engine_get_streaminfo(GvEngine *self)
+static void
+gv_engine_clear_racers(GvEngine *self)
 {
-	return self->priv->streaminfo;
+	GvEnginePrivate *priv = self->priv;
+
+	priv->racers = prune_standby_list(priv->racers, 0);
 }
 
-static void
-gv_engine_update_streaminfo_from_tags(GvEngine *self, GstTagList *taglist)
+static GvEngineStandby *
+gv_engine_take_standby(GvEngine *self, GvStation *station, const gchar *uri)
 {
 	GvEnginePrivate *priv = self->priv;
-	gboolean notify = FALSE;
+	GList *item;
 
-	if (priv->streaminfo == NULL) {
-		priv->streaminfo = gv_streaminfo_new();
-		notify = TRUE;
+	for (item = priv->standbys; item; item = item->next) {
+		GvEngineStandby *standby = item->data;
+
+		if (standby->station != station)
+			continue;
+
+		if (g_strcmp0(standby->uri, uri) || standby->failed)
+			continue;
+
+		priv->standbys = g_list_delete_link(priv->standbys, item);
+		return standby;
 	}
 
-	if (gv_streaminfo_update_from_gst_taglist(priv->streaminfo, taglist) == TRUE)
-		notify = TRUE;
+	return NULL;
+}
 
-	if (notify)
-		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STREAMINFO]);
+static gboolean
+when_timeout_expire_standby(gpointer data)
+{
+	GvEngineStandby *standby = data;
+	GvEnginePrivate *priv = standby->engine->priv;
+
+	DEBUG("Standby pipeline for '%s' expired",
+	      gv_station_get_name_or_uri(standby->station));
+
+	standby->expire_timeout_id = 0;
+	priv->standbys = g_list_remove(priv->standbys, standby);
+	gv_engine_standby_free(standby);
+
+	return G_SOURCE_REMOVE;
 }
 
 static void
-gv_engine_update_streaminfo_from_audio_pad(GvEngine *self, GstPad *pad)
+on_standby_bus_message_dropped(GstBus *bus G_GNUC_UNUSED,
+                               GstMessage *msg G_GNUC_UNUSED,
+                               GvEngineStandby *standby)
 {
+	GvEngine *self = standby->engine;
 	GvEnginePrivate *priv = self->priv;
-	gboolean notify = FALSE;
 
-	if (priv->streaminfo == NULL) {
-		priv->streaminfo = gv_streaminfo_new();
-		notify = TRUE;
+	/* The standby pipeline was marked as failed, drop it now rather
+	 * than waiting for the next preroll.
+	 */
+	gv_engine_prune_standbys(self, priv->standby_pipelines);
+}
+
+/*
+ * Private methods
+ */
+
+static const gchar *
+gv_engine_pick_stream_uri(GvEngine *self, GvStation *station)
+{
+	GvEnginePrivate *priv = self->priv;
+	GSList *stream_uris = gv_station_get_stream_uris(station);
+	const gchar *station_uri = gv_station_get_uri(station);
+	const gchar *good_uri;
+	const gchar *fastest_uri;
+	guint fastest_ttfb;
+	GSList *item;
+
+	/* Prefer the stream that worked last time, if it's still there */
+	good_uri = station_uri ?
+	           g_hash_table_lookup(priv->good_stream_uris, station_uri) : NULL;
+	if (good_uri) {
+		item = g_slist_find_custom(stream_uris, good_uri,
+		                           (GCompareFunc) g_strcmp0);
+		if (item)
+			return item->data;
 	}
 
-	if (gv_streaminfo_update_from_gst_audio_pad(priv->streaminfo, pad) == TRUE)
-		notify = TRUE;
+	/* Otherwise prefer the stream that was the fastest to connect */
+	fastest_uri = NULL;
+	fastest_ttfb = G_MAXUINT;
+	for (item = stream_uris; item; item = item->next) {
+		const gchar *uri = item->data;
+		gpointer value;
 
-	if (notify)
-		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STREAMINFO]);
+		if (!g_hash_table_lookup_extended(priv->stream_ttfbs, uri, NULL, &value))
+			continue;
+
+		if (GPOINTER_TO_UINT(value) < fastest_ttfb) {
+			fastest_ttfb = GPOINTER_TO_UINT(value);
+			fastest_uri = uri;
+		}
+	}
+
+	if (fastest_uri)
+		return fastest_uri;
+
+	return gv_station_get_first_stream_uri(station);
 }
 
 static void
-gv_engine_unset_streaminfo(GvEngine *self)
+gv_engine_remember_stream_ttfb(GvEngine *self, const gchar *stream_uri,
+                               gint64 start_time, gint64 data_time)
 {
 	GvEnginePrivate *priv = self->priv;
+	guint ttfb;
 
-	if (priv->streaminfo == NULL)
+	if (stream_uri == NULL || start_time == 0 || data_time < start_time)
 		return;
 
-	gv_clear_streaminfo(&priv->streaminfo);
-	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STREAMINFO]);
-}
-
-GvMetadata *
-gv_engine_get_metadata(GvEngine *self)
-{
-	return self->priv->metadata;
+	ttfb = (data_time - start_time) / 1000;
+	DEBUG("Time to first data for '%s': %u ms", stream_uri, ttfb);
+	g_hash_table_replace(priv->stream_ttfbs, g_strdup(stream_uri),
+	                     GUINT_TO_POINTER(ttfb));
 }
 
 static void
-gv_engine_update_metadata_from_tags(GvEngine *self, GstTagList *taglist)
+gv_engine_remember_stream_uri(GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
-	gboolean notify = FALSE;
-
-	if (priv->metadata == NULL)
-		priv->metadata = gv_metadata_new();
+	const gchar *station_uri;
 
-	notify = gv_metadata_update_from_gst_taglist(priv->metadata, taglist);
+	if (priv->station == NULL || priv->stream_uri == NULL)
+		return;
 
-	/* We don't want empty metadata objects, it makes life complicated
-	 * for consumers who will forever need to write this kind of code:
-	 *
-	 *     if (ptr && !gv_metadata_is_empty(ptr))
-	 *         ...
-	 */
-	if (gv_metadata_is_empty(priv->metadata))
-		gv_clear_metadata(&priv->metadata);
+	station_uri = gv_station_get_uri(priv->station);
+	if (station_uri == NULL)
+		return;
 
-	if (notify)
-		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_METADATA]);
+	g_hash_table_replace(priv->good_stream_uris,
+	                     g_strdup(station_uri), g_strdup(priv->stream_uri));
 }
 
 static void
-gv_engine_unset_metadata(GvEngine *self)
+gv_engine_set_buffer_duration(GvEngine *self, guint seconds)
 {
 	GvEnginePrivate *priv = self->priv;
 
-	if (priv->metadata == NULL)
+	seconds = CLAMP(seconds, MIN_BUFFER_DURATION, MAX_BUFFER_DURATION);
+
+	if (priv->buffer_duration == seconds)
 		return;
 
-	gv_clear_metadata(&priv->metadata);
-	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_METADATA]);
+	INFO("Setting buffer duration to %u seconds", seconds);
+	priv->buffer_duration = seconds;
+	set_buffer_duration(priv->playbin, seconds);
 }
 
-guint
-gv_engine_get_volume(GvEngine *self)
+static gboolean
+when_timeout_shrink_buffer(gpointer data)
+{
+	GvEngine *self = GV_ENGINE(data);
+	GvEnginePrivate *priv = self->priv;
+
+	/* Playback has been stable for a while, let's buffer less */
+	gv_engine_set_buffer_duration(self, priv->buffer_duration / 2);
+
+	if (priv->buffer_duration > MIN_BUFFER_DURATION)
+		return G_SOURCE_CONTINUE;
+
+	priv->buffer_stable_timeout_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gv_engine_drop_replacement(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->replacement == NULL)
+		return;
+
+	gv_engine_standby_free(priv->replacement);
+	priv->replacement = NULL;
+}
+
+static void
+gv_engine_finish_crossfade(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	g_clear_handle_id(&priv->crossfade_timeout_id, g_source_remove);
+
+	if (priv->fading_playbin == NULL)
+		return;
+
+	set_gst_state(priv->fading_playbin, GST_STATE_NULL);
+	gst_object_unref(priv->fading_playbin);
+	priv->fading_playbin = NULL;
+
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(priv->playbin),
+	                             GST_STREAM_VOLUME_FORMAT_CUBIC,
+	                             (gdouble) priv->volume / 100.0);
+}
+
+static gboolean
+when_timeout_crossfade(gpointer data)
+{
+	GvEngine *self = GV_ENGINE(data);
+	GvEnginePrivate *priv = self->priv;
+	gdouble volume = (gdouble) priv->volume / 100.0;
+	gdouble ratio;
+
+	priv->crossfade_step++;
+	ratio = (gdouble) (priv->crossfade_step * CROSSFADE_INTERVAL) /
+	        CROSSFADE_DURATION;
+
+	if (ratio >= 1.0) {
+		priv->crossfade_timeout_id = 0;
+		gv_engine_finish_crossfade(self);
+		return G_SOURCE_REMOVE;
+	}
+
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(priv->playbin),
+	                             GST_STREAM_VOLUME_FORMAT_CUBIC,
+	                             volume * ratio);
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(priv->fading_playbin),
+	                             GST_STREAM_VOLUME_FORMAT_CUBIC,
+	                             volume * (1.0 - ratio));
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+gv_engine_set_stream_uri(GvEngine *self, const gchar *stream_uri)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (!g_strcmp0(priv->stream_uri, stream_uri))
+		return;
+
+	g_free(priv->stream_uri);
+	priv->stream_uri = g_strdup(stream_uri);
+}
+
+static void
+gv_engine_reload_pipeline(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GstElement *playbin = priv->playbin;
+	gboolean pipeline_enabled = priv->pipeline_enabled;
+	const gchar *pipeline_string = priv->pipeline_string;
+	GstElement *cur_audio_sink = NULL;
+	GstElement *new_audio_sink = NULL;
+
+	g_return_if_fail(playbin != NULL);
+
+	/* Get current audio sink */
+	g_object_get(playbin, "audio-sink", &cur_audio_sink, NULL);
+
+	DEBUG("Current audio sink: %s", cur_audio_sink ? GST_ELEMENT_NAME(cur_audio_sink) :
+	      "null (default)");
+
+	/* Create a new audio sink */
+	if (pipeline_enabled == FALSE || pipeline_string == NULL) {
+		new_audio_sink = NULL;
+	} else {
+		GError *err = NULL;
+
+		new_audio_sink = gst_parse_launch(pipeline_string, &err);
+		if (err) {
+			WARNING("Failed to parse pipeline description: %s", err->message);
+			gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
+			                        _("Failed to parse pipeline description"),
+			                        err->message);
+			g_error_free(err);
+		}
+	}
+
+	DEBUG("New audio sink: %s", new_audio_sink ? GST_ELEMENT_NAME(new_audio_sink) :
+	      "null (default)");
+
+	/* True when one of them is NULL */
+	if (cur_audio_sink != new_audio_sink) {
+		gv_engine_stop(self);
+
+		if (new_audio_sink == NULL)
+			INFO("Setting gst audio sink to default");
+		else
+			INFO("Setting gst audio sink from pipeline '%s'", pipeline_string);
+
+		g_object_set(playbin, "audio-sink", new_audio_sink, NULL);
+	}
+
+	if (cur_audio_sink)
+		gst_object_unref(cur_audio_sink);
+}
+
+/*
+ * Property accessors
+ */
+
+GvEngineState
+gv_engine_get_state(GvEngine *self)
+{
+	return self->priv->state;
+}
+
+static void
+gv_engine_set_state(GvEngine *self, GvEngineState state)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->state == state)
+		return;
+
+	priv->state = state;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATE]);
+}
+
+GvStation *
+gv_engine_get_station(GvEngine *self)
+{
+	return self->priv->station;
+}
+
+static void
+gv_engine_set_station(GvEngine *self, GvStation *station)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (g_set_object(&priv->station, station))
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STATION]);
+}
+
+GvStreaminfo *
+gv_engine_get_streaminfo(GvEngine *self)
+{
+	return self->priv->streaminfo;
+}
+
+static void
+gv_engine_update_streaminfo_from_tags(GvEngine *self, GstTagList *taglist)
+{
+	GvEnginePrivate *priv = self->priv;
+	gboolean notify = FALSE;
+
+	if (priv->streaminfo == NULL) {
+		priv->streaminfo = gv_streaminfo_new();
+		notify = TRUE;
+	}
+
+	if (gv_streaminfo_update_from_gst_taglist(priv->streaminfo, taglist) == TRUE)
+		notify = TRUE;
+
+	if (notify)
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STREAMINFO]);
+}
+
+static void
+gv_engine_update_streaminfo_from_audio_pad(GvEngine *self, GstPad *pad)
+{
+	GvEnginePrivate *priv = self->priv;
+	gboolean notify = FALSE;
+
+	if (priv->streaminfo == NULL) {
+		priv->streaminfo = gv_streaminfo_new();
+		notify = TRUE;
+	}
+
+	if (gv_streaminfo_update_from_gst_audio_pad(priv->streaminfo, pad) == TRUE)
+		notify = TRUE;
+
+	if (notify)
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STREAMINFO]);
+}
+
+static void
+gv_engine_unset_streaminfo(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->streaminfo == NULL)
+		return;
+
+	gv_clear_streaminfo(&priv->streaminfo);
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STREAMINFO]);
+}
+
+GvMetadata *
+gv_engine_get_metadata(GvEngine *self)
+{
+	return self->priv->metadata;
+}
+
+static void
+gv_engine_update_metadata_from_tags(GvEngine *self, GstTagList *taglist)
+{
+	GvEnginePrivate *priv = self->priv;
+	gboolean notify = FALSE;
+
+	if (priv->metadata == NULL)
+		priv->metadata = gv_metadata_new();
+
+	notify = gv_metadata_update_from_gst_taglist(priv->metadata, taglist);
+
+	/* We don't want empty metadata objects, it makes life complicated
+	 * for consumers who will forever need to write this kind of code:
+	 *
+	 *     if (ptr && !gv_metadata_is_empty(ptr))
+	 *         ...
+	 */
+	if (gv_metadata_is_empty(priv->metadata))
+		gv_clear_metadata(&priv->metadata);
+
+	if (notify)
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_METADATA]);
+}
+
+static void
+gv_engine_unset_metadata(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->metadata == NULL)
+		return;
+
+	gv_clear_metadata(&priv->metadata);
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_METADATA]);
+}
+
+guint
+gv_engine_get_volume(GvEngine *self)
 {
 	return self->priv->volume;
 }
@@ -462,6 +1090,92 @@ gv_engine_set_pipeline_string(GvEngine *self, const gchar *pipeline_string)
 	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_PIPELINE_STRING]);
 }
 
+guint
+gv_engine_get_standby_pipelines(GvEngine *self)
+{
+	return self->priv->standby_pipelines;
+}
+
+void
+gv_engine_set_standby_pipelines(GvEngine *self, guint count)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (count > MAX_STANDBY_PIPELINES)
+		count = MAX_STANDBY_PIPELINES;
+
+	if (priv->standby_pipelines == count)
+		return;
+
+	priv->standby_pipelines = count;
+
+	gv_engine_prune_standbys(self, count);
+
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STANDBY_PIPELINES]);
+}
+
+guint
+gv_engine_get_race_streams(GvEngine *self)
+{
+	return self->priv->race_streams;
+}
+
+void
+gv_engine_set_race_streams(GvEngine *self, guint count)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (count > MAX_RACE_STREAMS)
+		count = MAX_RACE_STREAMS;
+
+	if (priv->race_streams == count)
+		return;
+
+	priv->race_streams = count;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RACE_STREAMS]);
+}
+
+guint
+gv_engine_get_buffer_low_watermark(GvEngine *self)
+{
+	return self->priv->buffer_low_watermark;
+}
+
+void
+gv_engine_set_buffer_low_watermark(GvEngine *self, guint percent)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (percent > 99)
+		percent = 99;
+
+	if (priv->buffer_low_watermark == percent)
+		return;
+
+	priv->buffer_low_watermark = percent;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_BUFFER_LOW_WATERMARK]);
+}
+
+guint
+gv_engine_get_buffer_high_watermark(GvEngine *self)
+{
+	return self->priv->buffer_high_watermark;
+}
+
+void
+gv_engine_set_buffer_high_watermark(GvEngine *self, guint percent)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	percent = CLAMP(percent, 1, 100);
+
+	if (priv->buffer_high_watermark == percent)
+		return;
+
+	priv->buffer_high_watermark = percent;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_BUFFER_HIGH_WATERMARK]);
+}
+
 static void
 gv_engine_get_property(GObject    *object,
                        guint       property_id,
@@ -497,6 +1211,18 @@ gv_engine_get_property(GObject    *object,
 	case PROP_PIPELINE_STRING:
 		g_value_set_string(value, gv_engine_get_pipeline_string(self));
 		break;
+	case PROP_STANDBY_PIPELINES:
+		g_value_set_uint(value, gv_engine_get_standby_pipelines(self));
+		break;
+	case PROP_RACE_STREAMS:
+		g_value_set_uint(value, gv_engine_get_race_streams(self));
+		break;
+	case PROP_BUFFER_LOW_WATERMARK:
+		g_value_set_uint(value, gv_engine_get_buffer_low_watermark(self));
+		break;
+	case PROP_BUFFER_HIGH_WATERMARK:
+		g_value_set_uint(value, gv_engine_get_buffer_high_watermark(self));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
 		break;
@@ -526,85 +1252,24 @@ gv_engine_set_property(GObject      *object,
 	case PROP_PIPELINE_STRING:
 		gv_engine_set_pipeline_string(self, g_value_get_string(value));
 		break;
+	case PROP_STANDBY_PIPELINES:
+		gv_engine_set_standby_pipelines(self, g_value_get_uint(value));
+		break;
+	case PROP_RACE_STREAMS:
+		gv_engine_set_race_streams(self, g_value_get_uint(value));
+		break;
+	case PROP_BUFFER_LOW_WATERMARK:
+		gv_engine_set_buffer_low_watermark(self, g_value_get_uint(value));
+		break;
+	case PROP_BUFFER_HIGH_WATERMARK:
+		gv_engine_set_buffer_high_watermark(self, g_value_get_uint(value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
 		break;
 	}
 }
 
-/*
- * Public methods
- */
-
-void
-gv_engine_play(GvEngine *self, GvStation *station)
-{
-	GvEnginePrivate *priv = self->priv;
-	const gchar *station_stream_uri;
-
-	g_return_if_fail(station != NULL);
-
-	/* Station must have a stream uri */
-	station_stream_uri = gv_station_get_first_stream_uri(station);
-	if (station_stream_uri == NULL) {
-		WARNING("Station '%s' has no stream uri",
-		        gv_station_get_name_or_uri(station));
-		return;
-	}
-
-	/* Cleanup error handling */
-	priv->error_count = 0;
-	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
-
-	/* Set station */
-	gv_engine_set_station(self, station);
-
-	/* According to the doc:
-	 *
-	 * > State changes to GST_STATE_READY or GST_STATE_NULL never return
-	 * > GST_STATE_CHANGE_ASYNC.
-	 *
-	 * https://gstreamer.freedesktop.org/documentation/gstreamer/gstelement.html#gst_element_set_state
-	 */
-
-	/* Ensure playback is stopped */
-	set_gst_state(priv->playbin, GST_STATE_NULL);
-
-	/* Set the stream uri */
-	g_object_set(priv->playbin, "uri", station_stream_uri, NULL);
-
-	/* Go to the ready stop (not sure it's needed) */
-	set_gst_state(priv->playbin, GST_STATE_READY);
-
-	/* Set gst state to PAUSE, so that the playbin starts buffering data.
-	 * Playback will start as soon as buffering is finished.
-	 */
-	set_gst_state(priv->playbin, GST_STATE_PAUSED);
-	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
-}
-
-void
-gv_engine_stop(GvEngine *self)
-{
-	GvEnginePrivate *priv = self->priv;
-
-	/* Cleanup error handling */
-	priv->error_count = 0;
-	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
-
-	/* Radical way to stop: set state to NULL */
-	set_gst_state(priv->playbin, GST_STATE_NULL);
-	gv_engine_set_state(self, GV_ENGINE_STATE_STOPPED);
-	gv_engine_unset_streaminfo(self);
-	gv_engine_unset_metadata(self);
-}
-
-GvEngine *
-gv_engine_new(void)
-{
-	return g_object_new(GV_TYPE_ENGINE, NULL);
-}
-
 /*
  * GStreamer playbin signal handlers
  */
@@ -634,79 +1299,181 @@ on_playbin_source_setup(GstElement *playbin G_GNUC_UNUSED,
 {
 	GvEnginePrivate *priv = self->priv;
 	GvStation *station = priv->station;
-	static gchar *default_user_agent;
-	const gchar *user_agent;
-	gboolean ssl_strict;
 
 	/* WARNING! We're likely in the GStreamer streaming thread! */
 
 	if (station == NULL)
 		return;
 
-	if (default_user_agent == NULL) {
-		gchar *gst_version;
+	setup_source(source, station);
+}
 
-		gst_version = gst_version_string();
-		default_user_agent = g_strdup_printf("%s %s", gv_core_user_agent, gst_version);
-		g_free(gst_version);
-	}
+static void
+gv_engine_watch_audio_pad(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GstPad *pad = NULL;
 
-	user_agent = gv_station_get_user_agent(station);
-	if (user_agent == NULL)
-		user_agent = default_user_agent;
+	g_signal_emit_by_name(priv->playbin, "get-audio-pad", 0, &pad);
+	gv_engine_update_streaminfo_from_audio_pad(self, pad);
 
-	ssl_strict = gv_station_get_insecure(station) ? FALSE : TRUE;
+	if (pad == NULL)
+		return;
 
-	g_object_set(source, "user-agent", user_agent, "ssl-strict", ssl_strict, NULL);
-	DEBUG("Source setup: ssl-strict=%s, user-agent='%s'",
-			ssl_strict ? "true" : "false", user_agent);
+	g_signal_connect_object(pad, "notify::caps",
+			G_CALLBACK(on_playbin_audio_pad_notify_caps), self, 0);
+	gst_object_unref(pad);
 }
 
 /*
  * GStreamer bus signal handlers
  */
 
+static gboolean gv_engine_replace_playbin(GvEngine *self);
+
+static void
+start_playing(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	set_gst_state(priv->playbin, GST_STATE_PLAYING);
+	gv_engine_set_state(self, GV_ENGINE_STATE_PLAYING);
+	gv_engine_remember_stream_uri(self);
+	priv->failover_count = 0;
+	gv_reconnect_scheduler_succeeded(priv->reconnect_scheduler, priv->stream_uri);
+
+	/* If it keeps playing for a while, the buffer can shrink */
+	g_clear_handle_id(&priv->buffer_stable_timeout_id, g_source_remove);
+	if (priv->buffer_duration > MIN_BUFFER_DURATION)
+		priv->buffer_stable_timeout_id =
+		        g_timeout_add_seconds(BUFFER_STABLE_PERIOD,
+		                              when_timeout_shrink_buffer, self);
+}
+
+static void
+pause_on_underrun(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	set_gst_state(priv->playbin, GST_STATE_PAUSED);
+	gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+
+	/* Playback is not stable, the buffer must grow */
+	g_clear_handle_id(&priv->buffer_stable_timeout_id, g_source_remove);
+	gv_engine_set_buffer_duration(self, priv->buffer_duration * 2);
+}
+
+static void
+restart_playback(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->state == GV_ENGINE_STATE_STOPPED)
+		return;
+
+	set_gst_state(priv->playbin, GST_STATE_NULL);
+	g_object_set(priv->playbin, "uri", priv->stream_uri, NULL);
+	set_gst_state(priv->playbin, GST_STATE_READY);
+	set_gst_state(priv->playbin, GST_STATE_PAUSED);
+	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+	priv->connect_time = g_get_monotonic_time();
+}
+
 static gboolean
 when_timeout_start_playback(gpointer data)
 {
 	GvEngine *self = GV_ENGINE(data);
 	GvEnginePrivate *priv = self->priv;
 
-	if (self->priv->state != GV_ENGINE_STATE_STOPPED) {
-		set_gst_state(priv->playbin, GST_STATE_NULL);
-		set_gst_state(priv->playbin, GST_STATE_READY);
-		set_gst_state(priv->playbin, GST_STATE_PAUSED);
-		gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
-	}
+	restart_playback(self);
 
 	priv->start_playback_timeout_id = 0;
 	return G_SOURCE_REMOVE;
 }
 
 static void
-retry_playback(GvEngine *self)
+on_reconnect_scheduler_reconnect(GvReconnectScheduler *scheduler G_GNUC_UNUSED,
+                                 GvEngine *self)
+{
+	INFO("Restarting playback");
+	restart_playback(self);
+}
+
+static void
+retry_playback(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	guint delay;
+
+	/* We retry playback after there's been a failure of some sort.
+	 * We don't know what kind of failure, so it's up to the scheduler to
+	 * decide when it's a good time to retry: it waits for the network if
+	 * it's down, and otherwise backs off more and more.
+	 */
+
+	if (priv->start_playback_timeout_id != 0)
+		return;
+
+	if (gv_reconnect_scheduler_is_pending(priv->reconnect_scheduler))
+		return;
+
+	delay = gv_reconnect_scheduler_schedule(priv->reconnect_scheduler,
+	                                        priv->stream_uri);
+	if (delay == GV_RECONNECT_SCHEDULER_WAIT_NETWORK)
+		INFO("Restarting playback when the network is back");
+	else
+		INFO("Restarting playback in %u ms", delay);
+}
+
+static void
+recover_playback(GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
-	guint delay;
-
-	/* We retry playback after there's been a failure of some sort.
-	 * We don't know what kind of failure, and maybe the network is down,
-	 * in such case we don't want to keep retrying in a wild loop. So the
-	 * strategy here is to start retrying with a minimal delay, and increment
-	 * the delay with the failure count.
+	GSList *stream_uris;
+	GSList *item;
+	const gchar *next_uri;
+	guint n_uris;
+
+	/* Stations might have several streams, that are usually mirrors of
+	 * each others. When a stream fails, we try the next one right away.
+	 * It's only when every stream failed in a row that we fall back to
+	 * retrying with an increasing delay.
 	 */
 
 	if (priv->start_playback_timeout_id != 0)
 		return;
 
-	g_assert(priv->error_count > 0);
-	delay = priv->error_count - 1;
-	if (delay > 10)
-		delay = 10;
+	if (gv_reconnect_scheduler_is_pending(priv->reconnect_scheduler))
+		return;
+
+	stream_uris = gv_station_get_stream_uris(priv->station);
+	n_uris = g_slist_length(stream_uris);
+
+	/* Pick the stream after the current one */
+	item = g_slist_find_custom(stream_uris, priv->stream_uri,
+	                           (GCompareFunc) g_strcmp0);
+	if (item && item->next)
+		next_uri = item->next->data;
+	else
+		next_uri = stream_uris ? stream_uris->data : priv->stream_uri;
+
+	if (g_strcmp0(next_uri, priv->stream_uri)) {
+		INFO("Failing over from '%s' to '%s'", priv->stream_uri, next_uri);
+		g_signal_emit(self, signals[SIGNAL_FAILOVER], 0,
+		              priv->stream_uri, next_uri);
+		gv_engine_set_stream_uri(self, next_uri);
+	}
+
+	if (priv->failover_count + 1 < n_uris) {
+		priv->failover_count++;
+		priv->start_playback_timeout_id =
+		        g_idle_add(when_timeout_start_playback, self);
+		return;
+	}
 
-	INFO("Restarting playback in %u seconds", delay);
-	priv->start_playback_timeout_id =
-	        g_timeout_add_seconds(delay, when_timeout_start_playback, self);
+	/* Every stream failed, let's wait a bit */
+	priv->failover_count = 0;
+	retry_playback(self);
 }
 
 static void
@@ -716,14 +1483,18 @@ on_bus_message_eos(GstBus *bus G_GNUC_UNUSED, GstMessage *msg G_GNUC_UNUSED, GvE
 
 	INFO("Gst bus EOS message");
 
-	priv->error_count++;
+	/* Everything was played, but a new pipeline is on its way */
+	if (priv->replacement) {
+		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+		return;
+	}
 
 	/* Stop immediately otherwise gst keeps on spitting errors */
 	set_gst_state(priv->playbin, GST_STATE_NULL);
 
 	/* Restart playback if needed */
 	if (self->priv->state != GV_ENGINE_STATE_STOPPED)
-		retry_playback(self);
+		recover_playback(self);
 
 	/* Emit an error */
 	//gv_errorable_emit_error(GV_ERRORABLE(self), "%s", _("End of stream"));
@@ -736,8 +1507,6 @@ on_bus_message_error(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
 	GError *err;
 	gchar  *debug;
 
-	priv->error_count++;
-
 	/* Parse message */
 	gst_message_parse_error(msg, &err, &debug);
 
@@ -746,25 +1515,35 @@ on_bus_message_error(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
 	        g_quark_to_string(err->domain), err->code, err->message);
 	WARNING("Gst bus error debug: %s", debug);
 
-	/* Stop playback otherwise gst keeps on spitting errors */
-	set_gst_state(priv->playbin, GST_STATE_NULL);
-
 	/* Here comes the actual effort to handle errors. At the moment there's
-	 * not much to it, we only handle SSL failures.
+	 * not much to it. SSL failures stop playback, and it's up to the user
+	 * to decide what to do. Other failures to connect (refused connection,
+	 * server errors, ...) move on to the next stream. Otherwise, if we were
+	 * playing, we keep on playing what's buffered while reconnecting in
+	 * the background. Otherwise we stop playback (otherwise gst keeps on
+	 * spitting errors), and retry.
 	 */
-	if (g_error_matches(err, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_OPEN_READ)) {
+	if (priv->replacement) {
+		DEBUG("Reconnecting already, ignoring error");
+	} else if (g_error_matches(err, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_OPEN_READ)) {
 		const GstStructure *details = NULL;
+		guint code = 0;
+		set_gst_state(priv->playbin, GST_STATE_NULL);
 		gst_message_parse_error_details(msg, &details);
-		if (details && gst_structure_has_field_typed(details, "http-status-code", G_TYPE_UINT)) {
-			guint code = 0;
+		if (details && gst_structure_has_field_typed(details, "http-status-code", G_TYPE_UINT))
 			gst_structure_get_uint(details, "http-status-code", &code);
-			if (code == SOUP_STATUS_SSL_FAILED)
-				g_signal_emit(self, signals[SIGNAL_SSL_FAILURE], 0, err->message, debug);
-		}
+		if (code == SOUP_STATUS_SSL_FAILED)
+			g_signal_emit(self, signals[SIGNAL_SSL_FAILURE], 0, err->message, debug);
+		else if (priv->state != GV_ENGINE_STATE_STOPPED)
+			recover_playback(self);
+	} else if (priv->state == GV_ENGINE_STATE_PLAYING &&
+	           gv_engine_replace_playbin(self)) {
+		DEBUG("Playing buffered data while reconnecting");
 	} else {
 		/* When in doubt, retry! */
+		set_gst_state(priv->playbin, GST_STATE_NULL);
 		if (self->priv->state != GV_ENGINE_STATE_STOPPED)
-			retry_playback(self);
+			recover_playback(self);
 	}
 
 	/* Cleanup */
@@ -911,173 +1690,625 @@ tag_list_foreach_dump(const GstTagList *list, const gchar *tag,
 	}
 	}
 
-	DEBUG("%10s '%20s' (%d elem): %s",
-	      g_type_name(gst_tag_get_type(tag)),
-	      tag,
-	      gst_tag_list_get_tag_size(list, tag),
-	      str);
-	g_free(str);
+	DEBUG("%10s '%20s' (%d elem): %s",
+	      g_type_name(gst_tag_get_type(tag)),
+	      tag,
+	      gst_tag_list_get_tag_size(list, tag),
+	      str);
+	g_free(str);
+
+}
+#endif /* DEBUG_GST_TAGS */
+
+static void
+on_bus_message_tag(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+{
+	GstTagList *taglist = NULL;
+
+	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+
+	gst_message_parse_tag(msg, &taglist);
+
+#ifdef DEBUG_GST_TAGS
+	DEBUG("->>- GST TAGLIST DUMP ->>-->>-->>-->>-->>-->>-->>-->>----");
+	gst_tag_list_foreach(taglist, (GstTagForeachFunc) tag_list_foreach_dump, NULL);
+	DEBUG("-<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--");
+#endif /* DEBUG_GST_TAGS */
+
+	gv_engine_update_streaminfo_from_tags(self, taglist);
+	gv_engine_update_metadata_from_tags(self, taglist);
+
+	gst_tag_list_unref(taglist);
+}
+
+static void
+on_bus_message_buffering(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	static gint prev_percent = 0;
+	guint low_watermark = priv->buffer_low_watermark;
+	guint high_watermark = priv->buffer_high_watermark;
+	gint percent = 0;
+
+	/* Handle the buffering message. Some documentation:
+	 * https://gstreamer.freedesktop.org/documentation/gstreamer/gstmessage.html#gst_message_new_buffering
+	 */
+
+	/* Parse message */
+	gst_message_parse_buffering(msg, &percent);
+
+	/* Display buffering steps 20 by 20 */
+	if (ABS(percent - prev_percent) > 20) {
+		prev_percent = percent;
+		DEBUG("Buffering (%3u %%)", percent);
+	}
+
+	/* Watermarks must leave some room in-between, for hysteresis */
+	if (low_watermark >= high_watermark)
+		low_watermark = high_watermark - 1;
+
+	/* Now, let's react according to our current state */
+	switch (priv->state) {
+	case GV_ENGINE_STATE_STOPPED:
+		/* This shouldn't happen */
+		WARNING("Received 'bus buffering' while stopped");
+		break;
+
+	case GV_ENGINE_STATE_CONNECTING:
+		/* We successfully connected! */
+		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+		gv_engine_remember_stream_ttfb(self, priv->stream_uri,
+		                               priv->connect_time,
+		                               g_get_monotonic_time());
+
+		/* NO BREAK HERE!
+		 * This is to handle the (very special) case where the first
+		 * buffering message received is already 100%. I'm not sure this
+		 * can happen, but it doesn't hurt to be ready.
+		 *
+		 * To avoid warnings, the next line could be:
+		 * __attribute__((fallthrough));
+		 *
+		 * However this is gcc-7 only, and I don't know about clang.
+		 * So we use a more portable (and more magic) marker comment.
+		 */
+		// fall through
+
+	case GV_ENGINE_STATE_BUFFERING:
+		/* When buffering reaches the high watermark, start playing */
+		if ((guint) percent >= high_watermark) {
+			DEBUG("Buffering complete, starting playback");
+			start_playing(self);
+		}
+		break;
+
+	case GV_ENGINE_STATE_PLAYING:
+		/* According to the documentation, we should pause as soon as
+		 * buffering is < 100%. However, more than often, I constantly
+		 * receive 'buffering < 100%' messages, and pausing/playing
+		 * constantly cuts the sound. So we keep playing until the
+		 * buffer runs really low, ie. below the low watermark.
+		 */
+		if ((guint) percent < low_watermark) {
+			INFO("Buffer underrun (%d %%), pausing", percent);
+			pause_on_underrun(self);
+		}
+		break;
+
+	default:
+		WARNING("Unhandled engine state %d", priv->state);
+	}
+}
+
+static void
+on_bus_message_state_changed(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+                             GvEngine *self G_GNUC_UNUSED)
+{
+#ifdef DEBUG_GST_STATE_CHANGES
+	GstState old, new, pending;
+
+	/* Parse message */
+	gst_message_parse_state_changed(msg, &old, &new, &pending);
+
+	/* Just used for debug */
+	DEBUG("Gst state changed: old: %s, new: %s, pending: %s",
+	      gst_element_state_get_name(old),
+	      gst_element_state_get_name(new),
+	      gst_element_state_get_name(pending));
+#else
+	(void) msg;
+#endif
+}
+
+static void
+on_bus_message_stream_start(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+                            GvEngine *self)
+{
+	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+	DEBUG("Stream started");
+
+	gv_engine_watch_audio_pad(self);
+}
+
+static void
+on_bus_message_application(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
+                           GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	const GstStructure *s;
+	const gchar *msg_name;
+
+	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+
+	s = gst_message_get_structure(msg);
+	msg_name = gst_structure_get_name(s);
+	g_return_if_fail(msg_name != NULL);
+
+	if (!g_strcmp0(msg_name, "audio-caps-changed")) {
+		GstElement *playbin = priv->playbin;
+		GstPad *pad = NULL;
+
+		g_signal_emit_by_name(playbin, "get-audio-pad", 0, &pad);
+		gv_engine_update_streaminfo_from_audio_pad(self, pad);
+	} else if (!g_strcmp0(msg_name, "source-eos")) {
+		/* Reconnect while buffered data is still being played */
+		DEBUG("Source reached end of stream");
+		if (priv->state == GV_ENGINE_STATE_PLAYING)
+			gv_engine_replace_playbin(self);
+	} else {
+		WARNING("Unhandled application message %s", msg_name);
+	}
+}
+
+/*
+ * Pipeline management
+ */
+
+static void
+gv_engine_attach_playbin(GvEngine *self, GstElement *playbin, GstBus *bus)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	g_assert_null(priv->playbin);
+	g_assert_null(priv->bus);
+
+	/* Take ownership, the bus must already have a signal watch */
+	priv->playbin = playbin;
+	priv->bus = bus;
+
+	/* Apply current settings */
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(playbin),
+	                             GST_STREAM_VOLUME_FORMAT_CUBIC,
+	                             (gdouble) priv->volume / 100.0);
+	gst_stream_volume_set_mute(GST_STREAM_VOLUME(playbin), priv->mute);
+	set_buffer_duration(playbin, priv->buffer_duration);
+
+	/* Connect playbin signal handlers */
+	g_signal_connect_object(playbin, "source-setup",
+	                        G_CALLBACK(on_playbin_source_setup), self, 0);
+
+	/* Connect bus signal handlers */
+	g_signal_connect_object(bus, "message::eos",
+	                        G_CALLBACK(on_bus_message_eos), self, 0);
+	g_signal_connect_object(bus, "message::error",
+	                        G_CALLBACK(on_bus_message_error), self, 0);
+	g_signal_connect_object(bus, "message::warning",
+	                        G_CALLBACK(on_bus_message_warning), self, 0);
+	g_signal_connect_object(bus, "message::info",
+	                        G_CALLBACK(on_bus_message_info), self, 0);
+	g_signal_connect_object(bus, "message::tag",
+	                        G_CALLBACK(on_bus_message_tag), self, 0);
+	g_signal_connect_object(bus, "message::buffering",
+	                        G_CALLBACK(on_bus_message_buffering), self, 0);
+	g_signal_connect_object(bus, "message::state-changed",
+	                        G_CALLBACK(on_bus_message_state_changed), self, 0);
+	g_signal_connect_object(bus, "message::stream-start",
+	                        G_CALLBACK(on_bus_message_stream_start), self, 0);
+	g_signal_connect_object(bus, "message::application",
+	                        G_CALLBACK(on_bus_message_application), self, 0);
+}
+
+static void
+gv_engine_detach_playbin(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	/* Stop playback, unless the playbin is fading out */
+	if (priv->playbin != priv->fading_playbin)
+		set_gst_state(priv->playbin, GST_STATE_NULL);
+
+	/* Unref the bus */
+	g_signal_handlers_disconnect_by_data(priv->bus, self);
+	gst_bus_remove_signal_watch(priv->bus);
+	gst_object_unref(priv->bus);
+	priv->bus = NULL;
+
+	/* Unref the playbin */
+	g_signal_handlers_disconnect_by_data(priv->playbin, self);
+	gst_object_unref(priv->playbin);
+	priv->playbin = NULL;
+}
+
+static void
+gv_engine_promote_standby(GvEngine *self, GvEngineStandby *standby,
+                          gboolean crossfade)
+{
+	GvEnginePrivate *priv = self->priv;
+	GstElement *playbin;
+	GstBus *bus;
+
+	INFO("Swapping in prerolled pipeline for station '%s'",
+	     gv_station_get_name_or_uri(standby->station));
+
+	/* Take the pipeline away from the standby */
+	g_signal_handlers_disconnect_by_data(standby->playbin, standby);
+	g_signal_handlers_disconnect_by_data(standby->bus, standby);
+	playbin = g_steal_pointer(&standby->playbin);
+	bus = g_steal_pointer(&standby->bus);
+
+	/* Replace the current pipeline. When crossfading, the current
+	 * pipeline keeps on playing for a little while.
+	 */
+	gv_engine_finish_crossfade(self);
+
+	if (crossfade) {
+		priv->fading_playbin = gst_object_ref(priv->playbin);
+		priv->crossfade_step = 0;
+		priv->crossfade_timeout_id =
+		        g_timeout_add(CROSSFADE_INTERVAL, when_timeout_crossfade, self);
+	}
+
+	gv_engine_detach_playbin(self);
+	gv_engine_attach_playbin(self, playbin, bus);
+
+	if (crossfade)
+		gst_stream_volume_set_volume(GST_STREAM_VOLUME(playbin),
+		                             GST_STREAM_VOLUME_FORMAT_CUBIC, 0.0);
+
+	/* Catch up with what happened while in standby */
+	if (standby->taglist) {
+		gv_engine_update_streaminfo_from_tags(self, standby->taglist);
+		gv_engine_update_metadata_from_tags(self, standby->taglist);
+	}
+
+	gv_engine_watch_audio_pad(self);
+
+	/* Start playing right away if buffering is complete, otherwise
+	 * the bus buffering handler takes it from here.
+	 */
+	if (standby->percent >= (gint) priv->buffer_high_watermark) {
+		start_playing(self);
+	} else if (standby->percent >= 0) {
+		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+	} else {
+		gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+	}
+
+	gv_engine_standby_free(standby);
+}
+
+static void
+on_racer_bus_message_async_done(GstBus *bus G_GNUC_UNUSED,
+                                GstMessage *msg G_GNUC_UNUSED,
+                                GvEngineStandby *racer)
+{
+	GvEngine *self = racer->engine;
+	GvEnginePrivate *priv = self->priv;
+	GList *item;
+
+	/* The first pipeline to preroll has decodable audio, it wins */
+	INFO("Stream '%s' won the race", racer->uri);
+	priv->racers = g_list_remove(priv->racers, racer);
+
+	/* Remember how fast each stream was, and drop the losers */
+	if (racer->data_time == 0)
+		racer->data_time = g_get_monotonic_time();
+
+	for (item = priv->racers; item; item = item->next) {
+		GvEngineStandby *loser = item->data;
+
+		gv_engine_remember_stream_ttfb(self, loser->uri,
+		                               loser->start_time, loser->data_time);
+	}
+
+	gv_engine_remember_stream_ttfb(self, racer->uri,
+	                               racer->start_time, racer->data_time);
+	gv_engine_clear_racers(self);
+
+	/* Play the winner */
+	gv_engine_set_stream_uri(self, racer->uri);
+	gv_engine_promote_standby(self, racer, FALSE);
+}
+
+static void
+on_racer_bus_message_failure(GstBus *bus G_GNUC_UNUSED,
+                             GstMessage *msg G_GNUC_UNUSED,
+                             GvEngineStandby *racer)
+{
+	GvEngine *self = racer->engine;
+	GvEnginePrivate *priv = self->priv;
+	GList *item;
+
+	/* Nothing to do as long as a pipeline is still in the race */
+	for (item = priv->racers; item; item = item->next) {
+		GvEngineStandby *other = item->data;
+
+		if (other->failed == FALSE)
+			return;
+	}
+
+	/* Every stream failed, fall back to the usual retry strategy */
+	INFO("Every stream failed to connect");
+	gv_engine_clear_racers(self);
+	retry_playback(self);
+}
+
+static gboolean
+gv_engine_race_streams(GvEngine *self, GvStation *station)
+{
+	GvEnginePrivate *priv = self->priv;
+	GSList *stream_uris = gv_station_get_stream_uris(station);
+	const gchar *station_uri = gv_station_get_uri(station);
+	GSList *item;
+	guint n;
+
+	if (priv->race_streams < 2 || g_slist_length(stream_uris) < 2)
+		return FALSE;
+
+	/* No need to race if we already know which stream to use */
+	if (station_uri && g_hash_table_contains(priv->good_stream_uris, station_uri))
+		return FALSE;
+
+	for (item = stream_uris, n = 0; item && n < priv->race_streams;
+	     item = item->next, n++)
+		if (g_hash_table_contains(priv->stream_ttfbs, item->data))
+			return FALSE;
+
+	/* Stop the current pipeline, and start a pipeline for each stream */
+	set_gst_state(priv->playbin, GST_STATE_NULL);
+
+	for (item = stream_uris, n = 0; item && n < priv->race_streams;
+	     item = item->next, n++) {
+		GvEngineStandby *racer;
+
+		racer = gv_engine_standby_new(self, station, item->data);
+		if (racer == NULL)
+			continue;
+
+		racer->engine = self;
+		g_signal_connect(racer->bus, "message::async-done",
+		                 G_CALLBACK(on_racer_bus_message_async_done), racer);
+		g_signal_connect(racer->bus, "message::eos",
+		                 G_CALLBACK(on_racer_bus_message_failure), racer);
+		g_signal_connect(racer->bus, "message::error",
+		                 G_CALLBACK(on_racer_bus_message_failure), racer);
+
+		priv->racers = g_list_append(priv->racers, racer);
+	}
+
+	if (priv->racers == NULL)
+		return FALSE;
+
+	INFO("Racing %u streams for station '%s'", g_list_length(priv->racers),
+	     gv_station_get_name_or_uri(station));
+	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
 
+	return TRUE;
 }
-#endif /* DEBUG_GST_TAGS */
 
 static void
-on_bus_message_tag(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+on_replacement_bus_message_buffering(GstBus *bus G_GNUC_UNUSED,
+                                     GstMessage *msg G_GNUC_UNUSED,
+                                     GvEngineStandby *replacement)
 {
-	GstTagList *taglist = NULL;
-
-	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+	GvEngine *self = replacement->engine;
+	GvEnginePrivate *priv = self->priv;
 
-	gst_message_parse_tag(msg, &taglist);
+	if (replacement->percent < (gint) priv->buffer_high_watermark)
+		return;
 
-#ifdef DEBUG_GST_TAGS
-	DEBUG("->>- GST TAGLIST DUMP ->>-->>-->>-->>-->>-->>-->>-->>----");
-	gst_tag_list_foreach(taglist, (GstTagForeachFunc) tag_list_foreach_dump, NULL);
-	DEBUG("-<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--<<--");
-#endif /* DEBUG_GST_TAGS */
+	/* Buffering complete, splice the new pipeline in */
+	priv->replacement = NULL;
+	gv_engine_promote_standby(self, replacement, TRUE);
+}
 
-	gv_engine_update_streaminfo_from_tags(self, taglist);
-	gv_engine_update_metadata_from_tags(self, taglist);
+static void
+on_replacement_bus_message_failure(GstBus *bus G_GNUC_UNUSED,
+                                   GstMessage *msg G_GNUC_UNUSED,
+                                   GvEngineStandby *replacement)
+{
+	GvEngine *self = replacement->engine;
+	GvEnginePrivate *priv = self->priv;
 
-	gst_tag_list_unref(taglist);
+	/* Reconnecting failed, fall back to the usual retry strategy */
+	INFO("Failed to reconnect in the background");
+	gv_engine_drop_replacement(self);
+	set_gst_state(priv->playbin, GST_STATE_NULL);
+	recover_playback(self);
 }
 
-static void
-on_bus_message_buffering(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
+static gboolean
+gv_engine_replace_playbin(GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
-	static gint prev_percent = 0;
-	gint percent = 0;
+	GvEngineStandby *replacement;
 
-	/* Handle the buffering message. Some documentation:
-	 * https://gstreamer.freedesktop.org/documentation/gstreamer/gstmessage.html#gst_message_new_buffering
+	if (priv->replacement)
+		return TRUE;
+
+	if (priv->station == NULL || priv->stream_uri == NULL)
+		return FALSE;
+
+	/* Connect to the stream again with a new pipeline, while the current
+	 * pipeline plays out what it has buffered.
 	 */
+	replacement = gv_engine_standby_new(self, priv->station, priv->stream_uri);
+	if (replacement == NULL)
+		return FALSE;
 
-	/* Parse message */
-	gst_message_parse_buffering(msg, &percent);
+	INFO("Reconnecting to '%s' in the background", priv->stream_uri);
 
-	/* Display buffering steps 20 by 20 */
-	if (ABS(percent - prev_percent) > 20) {
-		prev_percent = percent;
-		DEBUG("Buffering (%3u %%)", percent);
-	}
+	replacement->engine = self;
+	g_signal_connect(replacement->bus, "message::buffering",
+	                 G_CALLBACK(on_replacement_bus_message_buffering), replacement);
+	g_signal_connect(replacement->bus, "message::eos",
+	                 G_CALLBACK(on_replacement_bus_message_failure), replacement);
+	g_signal_connect(replacement->bus, "message::error",
+	                 G_CALLBACK(on_replacement_bus_message_failure), replacement);
 
-	/* Now, let's react according to our current state */
-	switch (priv->state) {
-	case GV_ENGINE_STATE_STOPPED:
-		/* This shouldn't happen */
-		WARNING("Received 'bus buffering' while stopped");
-		break;
+	priv->replacement = replacement;
 
-	case GV_ENGINE_STATE_CONNECTING:
-		/* We successfully connected! */
-		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+	return TRUE;
+}
 
-		/* NO BREAK HERE!
-		 * This is to handle the (very special) case where the first
-		 * buffering message received is already 100%. I'm not sure this
-		 * can happen, but it doesn't hurt to be ready.
-		 *
-		 * To avoid warnings, the next line could be:
-		 * __attribute__((fallthrough));
-		 *
-		 * However this is gcc-7 only, and I don't know about clang.
-		 * So we use a more portable (and more magic) marker comment.
-		 */
-		// fall through
+/*
+ * Public methods
+ */
 
-	case GV_ENGINE_STATE_BUFFERING:
-		/* When buffering complete, start playing */
-		if (percent >= 100) {
-			DEBUG("Buffering complete, starting playback");
-			set_gst_state(priv->playbin, GST_STATE_PLAYING);
-			gv_engine_set_state(self, GV_ENGINE_STATE_PLAYING);
-			priv->error_count = 0;
-		}
-		break;
+void
+gv_engine_play(GvEngine *self, GvStation *station)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvEngineStandby *standby;
+	const gchar *station_stream_uri;
 
-	case GV_ENGINE_STATE_PLAYING:
-		/* In case buffering is < 100%, according to the documentation,
-		 * we should pause. However, more than often, I constantly
-		 * receive 'buffering < 100%' messages. In such cases, following
-		 * the doc and pausing/playing makes constantly cuts the sound.
-		 * While ignoring the messages works just fine, do let's ignore
-		 * for now.
-		 */
-		if (percent < 100) {
-			DEBUG("Buffering < 100%%, ignoring instead of setting to pause");
-			//set_gst_state(priv->playbin, GST_STATE_PAUSED);
-			//gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
-		}
-		break;
+	g_return_if_fail(station != NULL);
 
-	default:
-		WARNING("Unhandled engine state %d", priv->state);
+	/* Station must have a stream uri */
+	station_stream_uri = gv_engine_pick_stream_uri(self, station);
+	if (station_stream_uri == NULL) {
+		WARNING("Station '%s' has no stream uri",
+		        gv_station_get_name_or_uri(station));
+		return;
 	}
-}
 
-static void
-on_bus_message_state_changed(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
-                             GvEngine *self G_GNUC_UNUSED)
-{
-#ifdef DEBUG_GST_STATE_CHANGES
-	GstState old, new, pending;
+	/* Cleanup error handling */
+	priv->failover_count = 0;
+	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
+	gv_reconnect_scheduler_cancel(priv->reconnect_scheduler);
 
-	/* Parse message */
-	gst_message_parse_state_changed(msg, &old, &new, &pending);
+	/* Set station, forget about the previous stream */
+	gv_engine_set_station(self, station);
+	gv_engine_set_stream_uri(self, station_stream_uri);
+	gv_engine_unset_streaminfo(self);
+	gv_engine_unset_metadata(self);
 
-	/* Just used for debug */
-	DEBUG("Gst state changed: old: %s, new: %s, pending: %s",
-	      gst_element_state_get_name(old),
-	      gst_element_state_get_name(new),
-	      gst_element_state_get_name(pending));
-#else
-	(void) msg;
-#endif
+	/* Forget about a previous race or reconnection */
+	gv_engine_clear_racers(self);
+	gv_engine_drop_replacement(self);
+	gv_engine_finish_crossfade(self);
+
+	/* If there's a standby pipeline for this station, use it */
+	standby = gv_engine_take_standby(self, station, station_stream_uri);
+	if (standby) {
+		gv_engine_promote_standby(self, standby, FALSE);
+		return;
+	}
+
+	/* If we don't know which stream is the best, let them race */
+	if (gv_engine_race_streams(self, station))
+		return;
+
+	/* According to the doc:
+	 *
+	 * > State changes to GST_STATE_READY or GST_STATE_NULL never return
+	 * > GST_STATE_CHANGE_ASYNC.
+	 *
+	 * https://gstreamer.freedesktop.org/documentation/gstreamer/gstelement.html#gst_element_set_state
+	 */
+
+	/* Ensure playback is stopped */
+	set_gst_state(priv->playbin, GST_STATE_NULL);
+
+	/* Set the stream uri */
+	g_object_set(priv->playbin, "uri", station_stream_uri, NULL);
+
+	/* Go to the ready stop (not sure it's needed) */
+	set_gst_state(priv->playbin, GST_STATE_READY);
+
+	/* Set gst state to PAUSE, so that the playbin starts buffering data.
+	 * Playback will start as soon as buffering is finished.
+	 */
+	set_gst_state(priv->playbin, GST_STATE_PAUSED);
+	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+	priv->connect_time = g_get_monotonic_time();
 }
 
-static void
-on_bus_message_stream_start(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
-                            GvEngine *self)
+void
+gv_engine_stop(GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
-	GstElement *playbin = priv->playbin;
-	GstPad *pad = NULL;
 
-	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
-	DEBUG("Stream started");
+	/* Cleanup error handling */
+	priv->failover_count = 0;
+	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
+	gv_reconnect_scheduler_cancel(priv->reconnect_scheduler);
+	g_clear_handle_id(&priv->buffer_stable_timeout_id, g_source_remove);
 
-	g_signal_emit_by_name(playbin, "get-audio-pad", 0, &pad);
-	gv_engine_update_streaminfo_from_audio_pad(self, pad);
+	/* Drop other pipelines, no need to waste bandwidth */
+	gv_engine_prune_standbys(self, 0);
+	gv_engine_clear_racers(self);
+	gv_engine_drop_replacement(self);
+	gv_engine_finish_crossfade(self);
 
-	if (pad != NULL)
-		g_signal_connect_object(pad, "notify::caps",
-				G_CALLBACK(on_playbin_audio_pad_notify_caps), self, 0);
+	/* Radical way to stop: set state to NULL */
+	set_gst_state(priv->playbin, GST_STATE_NULL);
+	gv_engine_set_state(self, GV_ENGINE_STATE_STOPPED);
+	gv_engine_unset_streaminfo(self);
+	gv_engine_unset_metadata(self);
 }
 
-static void
-on_bus_message_application(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
-                           GvEngine *self)
+void
+gv_engine_preroll(GvEngine *self, GvStation *station)
 {
 	GvEnginePrivate *priv = self->priv;
-	const GstStructure *s;
-	const gchar *msg_name;
+	GvEngineStandby *standby;
+	const gchar *station_stream_uri;
 
-	TRACE("... %s, %p", GST_MESSAGE_SRC_NAME(msg), self);
+	g_return_if_fail(station != NULL);
 
-	s = gst_message_get_structure(msg);
-	msg_name = gst_structure_get_name(s);
-	g_return_if_fail(msg_name != NULL);
+	if (priv->standby_pipelines == 0)
+		return;
 
-	if (!g_strcmp0(msg_name, "audio-caps-changed")) {
-		GstElement *playbin = priv->playbin;
-		GstPad *pad = NULL;
+	if (station == priv->station)
+		return;
 
-		g_signal_emit_by_name(playbin, "get-audio-pad", 0, &pad);
-		gv_engine_update_streaminfo_from_audio_pad(self, pad);
-	} else {
-		WARNING("Unhandled application message %s", msg_name);
+	/* Station must have a stream uri */
+	station_stream_uri = gv_engine_pick_stream_uri(self, station);
+	if (station_stream_uri == NULL) {
+		DEBUG("Station '%s' has no stream uri, can't preroll",
+		      gv_station_get_name_or_uri(station));
+		return;
+	}
+
+	/* Reuse the standby pipeline if any, otherwise make a new one. It's
+	 * dropped when it fails, or when it's been waiting for too long.
+	 */
+	standby = gv_engine_take_standby(self, station, station_stream_uri);
+	if (standby == NULL) {
+		standby = gv_engine_standby_new(self, station, station_stream_uri);
+		if (standby == NULL)
+			return;
+
+		standby->engine = self;
+		standby->expire_timeout_id =
+		        g_timeout_add_seconds(STANDBY_TIMEOUT, when_timeout_expire_standby,
+		                              standby);
+		g_signal_connect(standby->bus, "message::eos",
+		                 G_CALLBACK(on_standby_bus_message_dropped), standby);
+		g_signal_connect(standby->bus, "message::error",
+		                 G_CALLBACK(on_standby_bus_message_dropped), standby);
 	}
+
+	/* Most recent first, and drop the least recent if needed */
+	priv->standbys = g_list_prepend(priv->standbys, standby);
+	gv_engine_prune_standbys(self, priv->standby_pipelines);
+}
+
+GvEngine *
+gv_engine_new(void)
+{
+	return g_object_new(GV_TYPE_ENGINE, NULL);
 }
 
 /*
@@ -1094,16 +2325,17 @@ gv_engine_finalize(GObject *object)
 
 	/* Remove pending operations */
 	g_clear_handle_id(&priv->start_playback_timeout_id, g_source_remove);
+	g_clear_handle_id(&priv->buffer_stable_timeout_id, g_source_remove);
+	g_clear_object(&priv->reconnect_scheduler);
 
-	/* Stop playback */
-	set_gst_state(priv->playbin, GST_STATE_NULL);
-
-	/* Unref the bus */
-	gst_bus_remove_signal_watch(priv->bus);
-	gst_object_unref(priv->bus);
+	/* Drop other pipelines */
+	gv_engine_prune_standbys(self, 0);
+	gv_engine_clear_racers(self);
+	gv_engine_drop_replacement(self);
+	gv_engine_finish_crossfade(self);
 
-	/* Unref the playbin */
-	gst_object_unref(priv->playbin);
+	/* Stop playback, unref the playbin and the bus */
+	gv_engine_detach_playbin(self);
 
 	/* Unref metadata */
 	g_clear_object(&priv->station);
@@ -1111,6 +2343,9 @@ gv_engine_finalize(GObject *object)
 	gv_clear_metadata(&priv->metadata);
 
 	/* Free resources */
+	g_hash_table_destroy(priv->stream_ttfbs);
+	g_hash_table_destroy(priv->good_stream_uris);
+	g_free(priv->stream_uri);
 	g_free(priv->pipeline_string);
 
 	/* Chain up */
@@ -1123,7 +2358,6 @@ gv_engine_constructed(GObject *object)
 	GvEngine *self = GV_ENGINE(object);
 	GvEnginePrivate *priv = self->priv;
 	GstElement *playbin;
-	GstElement *fakesink;
 	GstBus *bus;
 
 	/* Initialize properties */
@@ -1131,51 +2365,41 @@ gv_engine_constructed(GObject *object)
 	priv->mute   = DEFAULT_MUTE;
 	priv->pipeline_enabled = FALSE;
 	priv->pipeline_string  = NULL;
+	priv->standby_pipelines = DEFAULT_STANDBY_PIPELINES;
+	priv->race_streams = DEFAULT_RACE_STREAMS;
+	priv->buffer_low_watermark = DEFAULT_BUFFER_LOW_WATERMARK;
+	priv->buffer_high_watermark = DEFAULT_BUFFER_HIGH_WATERMARK;
+	priv->buffer_duration = MIN_BUFFER_DURATION;
+
+	/* Streams that worked, indexed by station uri */
+	priv->good_stream_uris = g_hash_table_new_full(g_str_hash, g_str_equal,
+	                                               g_free, g_free);
+
+	/* Time to first data, indexed by stream uri */
+	priv->stream_ttfbs = g_hash_table_new_full(g_str_hash, g_str_equal,
+	                                           g_free, NULL);
+
+	/* Schedule reconnections according to the network state */
+	priv->reconnect_scheduler = gv_reconnect_scheduler_new(NULL);
+	g_signal_connect_object(priv->reconnect_scheduler, "reconnect",
+	                        G_CALLBACK(on_reconnect_scheduler_reconnect),
+	                        self, 0);
 
 	/* GStreamer must be initialized, let's check that */
 	g_assert(gst_is_initialized());
 
-	/* Make the playbin - returns floating ref */
-	playbin = gst_element_factory_make("playbin", "playbin");
-	g_assert_nonnull(playbin);
-	priv->playbin = g_object_ref_sink(playbin);
-
-	/* Disable video - returns floating ref */
-	fakesink = gst_element_factory_make("fakesink", "fakesink");
-	g_assert_nonnull(fakesink);
-	g_object_set(playbin, "video-sink", fakesink, NULL);
-
-	/* Connect playbin signal handlers */
-	g_signal_connect_object(playbin, "source-setup",
-		G_CALLBACK(on_playbin_source_setup), self, 0);
+	/* Make the playbin */
+	playbin = make_playbin("playbin");
 
 	/* Get a reference to the message bus - returns full ref */
 	bus = gst_element_get_bus(playbin);
 	g_assert_nonnull(bus);
-	priv->bus = bus;
 
 	/* Add a bus signal watch (so that 'message' signals are emitted) */
 	gst_bus_add_signal_watch(bus);
 
-	/* Connect bus signal handlers */
-	g_signal_connect_object(bus, "message::eos",
-	                        G_CALLBACK(on_bus_message_eos), self, 0);
-	g_signal_connect_object(bus, "message::error",
-	                        G_CALLBACK(on_bus_message_error), self, 0);
-	g_signal_connect_object(bus, "message::warning",
-	                        G_CALLBACK(on_bus_message_warning), self, 0);
-	g_signal_connect_object(bus, "message::info",
-	                        G_CALLBACK(on_bus_message_info), self, 0);
-	g_signal_connect_object(bus, "message::tag",
-	                        G_CALLBACK(on_bus_message_tag), self, 0);
-	g_signal_connect_object(bus, "message::buffering",
-	                        G_CALLBACK(on_bus_message_buffering), self, 0);
-	g_signal_connect_object(bus, "message::state-changed",
-	                        G_CALLBACK(on_bus_message_state_changed), self, 0);
-	g_signal_connect_object(bus, "message::stream-start",
-	                        G_CALLBACK(on_bus_message_stream_start), self, 0);
-	g_signal_connect_object(bus, "message::application",
-	                        G_CALLBACK(on_bus_message_application), self, 0);
+	/* Take ownership and connect signal handlers */
+	gv_engine_attach_playbin(self, playbin, bus);
 
 	/* Chain up */
 	G_OBJECT_CHAINUP_CONSTRUCTED(gv_engine, object);
@@ -1245,6 +2469,26 @@ gv_engine_class_init(GvEngineClass *class)
 	        g_param_spec_string("pipeline-string", "Custom pipeline string", NULL, NULL,
 	                            GV_PARAM_READWRITE);
 
+	properties[PROP_STANDBY_PIPELINES] =
+	        g_param_spec_uint("standby-pipelines", "Max number of standby pipelines", NULL,
+	                          0, MAX_STANDBY_PIPELINES, DEFAULT_STANDBY_PIPELINES,
+	                          GV_PARAM_READWRITE);
+
+	properties[PROP_RACE_STREAMS] =
+	        g_param_spec_uint("race-streams", "Number of streams to race", NULL,
+	                          0, MAX_RACE_STREAMS, DEFAULT_RACE_STREAMS,
+	                          GV_PARAM_READWRITE);
+
+	properties[PROP_BUFFER_LOW_WATERMARK] =
+	        g_param_spec_uint("buffer-low-watermark", "Buffer low watermark in percent", NULL,
+	                          0, 99, DEFAULT_BUFFER_LOW_WATERMARK,
+	                          GV_PARAM_READWRITE);
+
+	properties[PROP_BUFFER_HIGH_WATERMARK] =
+	        g_param_spec_uint("buffer-high-watermark", "Buffer high watermark in percent", NULL,
+	                          1, 100, DEFAULT_BUFFER_HIGH_WATERMARK,
+	                          GV_PARAM_READWRITE);
+
 	g_object_class_install_properties(object_class, PROP_N, properties);
 
 	/* Signals */
@@ -1252,4 +2496,9 @@ gv_engine_class_init(GvEngineClass *class)
 	        g_signal_new("ssl-failure", G_TYPE_FROM_CLASS(class),
 	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
 			     G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_STRING);
+
+	signals[SIGNAL_FAILOVER] =
+	        g_signal_new("failover", G_TYPE_FROM_CLASS(class),
+	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+	                     G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_STRING);
 }
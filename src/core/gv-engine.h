@@ -48,6 +48,7 @@ typedef enum {
 GvEngine *gv_engine_new (void);
 void      gv_engine_play(GvEngine *self, GvStation *station);
 void      gv_engine_stop(GvEngine *self);
+void      gv_engine_preroll(GvEngine *self, GvStation *station);
 
 /* Property accessors */
 
@@ -62,3 +63,11 @@ gboolean       gv_engine_get_pipeline_enabled(GvEngine *self);
 void           gv_engine_set_pipeline_enabled(GvEngine *self, gboolean enabled);
 const gchar   *gv_engine_get_pipeline_string (GvEngine *self);
 void           gv_engine_set_pipeline_string (GvEngine *self, const gchar *pipeline);
+guint          gv_engine_get_standby_pipelines(GvEngine *self);
+void           gv_engine_set_standby_pipelines(GvEngine *self, guint count);
+guint          gv_engine_get_race_streams    (GvEngine *self);
+void           gv_engine_set_race_streams    (GvEngine *self, guint count);
+guint          gv_engine_get_buffer_low_watermark (GvEngine *self);
+void           gv_engine_set_buffer_low_watermark (GvEngine *self, guint percent);
+guint          gv_engine_get_buffer_high_watermark(GvEngine *self);
+void           gv_engine_set_buffer_high_watermark(GvEngine *self, guint percent);
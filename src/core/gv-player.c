@@ -45,6 +45,10 @@
 #define DEFAULT_REPEAT   FALSE
 #define DEFAULT_SHUFFLE  FALSE
 #define DEFAULT_AUTOPLAY FALSE
+#define DEFAULT_STANDBY_PIPELINES 1
+#define DEFAULT_RACE_STREAMS      3
+#define DEFAULT_BUFFER_LOW_WATERMARK  10
+#define DEFAULT_BUFFER_HIGH_WATERMARK 100
 
 enum {
 	/* Reserved */
@@ -59,6 +63,10 @@ enum {
 	PROP_MUTE,
 	PROP_PIPELINE_ENABLED,
 	PROP_PIPELINE_STRING,
+	PROP_STANDBY_PIPELINES,
+	PROP_RACE_STREAMS,
+	PROP_BUFFER_LOW_WATERMARK,
+	PROP_BUFFER_HIGH_WATERMARK,
 	/* Properties */
 	PROP_STATE,
 	PROP_REPEAT,
@@ -80,6 +88,7 @@ static GParamSpec *properties[PROP_N];
 
 enum {
         SIGNAL_SSL_FAILURE,
+        SIGNAL_FAILOVER,
         /* Number of signals */
         SIGNAL_N
 };
@@ -106,6 +115,10 @@ struct _GvPlayerPrivate {
 	gboolean       autoplay;
 	/* Current station */
 	GvStation     *station;
+	/* Work in progress for the current station */
+	GCancellable  *cancellable;
+	gboolean       downloaded;
+	gchar         *first_stream_uri;
 	/* Wished state */
 	GvPlayerWish   wish;
 };
@@ -127,6 +140,30 @@ G_DEFINE_TYPE_WITH_CODE(GvPlayer, gv_player, G_TYPE_OBJECT,
                                         gv_player_configurable_interface_init)
                         G_IMPLEMENT_INTERFACE(GV_TYPE_ERRORABLE, NULL))
 
+/*
+ * Private methods
+ */
+
+static void
+gv_player_cancel_pending(GvPlayer *self)
+{
+	GvPlayerPrivate *priv = self->priv;
+
+	/* Abort whatever is still running for the previous target,
+	 * so that it doesn't compete for bandwidth with the next one.
+	 */
+	if (priv->cancellable) {
+		g_cancellable_cancel(priv->cancellable);
+		g_object_unref(priv->cancellable);
+	}
+
+	priv->cancellable = g_cancellable_new();
+
+	/* Whatever we knew about this play is over */
+	priv->downloaded = FALSE;
+	g_clear_pointer(&priv->first_stream_uri, g_free);
+}
+
 /*
  * Signal handlers
  */
@@ -146,12 +183,21 @@ on_station_notify(GvStation *station,
 	g_assert(station == priv->station);
 
 	if (!g_strcmp0(property_name, "stream-uris")) {
+		GSList *uris = gv_station_get_stream_uris(station);
+
 		DEBUG("Station %p: stream URIs have changed", station);
 
-		/* Check if there are some streams, and start playing if needed */
-		if (gv_station_get_stream_uris(station))
-			if (priv->wish == GV_PLAYER_WISH_TO_PLAY)
+		/* Check if there are some streams, and start playing if needed.
+		 * While a playlist is downloading, the first stream comes first,
+		 * then the whole list. If the list was only extended, the engine
+		 * is fine, it will pick up the new streams on failover. If it was
+		 * replaced (say the station uri was changed), we restart.
+		 */
+		if (uris && priv->wish == GV_PLAYER_WISH_TO_PLAY) {
+			if (gv_engine_get_state(priv->engine) == GV_ENGINE_STATE_STOPPED ||
+			    g_strcmp0(uris->data, priv->first_stream_uri))
 				gv_player_play(self);
+		}
 	}
 
 	/* In any case, we notify if something was changed in the station */
@@ -186,6 +232,18 @@ on_engine_notify(GvEngine  *engine,
 	} else if (!g_strcmp0(property_name, "pipeline-string")) {
 		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_PIPELINE_STRING]);
 
+	} else if (!g_strcmp0(property_name, "standby-pipelines")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STANDBY_PIPELINES]);
+
+	} else if (!g_strcmp0(property_name, "race-streams")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RACE_STREAMS]);
+
+	} else if (!g_strcmp0(property_name, "buffer-low-watermark")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_BUFFER_LOW_WATERMARK]);
+
+	} else if (!g_strcmp0(property_name, "buffer-high-watermark")) {
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_BUFFER_HIGH_WATERMARK]);
+
 	} else if (!g_strcmp0(property_name, "state")) {
 		GvEngineState engine_state;
 		GvPlayerState player_state;
@@ -214,6 +272,23 @@ on_engine_notify(GvEngine  *engine,
 
 		/* Set state */
 		gv_player_set_state(self, player_state);
+
+		/* Once playing, get the neighbour stations ready in standby.
+		 * Next station last, so that it's kept in priority.
+		 */
+		if (engine_state == GV_ENGINE_STATE_PLAYING) {
+			GvStation *prev = NULL;
+			GvStation *next;
+
+			if (gv_engine_get_standby_pipelines(engine) > 1)
+				prev = gv_player_get_prev_station(self);
+			next = gv_player_get_next_station(self);
+
+			if (prev)
+				gv_engine_preroll(engine, prev);
+			if (next)
+				gv_engine_preroll(engine, next);
+		}
 	}
 }
 
@@ -236,6 +311,16 @@ on_engine_ssl_failure(GvEngine *engine G_GNUC_UNUSED,
 	g_signal_emit(self, signals[SIGNAL_SSL_FAILURE], 0, error, debug);
 }
 
+static void
+on_engine_failover(GvEngine *engine G_GNUC_UNUSED,
+                   const gchar *failed_uri,
+                   const gchar *next_uri,
+                   GvPlayer *self)
+{
+	/* Just forward the signal ... */
+	g_signal_emit(self, signals[SIGNAL_FAILOVER], 0, failed_uri, next_uri);
+}
+
 /*
  * Property accessors - construct-only properties
  */
@@ -254,6 +339,7 @@ gv_player_set_engine(GvPlayer *self, GvEngine *engine)
 	g_signal_connect_object(engine, "notify", G_CALLBACK(on_engine_notify), self, 0);
 	g_signal_connect_object(engine, "error", G_CALLBACK(on_engine_error), self, 0);
 	g_signal_connect_object(engine, "ssl-failure", G_CALLBACK(on_engine_ssl_failure), self, 0);
+	g_signal_connect_object(engine, "failover", G_CALLBACK(on_engine_failover), self, 0);
 }
 
 static void
@@ -385,6 +471,70 @@ gv_player_set_pipeline_string(GvPlayer *self, const gchar *pipeline_string)
 	gv_engine_set_pipeline_string(engine, pipeline_string);
 }
 
+guint
+gv_player_get_standby_pipelines(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_standby_pipelines(engine);
+}
+
+void
+gv_player_set_standby_pipelines(GvPlayer *self, guint count)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_standby_pipelines(engine, count);
+}
+
+guint
+gv_player_get_race_streams(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_race_streams(engine);
+}
+
+void
+gv_player_set_race_streams(GvPlayer *self, guint count)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_race_streams(engine, count);
+}
+
+guint
+gv_player_get_buffer_low_watermark(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_buffer_low_watermark(engine);
+}
+
+void
+gv_player_set_buffer_low_watermark(GvPlayer *self, guint percent)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_buffer_low_watermark(engine, percent);
+}
+
+guint
+gv_player_get_buffer_high_watermark(GvPlayer *self)
+{
+	GvEngine *engine = self->priv->engine;
+
+	return gv_engine_get_buffer_high_watermark(engine);
+}
+
+void
+gv_player_set_buffer_high_watermark(GvPlayer *self, guint percent)
+{
+	GvEngine *engine = self->priv->engine;
+
+	gv_engine_set_buffer_high_watermark(engine, percent);
+}
+
 /*
  * Property accessors - player properties
  */
@@ -513,6 +663,8 @@ gv_player_set_station(GvPlayer *self, GvStation *station)
 		priv->station = NULL;
 	}
 
+	gv_player_cancel_pending(self);
+
 	if (station) {
 		priv->station = g_object_ref_sink(station);
 		g_signal_connect_object(priv->station, "notify", G_CALLBACK(on_station_notify), self, 0);
@@ -602,6 +754,18 @@ gv_player_get_property(GObject    *object,
 	case PROP_PIPELINE_STRING:
 		g_value_set_string(value, gv_player_get_pipeline_string(self));
 		break;
+	case PROP_STANDBY_PIPELINES:
+		g_value_set_uint(value, gv_player_get_standby_pipelines(self));
+		break;
+	case PROP_RACE_STREAMS:
+		g_value_set_uint(value, gv_player_get_race_streams(self));
+		break;
+	case PROP_BUFFER_LOW_WATERMARK:
+		g_value_set_uint(value, gv_player_get_buffer_low_watermark(self));
+		break;
+	case PROP_BUFFER_HIGH_WATERMARK:
+		g_value_set_uint(value, gv_player_get_buffer_high_watermark(self));
+		break;
 	case PROP_STATE:
 		g_value_set_enum(value, gv_player_get_state(self));
 		break;
@@ -661,6 +825,18 @@ gv_player_set_property(GObject      *object,
 	case PROP_PIPELINE_STRING:
 		gv_player_set_pipeline_string(self, g_value_get_string(value));
 		break;
+	case PROP_STANDBY_PIPELINES:
+		gv_player_set_standby_pipelines(self, g_value_get_uint(value));
+		break;
+	case PROP_RACE_STREAMS:
+		gv_player_set_race_streams(self, g_value_get_uint(value));
+		break;
+	case PROP_BUFFER_LOW_WATERMARK:
+		gv_player_set_buffer_low_watermark(self, g_value_get_uint(value));
+		break;
+	case PROP_BUFFER_HIGH_WATERMARK:
+		gv_player_set_buffer_high_watermark(self, g_value_get_uint(value));
+		break;
 	case PROP_REPEAT:
 		gv_player_set_repeat(self, g_value_get_boolean(value));
 		break;
@@ -694,8 +870,9 @@ gv_player_stop(GvPlayer *self)
 	/* To remember what we're doing */
 	priv->wish = GV_PLAYER_WISH_TO_STOP;
 
-	/* Stop playing */
+	/* Stop playing, and stop downloading */
 	gv_engine_stop(priv->engine);
+	gv_player_cancel_pending(self);
 }
 
 void
@@ -721,9 +898,6 @@ gv_player_play(GvPlayer *self)
 	/* To remember what we're doing */
 	priv->wish = GV_PLAYER_WISH_TO_PLAY;
 
-	/* Stop playing */
-	gv_engine_stop(priv->engine);
-
 	/* Get station data */
 	uris = gv_station_get_stream_uris(station);
 
@@ -731,8 +905,13 @@ gv_player_play(GvPlayer *self)
 	 * points to a playlist, and we need to download it.
 	 */
 	if (uris == NULL) {
+		/* Stop playing */
+		gv_engine_stop(priv->engine);
+
 		/* Download the playlist that contains the stream URIs */
-		if (!gv_station_download_playlist(station))
+		if (gv_station_download_playlist(station, priv->cancellable))
+			priv->downloaded = TRUE;
+		else
 			WARNING("Can't download playlist");
 
 		/* Downloading a playlist is an asynchronous operation.
@@ -740,8 +919,19 @@ gv_player_play(GvPlayer *self)
 		 */
 		return;
 	} else {
-		/* Play the station */
+		/* Play the station. No need to stop the engine beforehand,
+		 * it might have a standby pipeline ready for this station.
+		 */
 		gv_engine_play(priv->engine, station);
+		g_free(priv->first_stream_uri);
+		priv->first_stream_uri = g_strdup(uris->data);
+
+		/* The stream URIs might come from the playlist cache, in
+		 * which case we check in the background that they're still
+		 * up to date. No need if we just downloaded them.
+		 */
+		if (priv->downloaded == FALSE)
+			gv_station_revalidate_playlist(station, priv->cancellable);
 	}
 }
 
@@ -869,6 +1059,14 @@ gv_player_configure(GvConfigurable *configurable)
 	                self, "pipeline-enabled", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind(gv_core_settings, "pipeline-string",
 	                self, "pipeline-string", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "standby-pipelines",
+	                self, "standby-pipelines", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "race-streams",
+	                self, "race-streams", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "buffer-low-watermark",
+	                self, "buffer-low-watermark", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "buffer-high-watermark",
+	                self, "buffer-high-watermark", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind(gv_core_settings, "volume",
 	                self, "volume", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind(gv_core_settings, "mute",
@@ -901,9 +1099,14 @@ gv_player_finalize(GObject *object)
 
 	TRACE("%p", object);
 
-	/* Unref the current station */
+	/* Unref the current station, cancel what's in progress */
 	if (priv->station)
 		g_object_unref(priv->station);
+	if (priv->cancellable) {
+		g_cancellable_cancel(priv->cancellable);
+		g_object_unref(priv->cancellable);
+	}
+	g_free(priv->first_stream_uri);
 
 	/* Unref the station list */
 	g_object_unref(priv->station_list);
@@ -1003,6 +1206,26 @@ gv_player_class_init(GvPlayerClass *class)
 	                            NULL,
 	                            GV_PARAM_READWRITE);
 
+	properties[PROP_STANDBY_PIPELINES] =
+	        g_param_spec_uint("standby-pipelines", "Max number of standby pipelines", NULL,
+	                          0, 4, DEFAULT_STANDBY_PIPELINES,
+	                          GV_PARAM_READWRITE);
+
+	properties[PROP_RACE_STREAMS] =
+	        g_param_spec_uint("race-streams", "Number of streams to race", NULL,
+	                          0, 5, DEFAULT_RACE_STREAMS,
+	                          GV_PARAM_READWRITE);
+
+	properties[PROP_BUFFER_LOW_WATERMARK] =
+	        g_param_spec_uint("buffer-low-watermark", "Buffer low watermark in percent", NULL,
+	                          0, 99, DEFAULT_BUFFER_LOW_WATERMARK,
+	                          GV_PARAM_READWRITE);
+
+	properties[PROP_BUFFER_HIGH_WATERMARK] =
+	        g_param_spec_uint("buffer-high-watermark", "Buffer high watermark in percent", NULL,
+	                          1, 100, DEFAULT_BUFFER_HIGH_WATERMARK,
+	                          GV_PARAM_READWRITE);
+
 	/* Player properties */
 	properties[PROP_STATE] =
 	        g_param_spec_enum("state", "Playback state", NULL,
@@ -1053,4 +1276,9 @@ gv_player_class_init(GvPlayerClass *class)
 	        g_signal_new("ssl-failure", G_TYPE_FROM_CLASS(class),
 	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
 			     G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_STRING);
+
+	signals[SIGNAL_FAILOVER] =
+	        g_signal_new("failover", G_TYPE_FROM_CLASS(class),
+	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+	                     G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_STRING);
 }
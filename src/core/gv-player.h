@@ -88,3 +88,11 @@ gboolean     gv_player_get_pipeline_enabled(GvPlayer *self);
 void         gv_player_set_pipeline_enabled(GvPlayer *self, gboolean enabled);
 const gchar *gv_player_get_pipeline_string (GvPlayer *self);
 void         gv_player_set_pipeline_string (GvPlayer *self, const gchar *pipeline);
+guint        gv_player_get_standby_pipelines(GvPlayer *self);
+void         gv_player_set_standby_pipelines(GvPlayer *self, guint count);
+guint        gv_player_get_race_streams    (GvPlayer *self);
+void         gv_player_set_race_streams    (GvPlayer *self, guint count);
+guint        gv_player_get_buffer_low_watermark (GvPlayer *self);
+void         gv_player_set_buffer_low_watermark (GvPlayer *self, guint percent);
+guint        gv_player_get_buffer_high_watermark(GvPlayer *self);
+void         gv_player_set_buffer_high_watermark(GvPlayer *self, guint percent);
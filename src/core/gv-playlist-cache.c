@@ -0,0 +1,446 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glib-object.h>
+
+#include "base/glib-object-additions.h"
+#include "base/gv-base.h"
+#include "core/gv-playlist.h"
+
+#include "core/gv-playlist-cache.h"
+
+/*
+ * The playlist cache remembers the stream uris found in each playlist,
+ * so that stations can start playing without downloading the playlist
+ * first. Entries are considered fresh for a while (as told by the server
+ * if it sends a max-age, otherwise we pick a default). Once stale, they
+ * are still used, but the playlist is downloaded again in the background,
+ * with a conditional request.
+ *
+ * It also remembers the format of each playlist, for uris that don't tell,
+ * and whether an uri turned out to be an audio stream rather than a
+ * playlist, so that it's not downloaded again to find out.
+ */
+
+#define PLAYLIST_CACHE_FILE "playlists.cache"
+
+/* Time to live, in seconds */
+#define DEFAULT_TTL    (24 * 60 * 60)
+#define MAX_TTL        (7 * 24 * 60 * 60)
+/* Entries not refreshed for that long are dropped, in seconds */
+#define EXPIRE_PERIOD  (30 * 24 * 60 * 60)
+/* Delay before saving, in seconds */
+#define SAVE_DELAY     1
+
+#define KEY_FORMAT        "format"
+#define KEY_STREAMS       "streams"
+#define KEY_ETAG          "etag"
+#define KEY_LAST_MODIFIED "last-modified"
+#define KEY_FETCHED       "fetched"
+#define KEY_TTL           "ttl"
+
+/*
+ * GObject definitions
+ */
+
+struct _GvPlaylistCachePrivate {
+	gchar    *path;
+	GKeyFile *keyfile;
+	guint     save_timeout_id;
+};
+
+typedef struct _GvPlaylistCachePrivate GvPlaylistCachePrivate;
+
+struct _GvPlaylistCache {
+	/* Parent instance structure */
+	GObject                 parent_instance;
+	/* Private data */
+	GvPlaylistCachePrivate *priv;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(GvPlaylistCache, gv_playlist_cache, G_TYPE_OBJECT)
+
+/*
+ * Helpers
+ */
+
+static gint64
+get_now(void)
+{
+	return g_get_real_time() / G_USEC_PER_SEC;
+}
+
+static gboolean
+is_valid_group_name(const gchar *uri)
+{
+	const gchar *p;
+
+	if (uri == NULL || *uri == '\0')
+		return FALSE;
+
+	for (p = uri; *p; p++)
+		if (*p == '[' || *p == ']' || g_ascii_iscntrl(*p))
+			return FALSE;
+
+	return TRUE;
+}
+
+static gboolean
+save_keyfile(GKeyFile *keyfile, const gchar *path, GError **err)
+{
+	gboolean ret;
+	gchar *dirname;
+
+	dirname = g_path_get_dirname(path);
+	if (g_mkdir_with_parents(dirname, S_IRWXU) != 0) {
+		g_set_error(err, G_FILE_ERROR,
+		            g_file_error_from_errno(errno),
+		            "Failed to make directory: %s", g_strerror(errno));
+		ret = FALSE;
+	} else {
+		ret = g_key_file_save_to_file(keyfile, path, err);
+	}
+
+	g_free(dirname);
+	return ret;
+}
+
+static const gchar *format_names[] = {
+	[GV_PLAYLIST_FORMAT_NONE] = "stream",
+	[GV_PLAYLIST_FORMAT_M3U]  = "m3u",
+	[GV_PLAYLIST_FORMAT_PLS]  = "pls",
+	[GV_PLAYLIST_FORMAT_ASX]  = "asx",
+	[GV_PLAYLIST_FORMAT_XSPF] = "xspf",
+};
+
+static GvPlaylistFormat
+format_from_string(const gchar *str)
+{
+	guint i;
+
+	if (str == NULL)
+		return GV_PLAYLIST_FORMAT_UNKNOWN;
+
+	for (i = 0; i < G_N_ELEMENTS(format_names); i++)
+		if (format_names[i] && !g_strcmp0(str, format_names[i]))
+			return i;
+
+	return GV_PLAYLIST_FORMAT_UNKNOWN;
+}
+
+/*
+ * Signal handlers & callbacks
+ */
+
+static gboolean
+when_timeout_save(gpointer data)
+{
+	GvPlaylistCache *self = GV_PLAYLIST_CACHE(data);
+	GvPlaylistCachePrivate *priv = self->priv;
+
+	priv->save_timeout_id = 0;
+	gv_playlist_cache_save(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Private methods
+ */
+
+static void
+gv_playlist_cache_save_delayed(GvPlaylistCache *self)
+{
+	GvPlaylistCachePrivate *priv = self->priv;
+
+	if (priv->save_timeout_id != 0)
+		return;
+
+	priv->save_timeout_id = g_timeout_add_seconds(SAVE_DELAY, when_timeout_save, self);
+}
+
+/*
+ * Public methods
+ */
+
+void
+gv_playlist_cache_load(GvPlaylistCache *self)
+{
+	GvPlaylistCachePrivate *priv = self->priv;
+	GError *err = NULL;
+	gchar **groups;
+	gint64 now;
+	guint i;
+
+	if (!g_key_file_load_from_file(priv->keyfile, priv->path,
+	                               G_KEY_FILE_NONE, &err)) {
+		if (!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			WARNING("Failed to load playlist cache: %s", err->message);
+		g_clear_error(&err);
+		return;
+	}
+
+	/* Drop entries that were not refreshed for too long */
+	now = get_now();
+	groups = g_key_file_get_groups(priv->keyfile, NULL);
+	for (i = 0; groups[i]; i++) {
+		gint64 fetched;
+
+		fetched = g_key_file_get_int64(priv->keyfile, groups[i], KEY_FETCHED, NULL);
+		if (now - fetched > EXPIRE_PERIOD)
+			g_key_file_remove_group(priv->keyfile, groups[i], NULL);
+	}
+
+	DEBUG("Playlist cache loaded from '%s' (%u entries)", priv->path, i);
+	g_strfreev(groups);
+}
+
+void
+gv_playlist_cache_save(GvPlaylistCache *self)
+{
+	GvPlaylistCachePrivate *priv = self->priv;
+	GError *err = NULL;
+
+	g_clear_handle_id(&priv->save_timeout_id, g_source_remove);
+
+	if (!save_keyfile(priv->keyfile, priv->path, &err)) {
+		WARNING("Failed to save playlist cache: %s", err->message);
+		g_clear_error(&err);
+		return;
+	}
+
+	DEBUG("Playlist cache saved to '%s'", priv->path);
+}
+
+/* Get the stream uris for a playlist. Returns a new list, or NULL */
+GSList *
+gv_playlist_cache_lookup(GvPlaylistCache *self, const gchar *uri)
+{
+	GvPlaylistCachePrivate *priv = self->priv;
+	GSList *list = NULL;
+	gchar **streams;
+	guint i;
+
+	if (!is_valid_group_name(uri))
+		return NULL;
+
+	streams = g_key_file_get_string_list(priv->keyfile, uri, KEY_STREAMS, NULL, NULL);
+	if (streams == NULL)
+		return NULL;
+
+	for (i = 0; streams[i]; i++)
+		list = g_slist_prepend(list, g_strdup(streams[i]));
+	list = g_slist_reverse(list);
+
+	g_strfreev(streams);
+	return list;
+}
+
+/* Get the format of a playlist, as found out when it was downloaded */
+GvPlaylistFormat
+gv_playlist_cache_lookup_format(GvPlaylistCache *self, const gchar *uri)
+{
+	GvPlaylistCachePrivate *priv = self->priv;
+	GvPlaylistFormat format;
+	gchar *str;
+
+	if (!is_valid_group_name(uri))
+		return GV_PLAYLIST_FORMAT_UNKNOWN;
+
+	str = g_key_file_get_string(priv->keyfile, uri, KEY_FORMAT, NULL);
+	format = format_from_string(str);
+	g_free(str);
+
+	return format;
+}
+
+gboolean
+gv_playlist_cache_is_fresh(GvPlaylistCache *self, const gchar *uri)
+{
+	GvPlaylistCachePrivate *priv = self->priv;
+	gint64 fetched;
+	gint ttl;
+
+	if (!is_valid_group_name(uri))
+		return FALSE;
+
+	if (!g_key_file_has_group(priv->keyfile, uri))
+		return FALSE;
+
+	fetched = g_key_file_get_int64(priv->keyfile, uri, KEY_FETCHED, NULL);
+	ttl = g_key_file_get_integer(priv->keyfile, uri, KEY_TTL, NULL);
+
+	return get_now() < fetched + ttl;
+}
+
+/* Set the validators of a playlist before it's downloaded */
+void
+gv_playlist_cache_prepare(GvPlaylistCache *self, GvPlaylist *playlist)
+{
+	GvPlaylistCachePrivate *priv = self->priv;
+	const gchar *uri = gv_playlist_get_uri(playlist);
+	gchar *etag;
+	gchar *last_modified;
+
+	if (!is_valid_group_name(uri))
+		return;
+
+	if (!g_key_file_has_key(priv->keyfile, uri, KEY_STREAMS, NULL))
+		return;
+
+	etag = g_key_file_get_string(priv->keyfile, uri, KEY_ETAG, NULL);
+	last_modified = g_key_file_get_string(priv->keyfile, uri, KEY_LAST_MODIFIED, NULL);
+	gv_playlist_set_validators(playlist, etag, last_modified);
+
+	g_free(last_modified);
+	g_free(etag);
+}
+
+/* Store the result of a download, either new streams, or confirmation
+ * that what we have is still good.
+ */
+void
+gv_playlist_cache_store(GvPlaylistCache *self, GvPlaylist *playlist)
+{
+	GvPlaylistCachePrivate *priv = self->priv;
+	const gchar *uri = gv_playlist_get_uri(playlist);
+	GvPlaylistFormat format = gv_playlist_get_detected_format(playlist);
+	const gchar *etag;
+	const gchar *last_modified;
+	gint max_age;
+	gint ttl;
+
+	if (!is_valid_group_name(uri))
+		return;
+
+	max_age = gv_playlist_get_max_age(playlist);
+	ttl = max_age < 0 ? DEFAULT_TTL : MIN(max_age, MAX_TTL);
+
+	if (gv_playlist_get_not_modified(playlist)) {
+		if (!g_key_file_has_group(priv->keyfile, uri))
+			return;
+	} else if (format == GV_PLAYLIST_FORMAT_NONE) {
+		/* Not a playlist, there's only the format to remember */
+		g_key_file_remove_group(priv->keyfile, uri, NULL);
+	} else {
+		GSList *streams = gv_playlist_get_stream_list(playlist);
+		const gchar **strv;
+		GSList *item;
+		guint i;
+
+		if (streams == NULL)
+			return;
+
+		strv = g_new0(const gchar *, g_slist_length(streams) + 1);
+		for (i = 0, item = streams; item; i++, item = item->next)
+			strv[i] = item->data;
+
+		g_key_file_remove_group(priv->keyfile, uri, NULL);
+		g_key_file_set_string_list(priv->keyfile, uri, KEY_STREAMS, strv, i);
+		g_free(strv);
+
+		etag = gv_playlist_get_etag(playlist);
+		if (etag)
+			g_key_file_set_string(priv->keyfile, uri, KEY_ETAG, etag);
+
+		last_modified = gv_playlist_get_last_modified(playlist);
+		if (last_modified)
+			g_key_file_set_string(priv->keyfile, uri, KEY_LAST_MODIFIED, last_modified);
+	}
+
+	if (format != GV_PLAYLIST_FORMAT_UNKNOWN)
+		g_key_file_set_string(priv->keyfile, uri, KEY_FORMAT, format_names[format]);
+	g_key_file_set_int64(priv->keyfile, uri, KEY_FETCHED, get_now());
+	g_key_file_set_integer(priv->keyfile, uri, KEY_TTL, ttl);
+
+	gv_playlist_cache_save_delayed(self);
+}
+
+GvPlaylistCache *
+gv_playlist_cache_new(void)
+{
+	return g_object_new(GV_TYPE_PLAYLIST_CACHE, NULL);
+}
+
+/*
+ * GObject methods
+ */
+
+static void
+gv_playlist_cache_finalize(GObject *object)
+{
+	GvPlaylistCache *self = GV_PLAYLIST_CACHE(object);
+	GvPlaylistCachePrivate *priv = self->priv;
+
+	TRACE("%p", object);
+
+	/* Flush pending changes */
+	if (priv->save_timeout_id != 0)
+		gv_playlist_cache_save(self);
+
+	/* Free resources */
+	g_key_file_unref(priv->keyfile);
+	g_free(priv->path);
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_FINALIZE(gv_playlist_cache, object);
+}
+
+static void
+gv_playlist_cache_constructed(GObject *object)
+{
+	GvPlaylistCache *self = GV_PLAYLIST_CACHE(object);
+	GvPlaylistCachePrivate *priv = self->priv;
+
+	TRACE("%p", object);
+
+	/* Initialize */
+	priv->path = g_build_filename(gv_get_app_user_cache_dir(),
+	                              PLAYLIST_CACHE_FILE, NULL);
+	priv->keyfile = g_key_file_new();
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_CONSTRUCTED(gv_playlist_cache, object);
+}
+
+static void
+gv_playlist_cache_init(GvPlaylistCache *self)
+{
+	TRACE("%p", self);
+
+	/* Initialize private pointer */
+	self->priv = gv_playlist_cache_get_instance_private(self);
+}
+
+static void
+gv_playlist_cache_class_init(GvPlaylistCacheClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+
+	TRACE("%p", class);
+
+	/* Override GObject methods */
+	object_class->finalize = gv_playlist_cache_finalize;
+	object_class->constructed = gv_playlist_cache_constructed;
+}
@@ -0,0 +1,45 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "core/gv-playlist.h"
+
+/* GObject declarations */
+
+#define GV_TYPE_PLAYLIST_CACHE gv_playlist_cache_get_type()
+
+G_DECLARE_FINAL_TYPE(GvPlaylistCache, gv_playlist_cache, GV, PLAYLIST_CACHE, GObject)
+
+/* Methods */
+
+GvPlaylistCache *gv_playlist_cache_new(void);
+
+void      gv_playlist_cache_load    (GvPlaylistCache *self);
+void      gv_playlist_cache_save    (GvPlaylistCache *self);
+GSList   *gv_playlist_cache_lookup  (GvPlaylistCache *self, const gchar *uri);
+gboolean  gv_playlist_cache_is_fresh(GvPlaylistCache *self, const gchar *uri);
+void      gv_playlist_cache_prepare (GvPlaylistCache *self, GvPlaylist *playlist);
+void      gv_playlist_cache_store   (GvPlaylistCache *self, GvPlaylist *playlist);
+
+GvPlaylistFormat gv_playlist_cache_lookup_format(GvPlaylistCache *self, const gchar *uri);
@@ -36,6 +36,7 @@
 
 #include "base/glib-object-additions.h"
 #include "base/gv-base.h"
+#include "core/gv-core-internal.h"
 
 #include "core/gv-playlist.h"
 
@@ -45,6 +46,9 @@
 // TODO   Validate URI, send an error message if it's invalid ?
 //        But then, shouldn't that be done in GvStation instead ? Or not ?
 
+/* How much data to look at, to tell a playlist from an audio stream */
+#define SNIFF_SIZE 512
+
 /*
  * Properties
  */
@@ -66,6 +70,7 @@ static GParamSpec *properties[PROP_N];
  */
 
 enum {
+	SIGNAL_STREAM_FOUND,
 	SIGNAL_DOWNLOADED,
 	/* Number of signals */
 	SIGNAL_N
@@ -81,6 +86,23 @@ struct _GvPlaylistPrivate {
 	gchar             *uri;
 	GvPlaylistFormat format;
 	GSList           *streams;
+	GSList           *streams_last;
+	gboolean          insecure;
+	/* Download in progress */
+	SoupMessage      *msg;
+	GCancellable     *cancellable;
+	gulong            cancelled_id;
+	/* Parsing as data arrives, and data received while
+	 * the format is not known yet.
+	 */
+	GvPlaylistParser *parser;
+	gsize             n_bytes;
+	GString          *sniffed;
+	/* HTTP caching */
+	gchar            *etag;
+	gchar            *last_modified;
+	gint              max_age;
+	gboolean          not_modified;
 };
 
 typedef struct _GvPlaylistPrivate GvPlaylistPrivate;
@@ -98,145 +120,206 @@ G_DEFINE_TYPE_WITH_PRIVATE(GvPlaylist, gv_playlist, G_TYPE_OBJECT)
  * Helpers
  */
 
-typedef GSList *(*PlaylistParser) (const gchar *, gsize);
+/* Playlists are parsed incrementally, as data arrives, so that the first
+ * stream uris are known before the whole playlist is downloaded. Text
+ * formats (M3U, PLS) are parsed line by line, while XML formats (ASX,
+ * XSPF) are fed chunk by chunk to a GMarkup parse context. Each entry is
+ * reported along with its title, if the playlist has one.
+ */
+
+struct _GvPlaylistParser {
+	GvPlaylistFormat     format;
+	GvPlaylistEntryFunc  entry_func;
+	gpointer             user_data;
+	/* Text formats: the line being received */
+	GString             *line;
+	/* XML formats */
+	GMarkupParseContext *context;
+	gboolean             failed;
+	/* Entry being parsed: its title, and the uris waiting for it */
+	gchar               *title;
+	GPtrArray           *uris;
+	gboolean             in_entry;
+	/* PLS: number of the entry being parsed */
+	guint                pls_number;
+};
+
+static void
+playlist_parser_flush_entry(GvPlaylistParser *parser)
+{
+	guint i;
+
+	for (i = 0; i < parser->uris->len; i++)
+		parser->entry_func(g_ptr_array_index(parser->uris, i),
+		                   parser->title, parser->user_data);
+
+	g_ptr_array_set_size(parser->uris, 0);
+	g_clear_pointer(&parser->title, g_free);
+}
+
+static void
+playlist_parser_set_title(GvPlaylistParser *parser, const gchar *title, gssize len)
+{
+	g_free(parser->title);
+	parser->title = g_strstrip(len < 0 ? g_strdup(title) : g_strndup(title, len));
+	if (parser->title[0] == '\0')
+		g_clear_pointer(&parser->title, g_free);
+}
 
 /* Parse a M3U playlist, which is a simple text file,
- * each line being an uri.
+ * each line being an uri. Extended M3U playlists give
+ * the title of the next uri in a '#EXTINF' comment.
  * https://en.wikipedia.org/wiki/M3U
  */
 
-static GSList *
-parse_playlist_m3u(const gchar *text, gsize text_size G_GNUC_UNUSED)
+static void
+m3u_parse_extinf(GvPlaylistParser *parser, const gchar *line)
 {
-	GSList *list = NULL;
-	const gchar *eol;
-	gchar **lines;
-	guint i;
+	gboolean quoted = FALSE;
+	const gchar *ptr;
 
-	/* Guess which delimiter is used to separate each lines.
-	 * Traditionnaly, UNIX would only use `\n`, Windows would use `\r\n`.
+	/* '#EXTINF:<length> [<attributes>],<title>', and commas
+	 * might appear within the quoted values of the attributes.
 	 */
-	if (strstr(text, "\r\n"))
-		eol = "\r\n";
-	else
-		eol = "\n";
-
-	/* Split into different lines */
-	lines = g_strsplit(text, eol, -1);
-	if (lines == NULL) {
-		WARNING("Empty m3u playlist");
-		return NULL;
+	for (ptr = line; *ptr; ptr++) {
+		if (*ptr == '"')
+			quoted = !quoted;
+		else if (*ptr == ',' && !quoted)
+			break;
 	}
 
-	/* Iterate on lines */
-	for (i = 0; lines[i] != NULL; i++) {
-		gchar *line = lines[i];
-
-		/* Remove leading & trailing whitespaces */
-		line = g_strstrip(line);
+	if (*ptr == ',')
+		playlist_parser_set_title(parser, ptr + 1, -1);
+}
 
-		/* Ignore emtpy lines and comments */
-		if (line[0] == '\0' || line[0] == '#')
-			continue;
+static void
+m3u_parse_line(GvPlaylistParser *parser, gchar *line)
+{
+	/* Remove leading & trailing whitespaces, including a `\r`
+	 * if lines are terminated the Windows way.
+	 */
+	line = g_strstrip(line);
 
-		/* If it's not an URI, we discard it */
-		if (!strstr(line, "://"))
-			continue;
+	/* Ignore emtpy lines and comments, but keep titles */
+	if (line[0] == '\0')
+		return;
 
-		/* Add to stream list */
-		list = g_slist_append(list, g_strdup(line));
+	if (line[0] == '#') {
+		if (!g_ascii_strncasecmp(line, "#EXTINF:", 8))
+			m3u_parse_extinf(parser, line + 8);
+		return;
 	}
 
-	g_strfreev(lines);
-	return list;
+	/* If it's not an URI, we discard it */
+	if (!strstr(line, "://"))
+		return;
+
+	g_ptr_array_add(parser->uris, g_strdup(line));
+	playlist_parser_flush_entry(parser);
 }
 
 /* Parse a PLS playlist, which is a "Desktop Entry File" in the Unix world,
- * or an "INI File" in the windows realm.
+ * or an "INI File" in the windows realm. We only care about the `FileN=`
+ * and `TitleN=` lines, and take them in order of appearance. An entry is
+ * complete once its title is known, or when the next entry starts.
  * https://en.wikipedia.org/wiki/PLS_(file_format)
  */
 
-static guint
-pls_get_n_items(GKeyFile *keyfile)
+static gchar *
+pls_parse_key(gchar *line, const gchar *key, guint *number)
 {
-	const gchar *keys[] = { "NumberOfEntries", "numberofentries",
-				"NumberOfEvents", "numberofevents",
-				NULL };
-	const gchar **ptr;
-	const gchar *key = NULL;
-	GError *err = NULL;
-	gint n_items;
+	gsize key_len = strlen(key);
+	gchar *ptr;
 
-	for (ptr = keys; *ptr; ptr++) {
-		if (g_key_file_has_key(keyfile, "playlist", *ptr, NULL)) {
-			key = *ptr;
-			break;
-		}
-	}
+	if (g_ascii_strncasecmp(line, key, key_len))
+		return NULL;
 
-	if (key == NULL) {
-		WARNING("Failed to get the number of items in pls playlist");
-		return 0;
-	}
+	for (ptr = line + key_len; g_ascii_isdigit(*ptr); ptr++)
+		;
 
-	n_items = g_key_file_get_integer(keyfile, "playlist", key, &err);
-	if (err) {
-		WARNING("Failed to get key '%s': %s", key, err->message);
-		g_error_free(err);
-		return 0;
-	}
+	if (ptr == line + key_len)
+		return NULL;
 
-	return n_items;
-}
+	*number = (guint) g_ascii_strtoull(line + key_len, NULL, 10);
 
-static GSList *
-parse_playlist_pls(const gchar *text, gsize text_size)
-{
-	GSList *list = NULL;
-	GKeyFile *keyfile;
-	GError *err = NULL;
-	guint i, n_items;
+	while (*ptr == ' ' || *ptr == '\t')
+		ptr++;
 
-	keyfile = g_key_file_new();
+	if (*ptr != '=')
+		return NULL;
 
-	/* Parse the file */
-	g_key_file_load_from_data(keyfile, text, text_size, 0, &err);
-	if (err) {
-		WARNING("Failed to parse pls playlist: %s", err->message);
-		g_error_free(err);
-		goto end;
-	}
+	/* Get the value */
+	ptr = g_strstrip(ptr + 1);
+	if (*ptr == '\0')
+		return NULL;
 
-	/* Get the number of items */
-	n_items = pls_get_n_items(keyfile);
-	if (n_items == 0)
-		goto end;
+	return ptr;
+}
 
-	/* Get all stream uris */
-	for (i = 0; i < n_items; i++) {
-		gchar key[8];
-		gchar *str;
+static void
+pls_parse_line(GvPlaylistParser *parser, gchar *line)
+{
+	gboolean has_uri = parser->uris->len > 0;
+	gchar *value;
+	guint number;
+
+	line = g_strstrip(line);
+
+	if ((value = pls_parse_key(line, "file", &number))) {
+		/* A new entry starts, the previous one has no title */
+		if (has_uri)
+			playlist_parser_flush_entry(parser);
+		else if (parser->title && number != parser->pls_number)
+			g_clear_pointer(&parser->title, g_free);
+
+		g_ptr_array_add(parser->uris, g_strdup(value));
+		parser->pls_number = number;
+		if (parser->title)
+			playlist_parser_flush_entry(parser);
+	} else if ((value = pls_parse_key(line, "title", &number))) {
+		if (has_uri && number != parser->pls_number)
+			playlist_parser_flush_entry(parser);
+
+		playlist_parser_set_title(parser, value, -1);
+		parser->pls_number = number;
+		if (parser->uris->len > 0)
+			playlist_parser_flush_entry(parser);
+	}
+}
 
-		g_snprintf(key, sizeof key, "File%u", i + 1);
+/* Markup helpers, for XML formats. Uris that are found outside
+ * of an entry are reported at once, without a title.
+ */
 
-		str = g_key_file_get_string(keyfile, "playlist", key, &err);
-		if (err) {
-			WARNING("Failed to get '%s': %s", key, err->message);
-			g_error_free(err);
-			err = NULL;
-			continue;
-		}
+static void
+markup_add_uri(GvPlaylistParser *parser, const gchar *uri, gssize len)
+{
+	gchar *str;
 
-		/* Add to stream list.
-		 * No need to duplicate str, it's already an allocated string.
-		 */
-		list = g_slist_append(list, str);
+	str = g_strstrip(len < 0 ? g_strdup(uri) : g_strndup(uri, len));
+	if (str[0] == '\0') {
+		g_free(str);
+		return;
 	}
 
-end:
-	g_key_file_free(keyfile);
+	g_ptr_array_add(parser->uris, str);
+	if (parser->in_entry == FALSE)
+		playlist_parser_flush_entry(parser);
+}
+
+static void
+markup_start_entry(GvPlaylistParser *parser)
+{
+	parser->in_entry = TRUE;
+	g_ptr_array_set_size(parser->uris, 0);
+	g_clear_pointer(&parser->title, g_free);
+}
 
-	return list;
+static void
+markup_end_entry(GvPlaylistParser *parser)
+{
+	parser->in_entry = FALSE;
+	playlist_parser_flush_entry(parser);
 }
 
 /* Parse an ASX (Advanced Stream Redirector) playlist.
@@ -244,148 +327,423 @@ end:
  */
 
 static void
-asx_parse_element_cb(GMarkupParseContext *context G_GNUC_UNUSED,
+asx_start_element_cb(GMarkupParseContext *context G_GNUC_UNUSED,
                      const gchar         *element_name,
                      const gchar        **attribute_names,
                      const gchar        **attribute_values,
                      gpointer             user_data,
                      GError             **err G_GNUC_UNUSED)
 {
-	GSList **llink = (GSList **) user_data;
-	const gchar *href;
+	GvPlaylistParser *parser = user_data;
 	guint i;
 
-	/* We're only interested in the 'ref' element */
+	if (!g_ascii_strcasecmp(element_name, "entry")) {
+		markup_start_entry(parser);
+		return;
+	}
+
+	/* Otherwise we're only interested in the 'ref' element */
 	if (g_ascii_strcasecmp(element_name, "ref"))
 		return;
 
 	/* Get 'href' attribute */
-	href = NULL;
 	for (i = 0; attribute_names[i]; i++) {
 		if (!g_ascii_strcasecmp(attribute_names[i], "href")) {
-			href = attribute_values[i];
+			markup_add_uri(parser, attribute_values[i], -1);
 			break;
 		}
 	}
-
-	/* Add to stream list */
-	if (href)
-		*llink = g_slist_append(*llink, g_strdup(href));
 }
 
 static void
-asx_error_cb(GMarkupParseContext *context G_GNUC_UNUSED,
-             GError              *err   G_GNUC_UNUSED,
-             gpointer             user_data)
+asx_end_element_cb(GMarkupParseContext *context G_GNUC_UNUSED,
+                   const gchar         *element_name,
+                   gpointer             user_data,
+                   GError             **err G_GNUC_UNUSED)
 {
-	GSList **llink = (GSList **) user_data;
+	GvPlaylistParser *parser = user_data;
 
-	g_slist_free_full(*llink, g_free);
-	*llink = NULL;
+	if (!g_ascii_strcasecmp(element_name, "entry"))
+		markup_end_entry(parser);
 }
 
-static GSList *
-parse_playlist_asx(const gchar *text, gsize text_size)
+static void
+asx_text_cb(GMarkupParseContext  *context,
+            const gchar          *text,
+            gsize                 text_len,
+            gpointer              user_data,
+            GError              **err G_GNUC_UNUSED)
 {
-	GMarkupParseContext *context;
-	GMarkupParser parser = {
-		asx_parse_element_cb,
-		NULL,
-		NULL,
-		NULL,
-		asx_error_cb,
-	};
-	GError *err = NULL;
-	GSList *list = NULL;
-
-	context = g_markup_parse_context_new(&parser, 0, &list, NULL);
-
-	if (!g_markup_parse_context_parse(context, text, text_size, &err)) {
-		WARNING("Failed to parse context: %s", err->message);
-		g_error_free(err);
-	}
+	GvPlaylistParser *parser = user_data;
+	const gchar *element_name;
 
-	g_markup_parse_context_free(context);
+	element_name = g_markup_parse_context_get_element(context);
 
-	return list;
+	if (parser->in_entry && !g_ascii_strcasecmp(element_name, "title"))
+		playlist_parser_set_title(parser, text, text_len);
 }
 
+static const GMarkupParser asx_markup_parser = {
+	asx_start_element_cb,
+	asx_end_element_cb,
+	asx_text_cb,
+	NULL,
+	NULL,
+};
+
 /* Parse an XSPF (XML Shareable Playlist Format) playlist.
  * https://en.wikipedia.org/wiki/XML_Shareable_Playlist_Format
  */
 
+static void
+xspf_start_element_cb(GMarkupParseContext *context G_GNUC_UNUSED,
+                      const gchar         *element_name,
+                      const gchar        **attribute_names G_GNUC_UNUSED,
+                      const gchar        **attribute_values G_GNUC_UNUSED,
+                      gpointer             user_data,
+                      GError             **err G_GNUC_UNUSED)
+{
+	GvPlaylistParser *parser = user_data;
+
+	if (!g_ascii_strcasecmp(element_name, "track"))
+		markup_start_entry(parser);
+}
+
+static void
+xspf_end_element_cb(GMarkupParseContext *context G_GNUC_UNUSED,
+                    const gchar         *element_name,
+                    gpointer             user_data,
+                    GError             **err G_GNUC_UNUSED)
+{
+	GvPlaylistParser *parser = user_data;
+
+	if (!g_ascii_strcasecmp(element_name, "track"))
+		markup_end_entry(parser);
+}
+
 static void
 xspf_text_cb(GMarkupParseContext  *context,
              const gchar          *text,
-             gsize                 text_len G_GNUC_UNUSED,
+             gsize                 text_len,
              gpointer              user_data,
              GError              **err G_GNUC_UNUSED)
 {
-	GSList **llink = (GSList **) user_data;
+	GvPlaylistParser *parser = user_data;
 	const gchar *element_name;
 
 	element_name = g_markup_parse_context_get_element(context);
 
-	/* We're only interested in the 'location' element */
-	if (g_ascii_strcasecmp(element_name, "location"))
-		return;
+	/* We're interested in the 'location' and 'title' elements */
+	if (!g_ascii_strcasecmp(element_name, "location"))
+		markup_add_uri(parser, text, text_len);
+	else if (parser->in_entry && !g_ascii_strcasecmp(element_name, "title"))
+		playlist_parser_set_title(parser, text, text_len);
+}
+
+static const GMarkupParser xspf_markup_parser = {
+	xspf_start_element_cb,
+	xspf_end_element_cb,
+	xspf_text_cb,
+	NULL,
+	NULL,
+};
 
-	/* Add to stream list */
-	*llink = g_slist_append(*llink, g_strdup(text));
+/* Generic parser */
+
+static void
+playlist_parser_parse_line(GvPlaylistParser *parser, gchar *line)
+{
+	if (parser->format == GV_PLAYLIST_FORMAT_M3U)
+		m3u_parse_line(parser, line);
+	else
+		pls_parse_line(parser, line);
 }
 
+
 static void
-xspf_error_cb(GMarkupParseContext *context G_GNUC_UNUSED,
-              GError              *err   G_GNUC_UNUSED,
-              gpointer             user_data)
+gv_playlist_clear_streams(GvPlaylist *self)
 {
-	GSList **llink = (GSList **) user_data;
+	GvPlaylistPrivate *priv = self->priv;
 
-	g_slist_free_full(*llink, g_free);
-	*llink = NULL;
+	g_slist_free_full(priv->streams, g_free);
+	priv->streams = NULL;
+	priv->streams_last = NULL;
 }
 
-static GSList *
-parse_playlist_xspf(const gchar *text, gsize text_size)
+/* Content types of playlists. HLS playlists are not lists of stations,
+ * GStreamer knows how to play them, so they're streams. M3U content types
+ * are also used for HLS though, so for those we look at the data.
+ */
+static const struct {
+	const gchar      *content_type;
+	GvPlaylistFormat  format;
+} playlist_content_types[] = {
+	{ "application/vnd.apple.mpegurl", GV_PLAYLIST_FORMAT_NONE    },
+	{ "application/x-mpegurl",         GV_PLAYLIST_FORMAT_NONE    },
+	{ "audio/x-mpegurl",               GV_PLAYLIST_FORMAT_UNKNOWN },
+	{ "audio/mpegurl",                 GV_PLAYLIST_FORMAT_UNKNOWN },
+	{ "audio/x-scpls",                 GV_PLAYLIST_FORMAT_PLS     },
+	{ "audio/scpls",                   GV_PLAYLIST_FORMAT_PLS     },
+	{ "video/x-ms-asx",                GV_PLAYLIST_FORMAT_ASX     },
+	{ "audio/x-ms-wax",                GV_PLAYLIST_FORMAT_ASX     },
+	{ "application/xspf+xml",          GV_PLAYLIST_FORMAT_XSPF    },
+};
+
+static GvPlaylistFormat
+get_format_from_content_type(const gchar *content_type)
 {
-	GMarkupParseContext *context;
-	GMarkupParser parser = {
-		NULL,
-		NULL,
-		xspf_text_cb,
-		NULL,
-		xspf_error_cb,
-	};
-	GError *err = NULL;
-	GSList *list = NULL;
-
-	context = g_markup_parse_context_new(&parser, 0, &list, NULL);
-
-	if (!g_markup_parse_context_parse(context, text, text_size, &err)) {
-		WARNING("Failed to parse context: %s", err->message);
-		g_error_free(err);
-	}
+	guint i;
+
+	if (content_type == NULL)
+		return GV_PLAYLIST_FORMAT_UNKNOWN;
+
+	for (i = 0; i < G_N_ELEMENTS(playlist_content_types); i++)
+		if (!g_ascii_strcasecmp(content_type, playlist_content_types[i].content_type))
+			return playlist_content_types[i].format;
+
+	/* Any other audio content is a stream */
+	if (!g_ascii_strncasecmp(content_type, "audio/", 6) ||
+	    !g_ascii_strcasecmp(content_type, "application/ogg"))
+		return GV_PLAYLIST_FORMAT_NONE;
+
+	/* Servers are not always right, or precise, so we'll look at the data */
+	return GV_PLAYLIST_FORMAT_UNKNOWN;
+}
+
+/* Get the max-age directive of the Cache-Control header, if any */
+static gint
+get_max_age(SoupMessageHeaders *headers)
+{
+	const gchar *cache_control;
+	const gchar *value;
+	GHashTable *params;
+	gint max_age = -1;
+
+	cache_control = soup_message_headers_get_list(headers, "Cache-Control");
+	if (cache_control == NULL)
+		return -1;
+
+	params = soup_header_parse_param_list(cache_control);
+	if (g_hash_table_contains(params, "no-store") ||
+	    g_hash_table_contains(params, "no-cache"))
+		max_age = 0;
+	else if ((value = g_hash_table_lookup(params, "max-age")) != NULL)
+		max_age = (gint) g_ascii_strtoll(value, NULL, 10);
+	soup_header_free_param_list(params);
+
+	return max_age < 0 ? -1 : max_age;
+}
+
+static gboolean
+check_certificate(GvPlaylist *self, SoupMessage *msg)
+{
+	GTlsCertificateFlags errors = 0;
 
-	g_markup_parse_context_free(context);
+	if (self->priv->insecure)
+		return TRUE;
 
-	return list;
+	if (soup_message_get_https_status(msg, NULL, &errors) && errors != 0)
+		return FALSE;
+
+	return TRUE;
 }
 
 /*
  * Signal handlers & callbacks
  */
 
+static void
+on_parser_entry_found(const gchar *uri, const gchar *name G_GNUC_UNUSED,
+                      gpointer user_data)
+{
+	GvPlaylist *self = GV_PLAYLIST(user_data);
+	GvPlaylistPrivate *priv = self->priv;
+
+	DEBUG(". %s", uri);
+
+	/* Keep track of the last link, playlists can be long */
+	if (priv->streams == NULL)
+		priv->streams = priv->streams_last = g_slist_prepend(NULL, g_strdup(uri));
+	else
+		priv->streams_last = g_slist_append(priv->streams_last, g_strdup(uri))->next;
+
+	g_signal_emit(self, signals[SIGNAL_STREAM_FOUND], 0, uri);
+}
+
+/* The uri turned out to be an audio stream rather than a playlist. The
+ * uri itself is the only stream, and there's no need to download it.
+ * Careful, the playlist might be finalized when this function returns,
+ * as the download completes.
+ */
+static void
+gv_playlist_found_stream(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	DEBUG("'%s' is not a playlist, but an audio stream", priv->uri);
+	priv->format = GV_PLAYLIST_FORMAT_NONE;
+
+	/* Handlers might cancel the download meanwhile */
+	g_object_ref(self);
+	on_parser_entry_found(priv->uri, NULL, self);
+	if (priv->msg)
+		soup_session_cancel_message(gv_core_soup_session, priv->msg,
+		                            SOUP_STATUS_CANCELLED);
+	g_object_unref(self);
+}
+
+/* Tell the format from the first bytes received, and parse them if it's
+ * a playlist. Returns FALSE if it's not a playlist.
+ */
+static gboolean
+gv_playlist_sniff(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	GString *sniffed = priv->sniffed;
+
+	priv->sniffed = NULL;
+	priv->format = gv_playlist_sniff_format(sniffed->str, sniffed->len);
+	DEBUG("Playlist format sniffed: %d", priv->format);
+
+	if (priv->format != GV_PLAYLIST_FORMAT_NONE) {
+		priv->parser = gv_playlist_parser_new(priv->format, on_parser_entry_found, self);
+		gv_playlist_parser_feed(priv->parser, sniffed->str, sniffed->len);
+	}
+
+	g_string_free(sniffed, TRUE);
+
+	return priv->format != GV_PLAYLIST_FORMAT_NONE;
+}
+
+static void
+on_cancellable_cancelled(GCancellable *cancellable G_GNUC_UNUSED,
+                         GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	if (priv->msg == NULL)
+		return;
+
+	DEBUG("Cancelling download of playlist '%s'", priv->uri);
+	soup_session_cancel_message(gv_core_soup_session, priv->msg,
+	                            SOUP_STATUS_CANCELLED);
+}
+
+static void
+on_message_got_headers(SoupMessage *msg, GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	/* Might be called more than once, on redirections */
+	g_clear_pointer(&priv->parser, gv_playlist_parser_free);
+	if (priv->sniffed) {
+		g_string_free(priv->sniffed, TRUE);
+		priv->sniffed = NULL;
+	}
+	priv->n_bytes = 0;
+
+	/* Errors are handled on completion */
+	if (SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) == FALSE)
+		return;
+
+	if (check_certificate(self, msg) == FALSE)
+		return;
+
+	/* Ready to parse */
+	gv_playlist_clear_streams(self);
+
+	/* If the uri didn't tell the format, the content type might. Otherwise
+	 * we wait for the first bytes.
+	 */
+	if (priv->format == GV_PLAYLIST_FORMAT_UNKNOWN) {
+		const gchar *content_type;
+
+		content_type = soup_message_headers_get_content_type(msg->response_headers, NULL);
+		priv->format = get_format_from_content_type(content_type);
+		DEBUG("Playlist format from content type '%s': %d", content_type, priv->format);
+
+		if (priv->format == GV_PLAYLIST_FORMAT_NONE) {
+			gv_playlist_found_stream(self);
+			return;
+		}
+
+		if (priv->format == GV_PLAYLIST_FORMAT_UNKNOWN) {
+			priv->sniffed = g_string_sized_new(SNIFF_SIZE);
+			return;
+		}
+	}
+
+	priv->parser = gv_playlist_parser_new(priv->format, on_parser_entry_found, self);
+}
+
+static void
+on_message_got_chunk(SoupMessage *msg G_GNUC_UNUSED, SoupBuffer *chunk,
+                     GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	if (priv->sniffed) {
+		priv->n_bytes += chunk->length;
+		g_string_append_len(priv->sniffed, chunk->data, chunk->length);
+		if (priv->sniffed->len >= SNIFF_SIZE && gv_playlist_sniff(self) == FALSE)
+			gv_playlist_found_stream(self);
+		return;
+	}
+
+	if (priv->parser == NULL)
+		return;
+
+	priv->n_bytes += chunk->length;
+	gv_playlist_parser_feed(priv->parser, chunk->data, chunk->length);
+}
+
 static void
 on_message_completed(SoupSession *session,
                      SoupMessage *msg,
                      GvPlaylist *self)
 {
 	GvPlaylistPrivate *priv = self->priv;
-	PlaylistParser parser;
-	GSList *item;
 
 	TRACE("%p, %p, %p", session, msg, self);
 
+	/* Download is over */
+	priv->msg = NULL;
+	if (priv->cancellable) {
+		g_signal_handler_disconnect(priv->cancellable, priv->cancelled_id);
+		priv->cancelled_id = 0;
+		g_clear_object(&priv->cancellable);
+	}
+
+	/* Not a playlist, we stopped the download on purpose */
+	if (msg->status_code == SOUP_STATUS_CANCELLED &&
+	    priv->format == GV_PLAYLIST_FORMAT_NONE)
+		goto end;
+
+	/* Nobody cares about this playlist anymore, and what we have
+	 * might be incomplete, so drop it.
+	 */
+	if (msg->status_code == SOUP_STATUS_CANCELLED) {
+		DEBUG("Playlist download cancelled");
+		gv_playlist_clear_streams(self);
+		goto end;
+	}
+
+	/* The session is shared and doesn't enforce certificate checks,
+	 * so we do it here, unless the station is flagged insecure.
+	 */
+	if (check_certificate(self, msg) == FALSE) {
+		WARNING("Failed to download playlist: invalid certificate");
+		goto end;
+	}
+
+	/* Our copy of the playlist is still good */
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		DEBUG("Playlist not modified");
+		priv->not_modified = TRUE;
+		priv->max_age = get_max_age(msg->response_headers);
+		goto end;
+	}
+
 	/* Check the response */
 	if (SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) == FALSE) {
 		WARNING("Failed to download playlist (%u): %s",	msg->status_code, msg->reason_phrase);
@@ -411,43 +769,37 @@ on_message_completed(SoupSession *session,
 		SoupMessageHeaders *headers = msg->response_headers;
 		const gchar *content_type = NULL;
 
-		if (headers)
+		if (headers) {
 			content_type = soup_message_headers_get_content_type(headers, NULL);
+			g_free(priv->etag);
+			priv->etag = g_strdup(soup_message_headers_get_one(headers, "ETag"));
+			g_free(priv->last_modified);
+			priv->last_modified = g_strdup(soup_message_headers_get_one(headers, "Last-Modified"));
+			priv->max_age = get_max_age(headers);
+		}
 
 		DEBUG("Playlist downloaded (Content-Type: %s)", content_type);
 	}
 
-	if (msg->response_body->length == 0) {
+	if (priv->n_bytes == 0) {
 		WARNING("Empty playlist");
 		goto end;
 	}
 
-	//PRINT("%s", msg->response_body->data);
-
-	/* Get the right parser */
-	switch (priv->format) {
-	case GV_PLAYLIST_FORMAT_M3U:
-		parser = parse_playlist_m3u;
-		break;
-	case GV_PLAYLIST_FORMAT_PLS:
-		parser = parse_playlist_pls;
-		break;
-	case GV_PLAYLIST_FORMAT_ASX:
-		parser = parse_playlist_asx;
-		break;
-	case GV_PLAYLIST_FORMAT_XSPF:
-		parser = parse_playlist_xspf;
-		break;
-	default:
-		WARNING("No parser for playlist format: %d", priv->format);
+	/* Short content, the format is not known yet. If it's not a playlist,
+	 * it's not an audio stream either, but GStreamer will tell.
+	 */
+	if (priv->sniffed && gv_playlist_sniff(self) == FALSE) {
+		DEBUG("'%s' is not a playlist", priv->uri);
+		on_parser_entry_found(priv->uri, NULL, self);
 		goto end;
 	}
 
-	/* Parse */
-	if (priv->streams)
-		g_slist_free_full(priv->streams, g_free);
+	/* Most of the parsing was done while downloading */
+	if (priv->parser == NULL)
+		goto end;
 
-	priv->streams = parser(msg->response_body->data, msg->response_body->length);
+	gv_playlist_parser_end(priv->parser);
 
 	/* Was it parsed successfully ? */
 	if (priv->streams == NULL) {
@@ -455,23 +807,22 @@ on_message_completed(SoupSession *session,
 		goto end;
 	}
 
-	DEBUG("%d streams found:", g_slist_length(priv->streams));
-
-	for (item = priv->streams; item; item = item->next) {
-		DEBUG(". %s", item->data);
-	}
-
+	DEBUG("%d streams found", g_slist_length(priv->streams));
 
 end:
-	// TODO Is it ok to unref that here ?
-	g_object_unref(session);
+	g_clear_pointer(&priv->parser, gv_playlist_parser_free);
+	if (priv->sniffed) {
+		g_string_free(priv->sniffed, TRUE);
+		priv->sniffed = NULL;
+	}
 
 	/* msg needs not to be unreferenced. According to the doc,
 	 * it's consumed when using the queue() API.
 	 */
 
-	/* Emit completion signal */
+	/* Emit completion signal, then drop the ref taken for the download */
 	g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+	g_object_unref(self);
 }
 
 /*
@@ -498,12 +849,45 @@ gv_playlist_set_uri(GvPlaylist *self, const gchar *uri)
 	priv->format = gv_playlist_get_format(uri);
 }
 
+/* Format of the playlist, as told by the uri, or found out
+ * from the content once it's downloaded.
+ */
+GvPlaylistFormat
+gv_playlist_get_detected_format(GvPlaylist *self)
+{
+	return self->priv->format;
+}
+
 GSList *
 gv_playlist_get_stream_list(GvPlaylist *self)
 {
 	return self->priv->streams;
 }
 
+const gchar *
+gv_playlist_get_etag(GvPlaylist *self)
+{
+	return self->priv->etag;
+}
+
+const gchar *
+gv_playlist_get_last_modified(GvPlaylist *self)
+{
+	return self->priv->last_modified;
+}
+
+gint
+gv_playlist_get_max_age(GvPlaylist *self)
+{
+	return self->priv->max_age;
+}
+
+gboolean
+gv_playlist_get_not_modified(GvPlaylist *self)
+{
+	return self->priv->not_modified;
+}
+
 static void
 gv_playlist_get_property(GObject    *object,
                          guint       property_id,
@@ -551,22 +935,80 @@ gv_playlist_set_property(GObject      *object,
  * Public methods
  */
 
+/* Validators from a previous download, so that the server can tell us
+ * that the playlist was not modified, rather than sending it again.
+ */
 void
-gv_playlist_download(GvPlaylist *self, gboolean insecure, const gchar *user_agent)
+gv_playlist_set_validators(GvPlaylist *self, const gchar *etag,
+                           const gchar *last_modified)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	g_free(priv->etag);
+	priv->etag = g_strdup(etag);
+	g_free(priv->last_modified);
+	priv->last_modified = g_strdup(last_modified);
+}
+
+void
+gv_playlist_download(GvPlaylist *self, gboolean insecure, const gchar *user_agent,
+                     GCancellable *cancellable)
 {
 	GvPlaylistPrivate *priv = self->priv;
-	SoupSession *session;
 	SoupMessage *msg;
 
+	g_assert_nonnull(gv_core_soup_session);
+	g_assert_null(priv->msg);
+
+	if (cancellable && g_cancellable_is_cancelled(cancellable)) {
+		DEBUG("Not downloading playlist '%s', cancelled already", priv->uri);
+		g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+		return;
+	}
+
 	DEBUG("Downloading playlist '%s' (user-agent: '%s')", priv->uri, user_agent);
-	session = soup_session_new_with_options(SOUP_SESSION_SSL_STRICT, !insecure,
-	                                        SOUP_SESSION_USER_AGENT, user_agent,
-	                                        NULL);
 	msg = soup_message_new("GET", priv->uri);
+	if (msg == NULL) {
+		WARNING("Invalid playlist uri '%s'", priv->uri);
+		g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+		return;
+	}
+
+	/* The session is shared, so these are set per message */
+	priv->insecure = insecure;
+	if (user_agent)
+		soup_message_headers_replace(msg->request_headers,
+		                             "User-Agent", user_agent);
+
+	/* Conditional request, if we have something to validate */
+	priv->not_modified = FALSE;
+	if (priv->etag)
+		soup_message_headers_append(msg->request_headers,
+		                            "If-None-Match", priv->etag);
+	if (priv->last_modified)
+		soup_message_headers_append(msg->request_headers,
+		                            "If-Modified-Since", priv->last_modified);
+
+	/* Parse the body as it arrives, no need to keep it around */
+	soup_message_body_set_accumulate(msg->response_body, FALSE);
+	g_signal_connect_object(msg, "got-headers",
+	                        G_CALLBACK(on_message_got_headers), self, 0);
+	g_signal_connect_object(msg, "got-chunk",
+	                        G_CALLBACK(on_message_got_chunk), self, 0);
+
+	/* Abort at once if the download is not wanted anymore */
+	if (cancellable) {
+		priv->cancellable = g_object_ref(cancellable);
+		priv->cancelled_id = g_signal_connect(cancellable, "cancelled",
+		                                      G_CALLBACK(on_cancellable_cancelled),
+		                                      self);
+	}
 
-	soup_session_queue_message(session, msg,
+	/* Connections are reused, and limited per host by the session */
+	priv->msg = msg;
+	soup_session_queue_message(gv_core_soup_session, msg,
 	                           (SoupSessionCallback) on_message_completed,
-	                           self);
+	                           g_object_ref(self));
 }
 
 GvPlaylist *
@@ -587,6 +1029,14 @@ gv_playlist_finalize(GObject *object)
 	TRACE("%p", object);
 
 	/* Free any allocated resources */
+	if (priv->parser)
+		gv_playlist_parser_free(priv->parser);
+	if (priv->sniffed)
+		g_string_free(priv->sniffed, TRUE);
+	if (priv->streams)
+		g_slist_free_full(priv->streams, g_free);
+	g_free(priv->last_modified);
+	g_free(priv->etag);
 	g_free(priv->uri);
 
 	/* Chain up */
@@ -615,6 +1065,9 @@ gv_playlist_init(GvPlaylist *self)
 
 	/* Initialize private pointer */
 	self->priv = gv_playlist_get_instance_private(self);
+
+	/* No Cache-Control so far */
+	self->priv->max_age = -1;
 }
 
 static void
@@ -643,6 +1096,11 @@ gv_playlist_class_init(GvPlaylistClass *class)
 	g_object_class_install_properties(object_class, PROP_N, properties);
 
 	/* Signals */
+	signals[SIGNAL_STREAM_FOUND] =
+	        g_signal_new("stream-found", G_TYPE_FROM_CLASS(class),
+	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+	                     G_TYPE_NONE, 1, G_TYPE_STRING);
+
 	signals[SIGNAL_DOWNLOADED] =
 	        g_signal_new("downloaded", G_TYPE_FROM_CLASS(class),
 	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
@@ -653,6 +1111,10 @@ gv_playlist_class_init(GvPlaylistClass *class)
  * Class methods
  */
 
+/* Tell the format of a playlist from its uri. If the uri doesn't tell,
+ * the format might be known from a previous download. Otherwise it's
+ * unknown, until the playlist is downloaded.
+ */
 GvPlaylistFormat
 gv_playlist_get_format(const gchar *uri_string)
 {
@@ -689,9 +1151,193 @@ gv_playlist_get_format(const gchar *uri_string)
 		fmt = GV_PLAYLIST_FORMAT_ASX;
 	else if (!g_ascii_strcasecmp(ext, "xspf"))
 		fmt = GV_PLAYLIST_FORMAT_XSPF;
+	else if (!g_ascii_strcasecmp(ext, "m3u8") ||
+	         !g_ascii_strcasecmp(ext, "mp3") ||
+	         !g_ascii_strcasecmp(ext, "aac") ||
+	         !g_ascii_strcasecmp(ext, "ogg") ||
+	         !g_ascii_strcasecmp(ext, "opus") ||
+	         !g_ascii_strcasecmp(ext, "flac"))
+		fmt = GV_PLAYLIST_FORMAT_NONE;
 
 	/* Cleanup */
 	soup_uri_free(uri);
 
+	if (fmt != GV_PLAYLIST_FORMAT_UNKNOWN)
+		return fmt;
+
+	/* Maybe we found out already */
+	if (gv_core_playlist_cache)
+		fmt = gv_playlist_cache_lookup_format(gv_core_playlist_cache, uri_string);
+
+	/* We can only find out for uris that we can download */
+	if (fmt == GV_PLAYLIST_FORMAT_UNKNOWN && !is_uri_scheme_supported(uri_string))
+		fmt = GV_PLAYLIST_FORMAT_NONE;
+
 	return fmt;
 }
+
+/* Tell the format of a playlist from its first bytes. Returns
+ * GV_PLAYLIST_FORMAT_NONE if it doesn't look like a playlist.
+ */
+GvPlaylistFormat
+gv_playlist_sniff_format(const gchar *data, gsize len)
+{
+	GvPlaylistFormat fmt = GV_PLAYLIST_FORMAT_NONE;
+	const gchar *end;
+	const gchar *ptr;
+	gchar *head;
+
+	/* Skip the byte order mark and leading whitespaces */
+	len = MIN(len, SNIFF_SIZE);
+	end = data + len;
+	ptr = data;
+	if (len >= 3 && !memcmp(ptr, "\xef\xbb\xbf", 3))
+		ptr += 3;
+	while (ptr < end && g_ascii_isspace(*ptr))
+		ptr++;
+
+	/* Work on a nul-terminated lowercase copy */
+	head = g_ascii_strdown(ptr, end - ptr);
+
+	/* HLS playlists come with #EXT-X- tags, and they're streams */
+	if (strstr(head, "#ext-x-"))
+		fmt = GV_PLAYLIST_FORMAT_NONE;
+	else if (g_str_has_prefix(head, "#extm3u"))
+		fmt = GV_PLAYLIST_FORMAT_M3U;
+	else if (g_str_has_prefix(head, "[playlist]"))
+		fmt = GV_PLAYLIST_FORMAT_PLS;
+	else if (head[0] == '<') {
+		/* The root element might come after a prolog */
+		if (strstr(head, "<asx"))
+			fmt = GV_PLAYLIST_FORMAT_ASX;
+		else if (strstr(head, "<playlist") && strstr(head, "xspf"))
+			fmt = GV_PLAYLIST_FORMAT_XSPF;
+	} else {
+		gchar *eol;
+
+		/* A plain list of uris, as long as the first line is text */
+		eol = strchr(head, '\n');
+		if (eol)
+			*eol = '\0';
+		for (ptr = head; *ptr; ptr++)
+			if (g_ascii_iscntrl(*ptr) && !g_ascii_isspace(*ptr))
+				break;
+		if (*ptr == '\0' && strstr(head, "://"))
+			fmt = GV_PLAYLIST_FORMAT_M3U;
+	}
+
+	g_free(head);
+
+	return fmt;
+}
+
+/*
+ * Parser
+ */
+
+void
+gv_playlist_parser_feed(GvPlaylistParser *parser, const gchar *data, gsize len)
+{
+	if (parser->failed)
+		return;
+
+	if (parser->context) {
+		GError *err = NULL;
+
+		/* Entries found so far are kept, even if the end is broken */
+		if (!g_markup_parse_context_parse(parser->context, data, len, &err)) {
+			WARNING("Failed to parse context: %s", err->message);
+			g_error_free(err);
+			parser->failed = TRUE;
+		}
+	} else {
+		GString *line = parser->line;
+		gsize start = 0;
+		gchar *eol;
+
+		/* Parse every complete line, and keep the rest for later */
+		g_string_append_len(line, data, len);
+		while ((eol = memchr(line->str + start, '\n', line->len - start))) {
+			*eol = '\0';
+			playlist_parser_parse_line(parser, line->str + start);
+			start = eol - line->str + 1;
+		}
+		g_string_erase(line, 0, start);
+	}
+}
+
+/* Returns FALSE if the playlist could not be parsed entirely */
+gboolean
+gv_playlist_parser_end(GvPlaylistParser *parser)
+{
+	if (parser->failed)
+		return FALSE;
+
+	if (parser->context) {
+		GError *err = NULL;
+
+		if (!g_markup_parse_context_end_parse(parser->context, &err)) {
+			WARNING("Failed to parse context: %s", err->message);
+			g_error_free(err);
+			parser->failed = TRUE;
+		}
+	} else {
+		/* Last line, without a line terminator */
+		if (parser->line->len > 0) {
+			playlist_parser_parse_line(parser, parser->line->str);
+			g_string_truncate(parser->line, 0);
+		}
+
+		/* Last entry, that might still wait for a title */
+		playlist_parser_flush_entry(parser);
+	}
+
+	return !parser->failed;
+}
+
+void
+gv_playlist_parser_free(GvPlaylistParser *parser)
+{
+	if (parser->context)
+		g_markup_parse_context_free(parser->context);
+	if (parser->line)
+		g_string_free(parser->line, TRUE);
+	g_ptr_array_unref(parser->uris);
+	g_free(parser->title);
+	g_free(parser);
+}
+
+GvPlaylistParser *
+gv_playlist_parser_new(GvPlaylistFormat format, GvPlaylistEntryFunc entry_func,
+                       gpointer user_data)
+{
+	GvPlaylistParser *parser;
+
+	parser = g_new0(GvPlaylistParser, 1);
+	parser->format = format;
+	parser->entry_func = entry_func;
+	parser->user_data = user_data;
+	parser->uris = g_ptr_array_new_with_free_func(g_free);
+
+	switch (format) {
+	case GV_PLAYLIST_FORMAT_M3U:
+	case GV_PLAYLIST_FORMAT_PLS:
+		parser->line = g_string_new(NULL);
+		break;
+	case GV_PLAYLIST_FORMAT_ASX:
+		parser->context = g_markup_parse_context_new(&asx_markup_parser,
+		                                             0, parser, NULL);
+		break;
+	case GV_PLAYLIST_FORMAT_XSPF:
+		parser->context = g_markup_parse_context_new(&xspf_markup_parser,
+		                                             0, parser, NULL);
+		break;
+	default:
+		WARNING("No parser for playlist format: %d", format);
+		g_ptr_array_unref(parser->uris);
+		g_free(parser);
+		return NULL;
+	}
+
+	return parser;
+}
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 /* GObject declarations */
 
@@ -33,24 +34,51 @@ G_DECLARE_FINAL_TYPE(GvPlaylist, gv_playlist, GV, PLAYLIST, GObject)
 
 typedef enum {
 	GV_PLAYLIST_FORMAT_UNKNOWN,
+	GV_PLAYLIST_FORMAT_NONE, /* not a playlist, but an audio stream */
 	GV_PLAYLIST_FORMAT_M3U,
 	GV_PLAYLIST_FORMAT_PLS,
 	GV_PLAYLIST_FORMAT_ASX,
 	GV_PLAYLIST_FORMAT_XSPF
 } GvPlaylistFormat;
 
+typedef struct _GvPlaylistParser GvPlaylistParser;
+
+typedef void (*GvPlaylistEntryFunc) (const gchar *uri, const gchar *name,
+                                     gpointer user_data);
+
 /* Class methods */
 
-GvPlaylistFormat gv_playlist_get_format(const gchar *uri);
+GvPlaylistFormat gv_playlist_get_format  (const gchar *uri);
+GvPlaylistFormat gv_playlist_sniff_format(const gchar *data, gsize len);
 
 /* Methods */
 
-GvPlaylist *gv_playlist_new     (const gchar *uri);
-void        gv_playlist_download(GvPlaylist  *playlist,
-                                 gboolean     insecure,
-                                 const gchar *user_agent);
+GvPlaylist *gv_playlist_new           (const gchar *uri);
+void        gv_playlist_set_validators(GvPlaylist  *playlist,
+                                       const gchar *etag,
+                                       const gchar *last_modified);
+void        gv_playlist_download      (GvPlaylist   *playlist,
+                                       gboolean      insecure,
+                                       const gchar  *user_agent,
+                                       GCancellable *cancellable);
 
 /* Property accessors */
 
-const gchar *gv_playlist_get_uri        (GvPlaylist *self);
-GSList      *gv_playlist_get_stream_list(GvPlaylist *playlist);
+const gchar      *gv_playlist_get_uri            (GvPlaylist *self);
+GvPlaylistFormat  gv_playlist_get_detected_format(GvPlaylist *playlist);
+GSList           *gv_playlist_get_stream_list    (GvPlaylist *playlist);
+const gchar      *gv_playlist_get_etag           (GvPlaylist *playlist);
+const gchar      *gv_playlist_get_last_modified  (GvPlaylist *playlist);
+gint              gv_playlist_get_max_age        (GvPlaylist *playlist);
+gboolean          gv_playlist_get_not_modified   (GvPlaylist *playlist);
+
+/* Parser */
+
+GvPlaylistParser *gv_playlist_parser_new (GvPlaylistFormat     format,
+                                          GvPlaylistEntryFunc  entry_func,
+                                          gpointer             user_data);
+void              gv_playlist_parser_free(GvPlaylistParser    *parser);
+void              gv_playlist_parser_feed(GvPlaylistParser    *parser,
+                                          const gchar         *data,
+                                          gsize                len);
+gboolean          gv_playlist_parser_end (GvPlaylistParser    *parser);
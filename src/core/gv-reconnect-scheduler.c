@@ -0,0 +1,467 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+
+#include "base/glib-object-additions.h"
+#include "base/gv-base.h"
+
+#include "core/gv-reconnect-scheduler.h"
+
+/*
+ * The reconnect scheduler decides when to retry after a stream failed.
+ *
+ * - When the network is down, there's no point retrying, so we just wait
+ *   for it to come back, and then reconnect right away.
+ * - Otherwise the delay grows exponentially with the number of attempts,
+ *   with some jitter, so that many clients don't hammer a server in sync.
+ * - If a host keeps failing while the network is fine, the circuit breaker
+ *   opens and we leave this host alone for a while.
+ */
+
+/* Backoff, in milliseconds */
+#define MIN_BACKOFF_DELAY 500
+#define MAX_BACKOFF_DELAY 20000
+
+/* Circuit breaker: number of failures in a row, cooldown in seconds */
+#define CIRCUIT_BREAKER_THRESHOLD 5
+#define CIRCUIT_BREAKER_COOLDOWN  60
+
+/*
+ * Properties
+ */
+
+enum {
+	/* Reserved */
+	PROP_0,
+	/* Properties */
+	PROP_NETWORK_MONITOR,
+	PROP_NETWORK_AVAILABLE,
+	/* Number of properties */
+	PROP_N
+};
+
+static GParamSpec *properties[PROP_N];
+
+/*
+ * Signals
+ */
+
+enum {
+	SIGNAL_RECONNECT,
+	/* Number of signals */
+	SIGNAL_N
+};
+
+static guint signals[SIGNAL_N];
+
+/*
+ * GObject definitions
+ */
+
+struct _GvHostFailures {
+	guint  count;
+	gint64 open_until;
+};
+
+typedef struct _GvHostFailures GvHostFailures;
+
+struct _GvReconnectSchedulerPrivate {
+	/* Properties */
+	GNetworkMonitor *network_monitor;
+	gboolean         network_available;
+	/* Attempts in a row, and failures per host */
+	guint            attempts;
+	GHashTable      *host_failures;
+	/* Pending reconnection */
+	guint            timeout_id;
+	gboolean         waiting_network;
+};
+
+typedef struct _GvReconnectSchedulerPrivate GvReconnectSchedulerPrivate;
+
+struct _GvReconnectScheduler {
+	/* Parent instance structure */
+	GObject                      parent_instance;
+	/* Private data */
+	GvReconnectSchedulerPrivate *priv;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(GvReconnectScheduler, gv_reconnect_scheduler, G_TYPE_OBJECT)
+
+/*
+ * Helpers
+ */
+
+static gchar *
+get_host(const gchar *uri_string)
+{
+	SoupURI *uri;
+	gchar *host = NULL;
+
+	uri = soup_uri_new(uri_string);
+	if (uri) {
+		host = g_strdup(soup_uri_get_host(uri));
+		soup_uri_free(uri);
+	}
+
+	/* Invalid uri, at least the failures are counted */
+	if (host == NULL)
+		host = g_strdup(uri_string ? uri_string : "");
+
+	return host;
+}
+
+static guint
+compute_backoff_delay(guint attempts)
+{
+	guint delay = MIN_BACKOFF_DELAY;
+
+	while (attempts > 1 && delay < MAX_BACKOFF_DELAY) {
+		delay *= 2;
+		attempts--;
+	}
+
+	if (delay > MAX_BACKOFF_DELAY)
+		delay = MAX_BACKOFF_DELAY;
+
+	/* Equal jitter: half of the delay is fixed, the other half is random */
+	return delay / 2 + g_random_int_range(0, delay / 2 + 1);
+}
+
+/*
+ * Signal handlers & callbacks
+ */
+
+static gboolean
+when_timeout_reconnect(gpointer data)
+{
+	GvReconnectScheduler *self = GV_RECONNECT_SCHEDULER(data);
+	GvReconnectSchedulerPrivate *priv = self->priv;
+
+	priv->timeout_id = 0;
+	g_signal_emit(self, signals[SIGNAL_RECONNECT], 0);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+on_network_changed(GNetworkMonitor *monitor G_GNUC_UNUSED,
+                   gboolean available,
+                   GvReconnectScheduler *self)
+{
+	GvReconnectSchedulerPrivate *priv = self->priv;
+
+	if (priv->network_available == available)
+		return;
+
+	priv->network_available = available;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_NETWORK_AVAILABLE]);
+
+	if (available == FALSE) {
+		INFO("Network is down");
+		if (priv->timeout_id != 0) {
+			g_clear_handle_id(&priv->timeout_id, g_source_remove);
+			priv->waiting_network = TRUE;
+		}
+		return;
+	}
+
+	INFO("Network is back");
+
+	/* Whatever failed while the network was down is not to blame */
+	priv->attempts = 0;
+	g_hash_table_remove_all(priv->host_failures);
+
+	if (priv->waiting_network) {
+		priv->waiting_network = FALSE;
+		g_signal_emit(self, signals[SIGNAL_RECONNECT], 0);
+	}
+}
+
+/*
+ * Property accessors
+ */
+
+GNetworkMonitor *
+gv_reconnect_scheduler_get_network_monitor(GvReconnectScheduler *self)
+{
+	return self->priv->network_monitor;
+}
+
+static void
+gv_reconnect_scheduler_set_network_monitor(GvReconnectScheduler *self,
+                                           GNetworkMonitor *monitor)
+{
+	GvReconnectSchedulerPrivate *priv = self->priv;
+
+	/* This is a construct-only property, NULL means the default monitor */
+	g_assert_null(priv->network_monitor);
+	if (monitor == NULL)
+		monitor = g_network_monitor_get_default();
+	priv->network_monitor = g_object_ref(monitor);
+}
+
+gboolean
+gv_reconnect_scheduler_get_network_available(GvReconnectScheduler *self)
+{
+	return self->priv->network_available;
+}
+
+static void
+gv_reconnect_scheduler_get_property(GObject    *object,
+                                    guint       property_id,
+                                    GValue     *value,
+                                    GParamSpec *pspec)
+{
+	GvReconnectScheduler *self = GV_RECONNECT_SCHEDULER(object);
+
+	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_NETWORK_MONITOR:
+		g_value_set_object(value, gv_reconnect_scheduler_get_network_monitor(self));
+		break;
+	case PROP_NETWORK_AVAILABLE:
+		g_value_set_boolean(value, gv_reconnect_scheduler_get_network_available(self));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+static void
+gv_reconnect_scheduler_set_property(GObject      *object,
+                                    guint         property_id,
+                                    const GValue *value,
+                                    GParamSpec   *pspec)
+{
+	GvReconnectScheduler *self = GV_RECONNECT_SCHEDULER(object);
+
+	TRACE_SET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_NETWORK_MONITOR:
+		gv_reconnect_scheduler_set_network_monitor(self, g_value_get_object(value));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+/*
+ * Public methods
+ */
+
+/* Schedule a reconnection after the stream at `uri` failed. The "reconnect"
+ * signal is emitted when it's time to retry. Returns the delay in ms, or
+ * GV_RECONNECT_SCHEDULER_WAIT_NETWORK if we're waiting for the network.
+ */
+guint
+gv_reconnect_scheduler_schedule(GvReconnectScheduler *self, const gchar *uri)
+{
+	GvReconnectSchedulerPrivate *priv = self->priv;
+	GvHostFailures *failures;
+	gchar *host;
+	gint64 now;
+	guint delay;
+
+	g_clear_handle_id(&priv->timeout_id, g_source_remove);
+	priv->waiting_network = FALSE;
+
+	/* No network, no need to count failures */
+	if (priv->network_available == FALSE) {
+		DEBUG("Network is down, waiting for it to come back");
+		priv->waiting_network = TRUE;
+		return GV_RECONNECT_SCHEDULER_WAIT_NETWORK;
+	}
+
+	/* Exponential backoff */
+	priv->attempts++;
+	delay = compute_backoff_delay(priv->attempts);
+
+	/* Circuit breaker */
+	host = get_host(uri);
+	failures = g_hash_table_lookup(priv->host_failures, host);
+	if (failures == NULL) {
+		failures = g_new0(GvHostFailures, 1);
+		g_hash_table_insert(priv->host_failures, g_strdup(host), failures);
+	}
+
+	failures->count++;
+	now = g_get_monotonic_time();
+
+	/* Once the cooldown is over, a failure opens the circuit again */
+	if (failures->count >= CIRCUIT_BREAKER_THRESHOLD && failures->open_until <= now) {
+		INFO("Host '%s' failed %u times in a row, leaving it alone for %u seconds",
+		     host, failures->count, CIRCUIT_BREAKER_COOLDOWN);
+		failures->open_until = now + CIRCUIT_BREAKER_COOLDOWN * G_USEC_PER_SEC;
+	}
+
+	if (failures->open_until > now) {
+		guint remaining = (failures->open_until - now) / 1000;
+
+		if (delay < remaining)
+			delay = remaining;
+	}
+
+	g_free(host);
+
+	priv->timeout_id = g_timeout_add(delay, when_timeout_reconnect, self);
+
+	return delay;
+}
+
+/* The stream at `uri` is working fine, forget about past failures */
+void
+gv_reconnect_scheduler_succeeded(GvReconnectScheduler *self, const gchar *uri)
+{
+	GvReconnectSchedulerPrivate *priv = self->priv;
+	gchar *host;
+
+	priv->attempts = 0;
+
+	host = get_host(uri);
+	g_hash_table_remove(priv->host_failures, host);
+	g_free(host);
+}
+
+void
+gv_reconnect_scheduler_cancel(GvReconnectScheduler *self)
+{
+	GvReconnectSchedulerPrivate *priv = self->priv;
+
+	g_clear_handle_id(&priv->timeout_id, g_source_remove);
+	priv->waiting_network = FALSE;
+}
+
+gboolean
+gv_reconnect_scheduler_is_pending(GvReconnectScheduler *self)
+{
+	GvReconnectSchedulerPrivate *priv = self->priv;
+
+	return priv->timeout_id != 0 || priv->waiting_network;
+}
+
+GvReconnectScheduler *
+gv_reconnect_scheduler_new(GNetworkMonitor *monitor)
+{
+	return g_object_new(GV_TYPE_RECONNECT_SCHEDULER,
+	                    "network-monitor", monitor,
+	                    NULL);
+}
+
+/*
+ * GObject methods
+ */
+
+static void
+gv_reconnect_scheduler_finalize(GObject *object)
+{
+	GvReconnectScheduler *self = GV_RECONNECT_SCHEDULER(object);
+	GvReconnectSchedulerPrivate *priv = self->priv;
+
+	TRACE("%p", object);
+
+	/* Remove pending operations */
+	g_clear_handle_id(&priv->timeout_id, g_source_remove);
+
+	/* Free resources */
+	g_hash_table_destroy(priv->host_failures);
+	g_clear_object(&priv->network_monitor);
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_FINALIZE(gv_reconnect_scheduler, object);
+}
+
+static void
+gv_reconnect_scheduler_constructed(GObject *object)
+{
+	GvReconnectScheduler *self = GV_RECONNECT_SCHEDULER(object);
+	GvReconnectSchedulerPrivate *priv = self->priv;
+
+	TRACE("%p", object);
+
+	/* The network monitor might have been left unset */
+	if (priv->network_monitor == NULL)
+		gv_reconnect_scheduler_set_network_monitor(self, NULL);
+
+	/* Failures, indexed by host */
+	priv->host_failures = g_hash_table_new_full(g_str_hash, g_str_equal,
+	                                            g_free, g_free);
+
+	/* Watch the network */
+	priv->network_available =
+	        g_network_monitor_get_network_available(priv->network_monitor);
+	g_signal_connect_object(priv->network_monitor, "network-changed",
+	                        G_CALLBACK(on_network_changed), self, 0);
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_CONSTRUCTED(gv_reconnect_scheduler, object);
+}
+
+static void
+gv_reconnect_scheduler_init(GvReconnectScheduler *self)
+{
+	TRACE("%p", self);
+
+	/* Initialize private pointer */
+	self->priv = gv_reconnect_scheduler_get_instance_private(self);
+}
+
+static void
+gv_reconnect_scheduler_class_init(GvReconnectSchedulerClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+
+	TRACE("%p", class);
+
+	/* Override GObject methods */
+	object_class->finalize = gv_reconnect_scheduler_finalize;
+	object_class->constructed = gv_reconnect_scheduler_constructed;
+
+	/* Properties */
+	object_class->get_property = gv_reconnect_scheduler_get_property;
+	object_class->set_property = gv_reconnect_scheduler_set_property;
+
+	properties[PROP_NETWORK_MONITOR] =
+	        g_param_spec_object("network-monitor", "Network monitor", NULL,
+	                            G_TYPE_NETWORK_MONITOR,
+	                            GV_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+
+	properties[PROP_NETWORK_AVAILABLE] =
+	        g_param_spec_boolean("network-available", "Network available", NULL,
+	                             FALSE,
+	                             GV_PARAM_READABLE);
+
+	g_object_class_install_properties(object_class, PROP_N, properties);
+
+	/* Signals */
+	signals[SIGNAL_RECONNECT] =
+	        g_signal_new("reconnect", G_TYPE_FROM_CLASS(class),
+	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+	                     G_TYPE_NONE, 0);
+}
@@ -0,0 +1,52 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+/* GObject declarations */
+
+#define GV_TYPE_RECONNECT_SCHEDULER gv_reconnect_scheduler_get_type()
+
+G_DECLARE_FINAL_TYPE(GvReconnectScheduler, gv_reconnect_scheduler, GV, RECONNECT_SCHEDULER, GObject)
+
+/* Data types */
+
+/* Returned by schedule() when there's no network, in which case the
+ * reconnection happens as soon as the network is back.
+ */
+#define GV_RECONNECT_SCHEDULER_WAIT_NETWORK G_MAXUINT
+
+/* Methods */
+
+GvReconnectScheduler *gv_reconnect_scheduler_new(GNetworkMonitor *monitor);
+
+guint    gv_reconnect_scheduler_schedule  (GvReconnectScheduler *self, const gchar *uri);
+void     gv_reconnect_scheduler_succeeded (GvReconnectScheduler *self, const gchar *uri);
+void     gv_reconnect_scheduler_cancel    (GvReconnectScheduler *self);
+gboolean gv_reconnect_scheduler_is_pending(GvReconnectScheduler *self);
+
+/* Property accessors */
+
+GNetworkMonitor *gv_reconnect_scheduler_get_network_monitor(GvReconnectScheduler *self);
+gboolean         gv_reconnect_scheduler_get_network_available(GvReconnectScheduler *self);
@@ -20,18 +20,29 @@
  */
 
 #include <errno.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include "base/glib-object-additions.h"
 #include "base/gv-base.h"
+#include "core/gv-core-internal.h"
+#include "core/gv-playlist.h"
 
 #include "core/gv-station-list.h"
 
 // WISHED Try with a huge number of stations to see how it behaves.
-//        It might be slow. The implementation never tried to be fast.
+//        Stations are kept in an array of compact slots, and each slot
+//        knows its position, so most operations are cheap. Inserting,
+//        moving or removing a station in the middle renumbers the slots
+//        in-between though. Saving walks the whole list, and so does
+//        shuffling, when the shuffled order is created or starts over.
+//        The string arena is rebuilt from the live slots once enough
+//        strings are not used anymore, which walks the whole list too.
 
 /*
  * More defines...
@@ -39,6 +50,22 @@
 
 #define SAVE_DELAY 1 // how long to wait before writing changes to disk
 #define STATION_LIST_FILE "stations.xml" // where to write the stations
+#define JOURNAL_SUFFIX ".journal" // journal file, next to the station list file
+#define JOURNAL_HEADER "# goodvibes journal " // followed by the station list checksum
+#define JOURNAL_MIN_SIZE 16384 // journal size under which we never compact
+#define CACHE_SUFFIX ".cache" // binary cache file, next to the station list file
+#define IMPORT_CHUNK_SIZE 65536 // how much to read at once when importing a playlist
+#define ARENA_MIN_DEAD_SIZE 65536 // unused arena size under which we never compact
+
+/*
+ * Changes recorded during a batch
+ */
+
+enum {
+	BATCH_ADDED = 1,
+	BATCH_REMOVED,
+	BATCH_MOVED,
+};
 
 /*
  * Properties
@@ -68,6 +95,7 @@ enum {
 	SIGNAL_STATION_REMOVED,
 	SIGNAL_STATION_MODIFIED,
 	SIGNAL_STATION_MOVED,
+	SIGNAL_CHANGED,
 	/* Number of signals */
 	SIGNAL_N
 };
@@ -86,14 +114,56 @@ struct _GvStationListPrivate {
 	gchar  *save_path;
 	/* Timeout id, > 0 if a save operation is scheduled */
 	guint   save_timeout_id;
+	/* Thread running a save operation, and whether another
+	 * save was requested while it runs.
+	 */
+	GThread *save_thread;
+	gboolean save_pending;
+	/* Journal file, operations not written yet, and whether the
+	 * journal applies to the station list file. Sizes are used to
+	 * decide when to compact the journal.
+	 */
+	gchar   *journal_path;
+	gchar   *cache_path;
+	GString *journal_ops;
+	gboolean journal_valid;
+	gsize    journal_size;
+	gsize    snapshot_size;
 	/* Set to true during object finalization */
 	gboolean finalization;
-	/* Ordered list of stations */
-	GList  *stations;
-	/* Shuffled list of stations, automatically created
-	 * and destroyed when needed.
+	/* Ordered array of station slots. Each slot knows its position,
+	 * see gv_station_list_renumber().
 	 */
-	GList  *shuffled;
+	GPtrArray  *stations;
+	/* Number of iterators sharing the station array, and how many
+	 * times it had to be copied because it was modified meanwhile.
+	 * Iterators alive, shared or not, prevent arena compaction.
+	 */
+	guint       n_iters;
+	guint       n_snapshot_copies;
+	guint       n_live_iters;
+	/* Strings of the station slots, and an estimate of the size
+	 * taken by the strings that are not used anymore.
+	 */
+	GStringChunk *arena;
+	gsize         arena_dead_size;
+	/* Stations that exist as objects, mapped to their slot. Those
+	 * that nobody else holds are released when idle.
+	 */
+	GHashTable *materialized;
+	GHashTable *unused;
+	guint       release_source_id;
+	/* Shuffled order of the station slots, automatically created
+	 * and destroyed when needed, and kept up to date in-between.
+	 */
+	GPtrArray  *shuffled;
+	/* Indexes for fast lookups, they map keys to slots */
+	GHashTable *uid_index;
+	GHashTable *name_index;
+	GHashTable *uri_index;
+	/* Batch of changes in progress, see gv_station_list_begin() */
+	guint       batch_depth;
+	GHashTable *batch_changes;
 };
 
 typedef struct _GvStationListPrivate GvStationListPrivate;
@@ -109,16 +179,6 @@ G_DEFINE_TYPE_WITH_CODE(GvStationList, gv_station_list, G_TYPE_OBJECT,
                         G_ADD_PRIVATE(GvStationList)
                         G_IMPLEMENT_INTERFACE(GV_TYPE_ERRORABLE, NULL))
 
-/*
- * Helpers
- */
-
-static gpointer
-copy_func_object_ref(gconstpointer src, gpointer data G_GNUC_UNUSED)
-{
-	return g_object_ref((gpointer) src);
-}
-
 /*
  * Paths helpers
  */
@@ -158,13 +218,170 @@ make_station_list_save_path(const gchar *filename)
 	return path;
 }
 
+/*
+ * Station records
+ * A plain copy of the station fields that are saved to disk, so that
+ * the station list can be serialized outside of the main thread.
+ */
+
+typedef struct {
+	gchar    *uri;
+	gchar    *name;
+	gboolean  insecure;
+	gchar    *user_agent;
+} GvStationRecord;
+
+static void
+gv_station_record_free(GvStationRecord *record)
+{
+	g_free(record->uri);
+	g_free(record->name);
+	g_free(record->user_agent);
+	g_free(record);
+}
+
+static GvStationRecord *
+gv_station_record_new(const gchar *uri, const gchar *name, gboolean insecure,
+                      const gchar *user_agent)
+{
+	GvStationRecord *record;
+
+	record = g_new0(GvStationRecord, 1);
+	record->uri = g_strdup(uri);
+	record->name = g_strdup(name);
+	record->insecure = insecure;
+	record->user_agent = g_strdup(user_agent);
+
+	return record;
+}
+
+static GPtrArray *
+make_station_record_array(void)
+{
+	return g_ptr_array_new_with_free_func((GDestroyNotify) gv_station_record_free);
+}
+
+/*
+ * Station slots
+ * A GvStation object is too heavy to keep one for each entry of a large
+ * list. Instead, the list is made of slots, that hold the station fields
+ * as strings interned in an arena. The GvStation object is created on
+ * demand, when the station is handed out, and released once nobody else
+ * holds it. The uid is given to the slot when it's created, so that the
+ * station can be found again, and keeps the same uid when re-created.
+ */
+
+typedef struct _GvStationSlot GvStationSlot;
+
+struct _GvStationSlot {
+	/* The station object, NULL unless somebody holds it */
+	GvStation   *station;
+	/* Station fields, owned by the arena */
+	const gchar *uid;
+	const gchar *uri;
+	const gchar *name;
+	const gchar *user_agent;
+	gboolean     insecure;
+	/* Set once the slot is removed from the list */
+	gboolean     removed;
+	guint        ref_count;
+	/* Position in the station array */
+	guint        pos;
+	/* Position in the shuffled order, if any */
+	guint        shuffle_pos;
+	/* Next slot with the same name, or uri, in the indexes */
+	GvStationSlot *next_same_name;
+	GvStationSlot *next_same_uri;
+};
+
+static const gchar *
+arena_insert(GStringChunk *arena, const gchar *str)
+{
+	return str ? g_string_chunk_insert_const(arena, str) : NULL;
+}
+
+static gsize
+arena_size(const gchar *str)
+{
+	return str ? strlen(str) + 1 : 0;
+}
+
+static GvStationSlot *
+gv_station_slot_new(void)
+{
+	GvStationSlot *slot;
+
+	slot = g_slice_new0(GvStationSlot);
+	slot->ref_count = 1;
+
+	return slot;
+}
+
+static GvStationSlot *
+gv_station_slot_ref(GvStationSlot *slot)
+{
+	slot->ref_count++;
+
+	return slot;
+}
+
+static void
+gv_station_slot_unref(GvStationSlot *slot)
+{
+	if (--slot->ref_count > 0)
+		return;
+
+	g_assert_null(slot->station);
+	g_slice_free(GvStationSlot, slot);
+}
+
+static void
+gv_station_slot_set_fields(GvStationSlot *slot, GStringChunk *arena,
+                           const gchar *uri, const gchar *name,
+                           gboolean insecure, const gchar *user_agent)
+{
+	slot->uri = arena_insert(arena, uri);
+	slot->name = arena_insert(arena, name);
+	slot->insecure = insecure;
+	slot->user_agent = arena_insert(arena, user_agent);
+}
+
+/* Size taken by the strings of a slot in the arena. Strings are shared,
+ * so it's an upper bound of what is freed when the slot goes away.
+ */
+static gsize
+gv_station_slot_get_size(GvStationSlot *slot)
+{
+	return arena_size(slot->uid) + arena_size(slot->uri) +
+	       arena_size(slot->name) + arena_size(slot->user_agent);
+}
+
+static GPtrArray *
+make_station_records(GPtrArray *slots)
+{
+	GPtrArray *records;
+	guint i;
+
+	records = g_ptr_array_new_full(slots->len,
+	                               (GDestroyNotify) gv_station_record_free);
+	for (i = 0; i < slots->len; i++) {
+		GvStationSlot *slot = g_ptr_array_index(slots, i);
+
+		g_ptr_array_add(records, gv_station_record_new(slot->uri, slot->name,
+		                                               slot->insecure,
+		                                               slot->user_agent));
+	}
+
+	return records;
+}
+
 /*
  * Markup handling
  */
 
 struct _GvMarkupParsing {
 	/* Persistent during the whole parsing process */
-	GList  *list;
+	GPtrArray *records;
 	/* Current iteration */
 	gchar **cur;
 	gchar  *name;
@@ -205,7 +422,6 @@ markup_on_end_element(GMarkupParseContext  *context G_GNUC_UNUSED,
                       GError              **err G_GNUC_UNUSED)
 {
 	GvMarkupParsing *parsing = user_data;
-	GvStation *station;
 
 	/* We only care when we leave a station node */
 	if (g_strcmp0(element_name, "Station"))
@@ -217,18 +433,17 @@ markup_on_end_element(GMarkupParseContext  *context G_GNUC_UNUSED,
 		goto cleanup;
 	}
 
-	/* Create a new station */
-	station = gv_station_new(parsing->name, parsing->uri);
-	if (!g_strcmp0(parsing->insecure, "true"))
-		gv_station_set_insecure(station, TRUE);
-	if (parsing->user_agent)
-		gv_station_set_user_agent(station, parsing->user_agent);
-
-	/* We must take ownership right now */
-	g_object_ref_sink(station);
-
-	/* Add to list, use prepend for efficiency */
-	parsing->list = g_list_prepend(parsing->list, station);
+	/* Add a new station record. Empty names are turned to NULL,
+	 * the same way GvStation does it.
+	 */
+	g_ptr_array_add(parsing->records,
+	                gv_station_record_new(parsing->uri,
+	                                      parsing->name && parsing->name[0] != '\0' ?
+	                                      parsing->name : NULL,
+	                                      !g_strcmp0(parsing->insecure, "true"),
+	                                      parsing->user_agent &&
+	                                      parsing->user_agent[0] != '\0' ?
+	                                      parsing->user_agent : NULL));
 
 cleanup:
 	/* Cleanup */
@@ -307,7 +522,7 @@ markup_on_error(GMarkupParseContext *context G_GNUC_UNUSED,
 }
 
 static gboolean
-parse_markup(const gchar *text, GList **list, GError **err)
+parse_markup(const gchar *text, GPtrArray **records, GError **err)
 {
 	GMarkupParseContext *context;
 	GMarkupParser parser = {
@@ -327,19 +542,22 @@ parse_markup(const gchar *text, GList **list, GError **err)
 	};
 	gboolean ret;
 
-	g_return_val_if_fail(list != NULL, FALSE);
+	g_return_val_if_fail(records != NULL, FALSE);
 	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
 
+	parsing.records = make_station_record_array();
+
 	context = g_markup_parse_context_new(&parser, 0, &parsing, NULL);
 	ret = g_markup_parse_context_parse(context, text, -1, err);
 	g_markup_parse_context_free(context);
 
 	if (ret == FALSE) {
 		g_assert(err == NULL || *err != NULL);
+		g_ptr_array_unref(parsing.records);
 		return FALSE;
 	}
 
-	*list = g_list_reverse(parsing.list);
+	*records = parsing.records;
 	return TRUE;
 }
 
@@ -356,13 +574,12 @@ g_string_append_markup_tag_escaped(GString *string, const gchar *tag, const gcha
 }
 
 static gchar *
-print_markup_station(GvStation *station)
+print_markup_station(GvStationRecord *station)
 {
-	const gchar *name = gv_station_get_name(station);
-	const gchar *uri = gv_station_get_uri(station);
-	const gchar *insecure = gv_station_get_insecure(station) ?
-		"true" : NULL;
-	const gchar *user_agent = gv_station_get_user_agent(station);
+	const gchar *name = station->name;
+	const gchar *uri = station->uri;
+	const gchar *insecure = station->insecure ? "true" : NULL;
+	const gchar *user_agent = station->user_agent;
 	GString *string;
 
 	/* A station is supposed to have an uri */
@@ -393,10 +610,10 @@ print_markup_station(GvStation *station)
 }
 
 static gboolean
-print_markup(GList *list, gchar **markup, GError **err)
+print_markup(GPtrArray *records, gchar **markup, GError **err)
 {
-	GList *item;
 	GString *string;
+	guint i;
 
 	g_return_val_if_fail(markup != NULL, FALSE);
 	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
@@ -404,8 +621,8 @@ print_markup(GList *list, gchar **markup, GError **err)
 	string = g_string_new(NULL);
 	g_string_append(string, "<Stations>\n");
 
-	for (item = list; item; item = item->next) {
-		GvStation *station = GV_STATION(item->data);
+	for (i = 0; i < records->len; i++) {
+		GvStationRecord *station = g_ptr_array_index(records, i);
 		gchar *text;
 
 		text = print_markup_station(station);
@@ -422,49 +639,273 @@ print_markup(GList *list, gchar **markup, GError **err)
 	return TRUE;
 }
 
+/*
+ * Binary cache
+ * Parsing the station list file is slow for large lists, so we keep a
+ * binary copy of it next to the save file, along with the checksum of
+ * the station list file it was made from. This cache is mapped in memory,
+ * and used instead of parsing the station list file when the checksums
+ * match. The station list file remains the reference.
+ *
+ * Layout, in host byte order:
+ *   GvCacheHeader
+ *   GvCacheRecord, times the number of stations
+ *   NUL-terminated strings, referenced by their offset
+ */
+
+#define CACHE_MAGIC   0x4c535647 // "GVSL"
+#define CACHE_VERSION 1
+#define CACHE_NULL    G_MAXUINT32 // offset for a NULL string
+
+#define CACHE_FLAG_INSECURE (1 << 0)
+
+typedef struct {
+	guint32 magic;
+	guint32 version;
+	gchar   checksum[40];
+	guint32 n_stations;
+	guint32 strings_size;
+} GvCacheHeader;
+
+typedef struct {
+	guint32 uri;
+	guint32 name;
+	guint32 user_agent;
+	guint32 flags;
+} GvCacheRecord;
+
+static guint32
+cache_add_string(GByteArray *strings, const gchar *str)
+{
+	guint32 offset;
+
+	if (str == NULL)
+		return CACHE_NULL;
+
+	offset = strings->len;
+	g_byte_array_append(strings, (const guint8 *) str, strlen(str) + 1);
+
+	return offset;
+}
+
+static const gchar *
+cache_get_string(const gchar *strings, gsize strings_size, guint32 offset,
+                 gboolean *valid)
+{
+	if (offset == CACHE_NULL)
+		return NULL;
+
+	if (offset >= strings_size) {
+		*valid = FALSE;
+		return NULL;
+	}
+
+	return strings + offset;
+}
+
+static gboolean
+load_station_list_from_cache(const gchar *path, const gchar *checksum,
+                             GPtrArray **station_records)
+{
+	GMappedFile *file;
+	const gchar *data;
+	const gchar *strings;
+	const GvCacheHeader *header;
+	const GvCacheRecord *records;
+	GPtrArray *stations = NULL;
+	gsize size;
+	gboolean ret = FALSE;
+	guint i;
+
+	file = g_mapped_file_new(path, FALSE, NULL);
+	if (file == NULL)
+		return FALSE;
+
+	data = g_mapped_file_get_contents(file);
+	size = g_mapped_file_get_length(file);
+
+	/* Check the header */
+	header = (const GvCacheHeader *) data;
+	if (size < sizeof *header ||
+	    header->magic != CACHE_MAGIC ||
+	    header->version != CACHE_VERSION ||
+	    strlen(checksum) != sizeof header->checksum ||
+	    memcmp(header->checksum, checksum, sizeof header->checksum)) {
+		DEBUG("Cache '%s' doesn't apply to the station list", path);
+		goto end;
+	}
+
+	if ((guint64) size != sizeof *header +
+	    (guint64) header->n_stations * sizeof *records + header->strings_size) {
+		WARNING("Cache '%s' has an invalid size", path);
+		goto end;
+	}
+
+	records = (const GvCacheRecord *) (data + sizeof *header);
+	strings = data + sizeof *header + header->n_stations * sizeof *records;
+
+	if (header->strings_size > 0 && strings[header->strings_size - 1] != '\0') {
+		WARNING("Cache '%s' is corrupted", path);
+		goto end;
+	}
+
+	/* Create the station records */
+	stations = g_ptr_array_new_full(header->n_stations,
+	                                (GDestroyNotify) gv_station_record_free);
+	for (i = 0; i < header->n_stations; i++) {
+		const GvCacheRecord *record = &records[i];
+		const gchar *uri, *name, *user_agent;
+		gboolean valid = TRUE;
+
+		uri = cache_get_string(strings, header->strings_size, record->uri, &valid);
+		name = cache_get_string(strings, header->strings_size, record->name, &valid);
+		user_agent = cache_get_string(strings, header->strings_size,
+		                              record->user_agent, &valid);
+		if (valid == FALSE || uri == NULL) {
+			WARNING("Cache '%s' is corrupted", path);
+			g_ptr_array_unref(stations);
+			goto end;
+		}
+
+		g_ptr_array_add(stations,
+		                gv_station_record_new(uri, name,
+		                                      record->flags & CACHE_FLAG_INSECURE,
+		                                      user_agent));
+	}
+
+	*station_records = stations;
+	ret = TRUE;
+
+end:
+	g_mapped_file_unref(file);
+	return ret;
+}
+
+static gboolean
+save_station_list_to_cache(GPtrArray *records, const gchar *checksum,
+                           const gchar *path, GError **err)
+{
+	GvCacheHeader header = { 0 };
+	GvCacheRecord *cache_records;
+	GByteArray *strings;
+	GByteArray *data;
+	gchar *dirname;
+	gboolean ret;
+	guint i;
+
+	g_return_val_if_fail(strlen(checksum) == sizeof header.checksum, FALSE);
+
+	strings = g_byte_array_new();
+	cache_records = g_new0(GvCacheRecord, records->len);
+
+	for (i = 0; i < records->len; i++) {
+		GvStationRecord *record = g_ptr_array_index(records, i);
+		GvCacheRecord *cache_record = &cache_records[i];
+
+		cache_record->uri = cache_add_string(strings, record->uri);
+		cache_record->name = cache_add_string(strings, record->name);
+		cache_record->user_agent = cache_add_string(strings, record->user_agent);
+		cache_record->flags = record->insecure ? CACHE_FLAG_INSECURE : 0;
+	}
+
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	memcpy(header.checksum, checksum, sizeof header.checksum);
+	header.n_stations = records->len;
+	header.strings_size = strings->len;
+
+	data = g_byte_array_sized_new(sizeof header +
+	                              records->len * sizeof *cache_records +
+	                              strings->len);
+	g_byte_array_append(data, (const guint8 *) &header, sizeof header);
+	g_byte_array_append(data, (const guint8 *) cache_records,
+	                    records->len * sizeof *cache_records);
+	g_byte_array_append(data, strings->data, strings->len);
+
+	dirname = g_path_get_dirname(path);
+	if (g_mkdir_with_parents(dirname, S_IRWXU) != 0) {
+		g_set_error(err, G_FILE_ERROR,
+		            g_file_error_from_errno(errno),
+		            "Failed to make directory: %s", g_strerror(errno));
+		ret = FALSE;
+		goto end;
+	}
+
+	ret = g_file_set_contents(path, (const gchar *) data->data, data->len, err);
+
+end:
+	g_free(dirname);
+	g_byte_array_unref(data);
+	g_byte_array_unref(strings);
+	g_free(cache_records);
+	return ret;
+}
+
 /*
  * File I/O
  */
 
 static gboolean
-load_station_list_from_string(const gchar *text, GList **list, GError **err)
+load_station_list_from_string(const gchar *text, GPtrArray **records, GError **err)
 {
-	return parse_markup(text, list, err);
+	return parse_markup(text, records, err);
 }
 
+/* Load the station list from a file, or from the binary cache if it's
+ * up to date, in which case 'cached' is set. On success, the checksum and
+ * the size of the file are returned, so that we can tell if the journal
+ * applies.
+ */
 static gboolean
-load_station_list_from_file(const gchar *path, GList **list, GError **err)
+load_station_list_from_file(const gchar *path, const gchar *cache_path,
+                            GPtrArray **records, gchar **checksum, gsize *size,
+                            gboolean *cached, GError **err)
 {
 	gchar *text = NULL;
+	gchar *sum = NULL;
+	gsize length = 0;
 	gboolean ret;
 
 	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
 
-	ret = g_file_get_contents(path, &text, NULL, err);
+	ret = g_file_get_contents(path, &text, &length, err);
 	if (ret == FALSE) {
 		g_assert (err == NULL || *err != NULL);
 		goto end;
 	}
 
-	ret = load_station_list_from_string(text, list, err);
-	if (ret == FALSE) {
-		g_assert(err == NULL || *err != NULL);
-		goto end;
+	sum = g_compute_checksum_for_data(G_CHECKSUM_SHA1, (guchar *) text, length);
+
+	*cached = cache_path && load_station_list_from_cache(cache_path, sum, records);
+	if (*cached == FALSE) {
+		ret = load_station_list_from_string(text, records, err);
+		if (ret == FALSE) {
+			g_assert(err == NULL || *err != NULL);
+			g_free(sum);
+			goto end;
+		}
 	}
 
+	*checksum = sum;
+	*size = length;
+
 end:
 	g_free(text);
 	return ret;
 }
 
 static gboolean
-save_station_list_to_string(GList *list, gchar **text, GError **err)
+save_station_list_to_string(GPtrArray *records, gchar **text, GError **err)
 {
-	return print_markup(list, text, err);
+	return print_markup(records, text, err);
 }
 
+/* Save the station list to a file. On success, the checksum and the size
+ * of the file are returned, except for /dev/null.
+ */
 static gboolean
-save_station_list_to_file(GList *list, const gchar *path, GError **err)
+save_station_list_to_file(GPtrArray *records, const gchar *path,
+                          gchar **checksum, gsize *size, GError **err)
 {
 	gboolean ret;
 	gchar *text = NULL;
@@ -472,7 +913,7 @@ save_station_list_to_file(GList *list, const gchar *path, GError **err)
 
 	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
 
-	ret = save_station_list_to_string(list, &text, err);
+	ret = save_station_list_to_string(records, &text, err);
 	if (ret == FALSE) {
 		g_assert(err == NULL || *err != NULL);
 		goto end;
@@ -504,6 +945,9 @@ save_station_list_to_file(GList *list, const gchar *path, GError **err)
 		goto end;
 	}
 
+	*checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, text, -1);
+	*size = strlen(text);
+
 end:
 	g_free(dirname);
 	g_free(text);
@@ -514,19 +958,35 @@ end:
  * Iterator implementation
  */
 
+/* The iterator walks a snapshot of the slots. The slot array is shared
+ * with the list, and copied only if the list is modified before the
+ * iterator is freed, see gv_station_list_unshare_stations(). Stations
+ * are created as the iteration goes, and the current one is held by the
+ * iterator. Stations removed from the list in the meantime are skipped.
+ * Callers that only need a few fields of each station can loop over the
+ * data instead, and then no station object is created at all.
+ */
+
 struct _GvStationListIter {
-	GList *head, *item;
+	GvStationList *station_list;
+	GPtrArray     *slots;
+	guint          idx;
+	GvStation     *station;
 };
 
+static GvStation *gv_station_list_materialize(GvStationList *self, GvStationSlot *slot);
+
 GvStationListIter *
 gv_station_list_iter_new(GvStationList *self)
 {
-	GList *list = self->priv->stations;
+	GvStationListPrivate *priv = self->priv;
 	GvStationListIter *iter;
 
-	iter = g_new0(GvStationListIter, 1);
-	iter->head = g_list_copy_deep(list, copy_func_object_ref, NULL);
-	iter->item = iter->head;
+	iter = g_slice_new0(GvStationListIter);
+	iter->station_list = g_object_ref(self);
+	iter->slots = g_ptr_array_ref(priv->stations);
+	priv->n_iters++;
+	priv->n_live_iters++;
 
 	return iter;
 }
@@ -534,153 +994,1449 @@ gv_station_list_iter_new(GvStationList *self)
 void
 gv_station_list_iter_free(GvStationListIter *iter)
 {
+	GvStationListPrivate *priv;
+
 	g_return_if_fail(iter != NULL);
 
-	g_list_free_full(iter->head, g_object_unref);
-	g_free(iter);
+	/* Unless it was copied, the station array is shared with the list */
+	priv = iter->station_list->priv;
+	if (iter->slots == priv->stations)
+		priv->n_iters--;
+	priv->n_live_iters--;
+
+	g_clear_object(&iter->station);
+	g_ptr_array_unref(iter->slots);
+	g_object_unref(iter->station_list);
+	g_slice_free(GvStationListIter, iter);
 }
 
 gboolean
 gv_station_list_iter_loop(GvStationListIter *iter, GvStation **station)
 {
+	GvStationSlot *slot;
+
 	g_return_val_if_fail(iter != NULL, FALSE);
 	g_return_val_if_fail(station != NULL, FALSE);
 
 	*station = NULL;
+	g_clear_object(&iter->station);
 
-	if (iter->item == NULL)
-		return FALSE;
+	do {
+		if (iter->idx >= iter->slots->len)
+			return FALSE;
 
-	*station = iter->item->data;
-	iter->item = iter->item->next;
+		slot = g_ptr_array_index(iter->slots, iter->idx);
+		iter->idx++;
+	} while (slot->removed);
+
+	iter->station = g_object_ref(gv_station_list_materialize(iter->station_list, slot));
+	*station = iter->station;
 
 	return TRUE;
 }
 
-/*
- * GList additions
+/* Strings returned are owned by the station list. They remain valid as
+ * long as the iterator exists, then until the list is modified. The name
+ * might be NULL.
  */
-
-static gint
-glist_sortfunc_random(gconstpointer a G_GNUC_UNUSED, gconstpointer b G_GNUC_UNUSED)
+gboolean
+gv_station_list_iter_loop_data(GvStationListIter *iter, const gchar **uid,
+                               const gchar **name, const gchar **uri)
 {
-	return g_random_boolean() ? 1 : -1;
-}
+	GvStationSlot *slot;
 
-static GList *
-g_list_shuffle(GList *list)
-{
-	/* Shuffle twice. Credits goes to:
-	 * http://www.linuxforums.org/forum/programming-scripting/
-	 * 202125-fastest-way-shuffle-linked-list.html
-	 */
-	list = g_list_sort(list, glist_sortfunc_random);
-	list = g_list_sort(list, glist_sortfunc_random);
-	return list;
+	g_return_val_if_fail(iter != NULL, FALSE);
+
+	g_clear_object(&iter->station);
+
+	do {
+		if (iter->idx >= iter->slots->len)
+			return FALSE;
+
+		slot = g_ptr_array_index(iter->slots, iter->idx);
+		iter->idx++;
+	} while (slot->removed);
+
+	if (uid)
+		*uid = slot->uid;
+	if (name)
+		*name = slot->name;
+	if (uri)
+		*uri = slot->uri;
+
+	return TRUE;
 }
 
-static GList *
-g_list_copy_deep_shuffle(GList *list, GCopyFunc func, gpointer user_data)
+/* Return how many times the station array was copied, because the list
+ * was modified while iterators were using it.
+ */
+guint
+gv_station_list_get_snapshot_copies(GvStationList *self)
 {
-	list = g_list_copy_deep(list, func, user_data);
-	list = g_list_shuffle(list);
-	return list;
+	return self->priv->n_snapshot_copies;
 }
 
 /*
- * Helpers
+ * Shuffle
+ *
+ * The shuffled order is a permutation of the slots, and each slot knows
+ * its position in it, so that it can be walked in both directions in
+ * constant time. It's updated as stations are inserted and removed, in
+ * a way that keeps the permutation uniformly random.
  */
 
-static gint
-are_stations_similar(GvStation *s1, GvStation *s2)
+static void
+shuffle_swap(GPtrArray *shuffled, guint i, guint j)
 {
-	if (s1 == s2) {
-		WARNING("Stations %p and %p are the same", s1, s2);
-		return 0;
-	}
+	GvStationSlot *a = g_ptr_array_index(shuffled, i);
+	GvStationSlot *b = g_ptr_array_index(shuffled, j);
 
-	if (s1 == NULL || s2 == NULL)
-		return -1;
+	g_ptr_array_index(shuffled, i) = b;
+	g_ptr_array_index(shuffled, j) = a;
+	a->shuffle_pos = j;
+	b->shuffle_pos = i;
+}
 
-	/* Compare uids */
-	const gchar *s1_uid, *s2_uid;
-	s1_uid = gv_station_get_uid(s1);
-	s2_uid = gv_station_get_uid(s2);
+/* Fisher-Yates shuffle */
+static void
+shuffle_all(GPtrArray *shuffled)
+{
+	guint i;
 
-	if (!g_strcmp0(s1_uid, s2_uid)) {
-		WARNING("Stations %p and %p have the same uid '%s'", s1, s2, s1_uid);
-		return 0;
-	}
+	for (i = shuffled->len; i > 1; i--)
+		shuffle_swap(shuffled, i - 1, g_random_int_range(0, i));
+}
 
-	/* Compare names.
-	 * Two stations who don't have name are different.
-	 */
-	const gchar *s1_name, *s2_name;
-	s1_name = gv_station_get_name(s1);
-	s2_name = gv_station_get_name(s2);
+static GPtrArray *
+shuffle_new(GPtrArray *slots)
+{
+	GPtrArray *shuffled;
+	guint i;
 
-	if (s1_name == NULL && s2_name == NULL)
-		return -1;
+	shuffled = g_ptr_array_sized_new(slots->len);
+	for (i = 0; i < slots->len; i++) {
+		GvStationSlot *slot = g_ptr_array_index(slots, i);
 
-	if (!g_strcmp0(s1_name, s2_name)) {
-		DEBUG("Stations %p and %p have the same name '%s'", s1, s2, s1_name);
-		return 0;
+		slot->shuffle_pos = i;
+		g_ptr_array_add(shuffled, slot);
 	}
 
-	/* Compare uris */
-	const gchar *s1_uri, *s2_uri;
-	s1_uri = gv_station_get_uri(s1);
-	s2_uri = gv_station_get_uri(s2);
+	shuffle_all(shuffled);
 
-	if (!g_strcmp0(s1_uri, s2_uri)) {
-		DEBUG("Stations %p and %p have the same uri '%s'", s1, s2, s1_uri);
-		return 0;
-	}
+	return shuffled;
+}
+
+/* Insert at a random position, the slot that was there goes to the end */
+static void
+shuffle_insert(GPtrArray *shuffled, GvStationSlot *slot)
+{
+	slot->shuffle_pos = shuffled->len;
+	g_ptr_array_add(shuffled, slot);
+	shuffle_swap(shuffled, slot->shuffle_pos, g_random_int_range(0, shuffled->len));
+}
+
+/* Remove, the last slot takes its place */
+static void
+shuffle_remove(GPtrArray *shuffled, GvStationSlot *slot)
+{
+	guint last = shuffled->len - 1;
 
-	return -1;
+	shuffle_swap(shuffled, slot->shuffle_pos, last);
+	g_ptr_array_remove_index(shuffled, last);
 }
 
 /*
- * Signal handlers
+ * Helpers
  */
 
-static gboolean
-when_timeout_save_station_list(gpointer data)
+/*
+ * Indexes
+ *
+ * Station slots are indexed by uid, name and uri. Keys are owned by the
+ * arena. Uids are unique. Names and uris are not necessarily unique: in
+ * case of duplicates, the first slot is indexed, and the others are
+ * chained to it, through a link in the slot. When the indexed slot goes
+ * away, the next one in the chain takes its place. For unique keys,
+ * which is the common case, that's O(1).
+ */
+
+#define SLOT_LINK(slot, offset) G_STRUCT_MEMBER(GvStationSlot *, slot, offset)
+
+#define NAME_LINK G_STRUCT_OFFSET(GvStationSlot, next_same_name)
+#define URI_LINK  G_STRUCT_OFFSET(GvStationSlot, next_same_uri)
+
+static void
+index_insert(GHashTable *index, const gchar *key, GvStationSlot *slot, glong link)
 {
-	GvStationList *self = GV_STATION_LIST(data);
-	GvStationListPrivate *priv = self->priv;
+	GvStationSlot *other;
 
-	gv_station_list_save(self);
+	if (key == NULL || key[0] == '\0')
+		return;
 
-	priv->save_timeout_id = 0;
+	SLOT_LINK(slot, link) = NULL;
 
-	return G_SOURCE_REMOVE;
+	/* In case of duplicates, keep the slot that is already there,
+	 * and chain this one last.
+	 */
+	other = g_hash_table_lookup(index, key);
+	if (other == NULL) {
+		g_hash_table_insert(index, (gpointer) key, slot);
+		return;
+	}
+
+	while (SLOT_LINK(other, link) != NULL)
+		other = SLOT_LINK(other, link);
+
+	SLOT_LINK(other, link) = slot;
 }
 
 static void
-gv_station_list_save_delayed(GvStationList *self)
+index_remove(GHashTable *index, const gchar *key, GvStationSlot *slot, glong link)
 {
-	GvStationListPrivate *priv = self->priv;
+	GvStationSlot *other;
 
-	g_clear_handle_id(&priv->save_timeout_id, g_source_remove);
-	priv->save_timeout_id =
-	        g_timeout_add_seconds(SAVE_DELAY, when_timeout_save_station_list, self);
+	if (key == NULL || key[0] == '\0')
+		return;
+
+	other = g_hash_table_lookup(index, key);
+	if (other == NULL)
+		return;
+
+	/* The next slot with the same key, if any, takes its place */
+	if (other == slot) {
+		if (SLOT_LINK(slot, link))
+			g_hash_table_insert(index, (gpointer) key, SLOT_LINK(slot, link));
+		else
+			g_hash_table_remove(index, key);
+	} else {
+		while (SLOT_LINK(other, link) && SLOT_LINK(other, link) != slot)
+			other = SLOT_LINK(other, link);
+
+		if (SLOT_LINK(other, link) == slot)
+			SLOT_LINK(other, link) = SLOT_LINK(slot, link);
+	}
+
+	SLOT_LINK(slot, link) = NULL;
 }
 
 static void
-on_station_notify(GvStation     *station,
-                  GParamSpec     *pspec,
-                  GvStationList *self)
+gv_station_list_index_slot(GvStationList *self, GvStationSlot *slot)
 {
-	const gchar *property_name = g_param_spec_get_name(pspec);
+	GvStationListPrivate *priv = self->priv;
 
-	TRACE("%s, %s, %p", gv_station_get_uid(station), property_name, self);
+	if (slot->uid)
+		g_hash_table_insert(priv->uid_index, (gpointer) slot->uid, slot);
+	index_insert(priv->name_index, slot->name, slot, NAME_LINK);
+	index_insert(priv->uri_index, slot->uri, slot, URI_LINK);
+}
 
-	/* We might want to save changes */
-	if (!g_strcmp0(property_name, "uri") ||
-	    !g_strcmp0(property_name, "name") ||
-	    !g_strcmp0(property_name, "insecure") ||
+/* A change recorded during a batch. It holds the slot, so that stations
+ * added in a batch don't need to exist as objects until the commit. A
+ * removed station is held though, as it can't be found from its slot.
+ */
+typedef struct {
+	gint           change;
+	GvStationSlot *slot;
+	GvStation     *station;
+} GvBatchChange;
+
+static void
+gv_batch_change_free(GvBatchChange *batch_change)
+{
+	gv_station_slot_unref(batch_change->slot);
+	g_clear_object(&batch_change->station);
+	g_slice_free(GvBatchChange, batch_change);
+}
+
+/* Record the change made to a slot during a batch. Changes to the same
+ * station, ie. the same uid, are folded together: a station that is added
+ * then removed is forgotten, a station that is removed then added back was
+ * just moved. The removed station must be given, and only then.
+ */
+static void
+gv_station_list_batch_record(GvStationList *self, GvStationSlot *slot,
+                             GvStation *removed, gint change)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvBatchChange *batch_change;
+	gint prev;
+
+	batch_change = g_hash_table_lookup(priv->batch_changes, slot->uid);
+	prev = batch_change ? batch_change->change : 0;
+
+	switch (change) {
+	case BATCH_ADDED:
+		change = prev == BATCH_REMOVED ? BATCH_MOVED : BATCH_ADDED;
+		break;
+	case BATCH_REMOVED:
+		if (prev == BATCH_ADDED) {
+			g_hash_table_remove(priv->batch_changes, slot->uid);
+			return;
+		}
+		break;
+	case BATCH_MOVED:
+		if (prev != 0)
+			return;
+		break;
+	default:
+		g_assert_not_reached();
+	}
+
+	batch_change = g_slice_new0(GvBatchChange);
+	batch_change->change = change;
+	batch_change->slot = gv_station_slot_ref(slot);
+	if (removed)
+		batch_change->station = g_object_ref(removed);
+
+	g_hash_table_replace(priv->batch_changes, (gpointer) slot->uid, batch_change);
+}
+
+/* Update the position of the slots in the range [from, to], after some
+ * slots were inserted, removed or moved there. Only the slots between the
+ * old and the new position of a station are shifted, appending and
+ * removing the last station cost nothing.
+ */
+static void
+gv_station_list_renumber(GvStationList *self, guint from, guint to)
+{
+	GPtrArray *stations = self->priv->stations;
+	guint i;
+
+	if (stations->len == 0)
+		return;
+
+	to = MIN(to, stations->len - 1);
+	for (i = from; i <= to; i++) {
+		GvStationSlot *slot = g_ptr_array_index(stations, i);
+
+		slot->pos = i;
+	}
+}
+
+/* Must be called before the station array is modified. If iterators
+ * share the array, they keep it, and the list gets a copy.
+ */
+static void
+gv_station_list_unshare_stations(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GPtrArray *stations;
+	guint i;
+
+	if (priv->n_iters == 0)
+		return;
+
+	stations = g_ptr_array_new_full(priv->stations->len,
+	                                (GDestroyNotify) gv_station_slot_unref);
+	for (i = 0; i < priv->stations->len; i++)
+		g_ptr_array_add(stations, gv_station_slot_ref(g_ptr_array_index(priv->stations, i)));
+
+	g_ptr_array_unref(priv->stations);
+	priv->stations = stations;
+	priv->n_iters = 0;
+	priv->n_snapshot_copies++;
+
+	TRACE("Station array copied, %u copies so far", priv->n_snapshot_copies);
+}
+
+static void
+gv_station_list_unindex_slot(GvStationList *self, GvStationSlot *slot)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	/* Uids are unique, there's no other slot to look for */
+	if (slot->uid)
+		g_hash_table_remove(priv->uid_index, slot->uid);
+	index_remove(priv->name_index, slot->name, slot, NAME_LINK);
+	index_remove(priv->uri_index, slot->uri, slot, URI_LINK);
+}
+
+/* Rebuild the arena from the strings of the slots in the list, once
+ * enough of it is not used anymore. The indexes are rebuilt as well, as
+ * their keys belong to the arena. It can't be done while iterators or a
+ * batch still hold slots that were removed from the list.
+ */
+static void
+gv_station_list_compact_arena(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GStringChunk *arena;
+	guint i;
+
+	if (priv->arena_dead_size < ARENA_MIN_DEAD_SIZE ||
+	    priv->arena_dead_size < priv->snapshot_size)
+		return;
+
+	if (priv->n_live_iters > 0 || priv->batch_depth > 0)
+		return;
+
+	DEBUG("Compacting string arena, about %" G_GSIZE_FORMAT " bytes unused",
+	      priv->arena_dead_size);
+
+	g_hash_table_remove_all(priv->uid_index);
+	g_hash_table_remove_all(priv->name_index);
+	g_hash_table_remove_all(priv->uri_index);
+
+	arena = g_string_chunk_new(4096);
+	for (i = 0; i < priv->stations->len; i++) {
+		GvStationSlot *slot = g_ptr_array_index(priv->stations, i);
+
+		slot->uid = arena_insert(arena, slot->uid);
+		slot->uri = arena_insert(arena, slot->uri);
+		slot->name = arena_insert(arena, slot->name);
+		slot->user_agent = arena_insert(arena, slot->user_agent);
+		gv_station_list_index_slot(self, slot);
+	}
+
+	g_string_chunk_free(priv->arena);
+	priv->arena = arena;
+	priv->arena_dead_size = 0;
+}
+
+static GvStationSlot *
+gv_station_list_lookup_slot(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (station == NULL)
+		return NULL;
+
+	return g_hash_table_lookup(priv->materialized, station);
+}
+
+static void on_station_notify(GvStation *station, GParamSpec *pspec, GvStationList *self);
+static void on_station_toggle_notify(gpointer data, GObject *object, gboolean is_last_ref);
+
+/* Tie a station object to its slot. The list holds a toggle reference
+ * on the station, so that it knows when nobody else holds it.
+ */
+static void
+gv_station_list_attach(GvStationList *self, GvStationSlot *slot, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	g_assert_null(slot->station);
+
+	slot->station = station;
+	g_hash_table_insert(priv->materialized, station, slot);
+
+	/* Slots loaded from file got their uid at load time, while a station
+	 * inserted in the list comes with its own.
+	 */
+	if (slot->uid == NULL) {
+		slot->uid = arena_insert(priv->arena, gv_station_get_uid(station));
+		g_hash_table_insert(priv->uid_index, (gpointer) slot->uid, slot);
+	}
+
+	g_object_ref_sink(station);
+	g_object_add_toggle_ref(G_OBJECT(station), on_station_toggle_notify, self);
+	g_object_unref(station);
+
+	g_signal_connect_object(station, "notify", G_CALLBACK(on_station_notify), self, 0);
+}
+
+/* Untie a station object from its slot, and drop our reference.
+ * The station is finalized, unless somebody else still holds it.
+ */
+static void
+gv_station_list_detach(GvStationList *self, GvStationSlot *slot)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStation *station = slot->station;
+
+	g_assert_nonnull(station);
+
+	g_signal_handlers_disconnect_by_data(station, self);
+	g_hash_table_remove(priv->materialized, station);
+	g_hash_table_remove(priv->unused, station);
+	slot->station = NULL;
+
+	g_object_remove_toggle_ref(G_OBJECT(station), on_station_toggle_notify, self);
+}
+
+static GvStation *
+gv_station_list_materialize(GvStationList *self, GvStationSlot *slot)
+{
+	GvStation *station;
+
+	if (slot->station)
+		return slot->station;
+
+	station = g_object_new(GV_TYPE_STATION,
+	                       "uid", slot->uid,
+	                       "name", slot->name,
+	                       "uri", slot->uri,
+	                       "insecure", slot->insecure,
+	                       "user-agent", slot->user_agent,
+	                       NULL);
+	gv_station_list_attach(self, slot, station);
+
+	return station;
+}
+
+static GvStation *
+gv_station_list_lookup_index(GvStationList *self, GHashTable *index, const gchar *key)
+{
+	GvStationSlot *slot;
+
+	slot = g_hash_table_lookup(index, key);
+	if (slot == NULL)
+		return NULL;
+
+	return gv_station_list_materialize(self, slot);
+}
+
+/*
+ * Journal
+ * Changes to the station list are appended to a journal that lives next
+ * to the station list file, rather than rewriting the whole file for each
+ * change. The journal starts with the checksum of the station list file
+ * it applies to, then there's one line per operation:
+ *   I <pos> <uri> <name> <insecure> <user-agent>    insert a station
+ *   U <pos> <uri> <name> <insecure> <user-agent>    update a station
+ *   R <pos>                                         remove a station
+ *   M <from> <to>                                   move a station
+ * Fields are separated by tabs, and escaped with g_strescape().
+ */
+
+static gchar *
+journal_escape(const gchar *str)
+{
+	return str ? g_strescape(str, NULL) : g_strdup("");
+}
+
+static gchar *
+journal_unescape(const gchar *str)
+{
+	return str[0] != '\0' ? g_strcompress(str) : NULL;
+}
+
+static void
+journal_print_station(GString *journal, gchar op, guint pos, GvStationSlot *slot)
+{
+	gchar *uri, *name, *user_agent;
+
+	uri = journal_escape(slot->uri);
+	name = journal_escape(slot->name);
+	user_agent = journal_escape(slot->user_agent);
+
+	g_string_append_printf(journal, "%c\t%u\t%s\t%s\t%d\t%s\n", op, pos, uri, name,
+	                       slot->insecure ? 1 : 0, user_agent);
+
+	g_free(user_agent);
+	g_free(name);
+	g_free(uri);
+}
+
+static gboolean
+journal_parse_pos(const gchar *str, guint max, guint *pos)
+{
+	guint64 value;
+
+	if (!g_ascii_string_to_unsigned(str, 10, 0, max, &value, NULL))
+		return FALSE;
+
+	*pos = value;
+	return TRUE;
+}
+
+static void
+journal_update_station(GvStationSlot *slot, GStringChunk *arena, gchar **fields)
+{
+	gchar *uri, *name, *user_agent;
+
+	uri = journal_unescape(fields[0]);
+	name = journal_unescape(fields[1]);
+	user_agent = journal_unescape(fields[3]);
+
+	gv_station_slot_set_fields(slot, arena, uri, name,
+	                           !g_strcmp0(fields[2], "1"), user_agent);
+
+	g_free(user_agent);
+	g_free(name);
+	g_free(uri);
+}
+
+static gboolean
+journal_replay_line(GPtrArray *stations, GStringChunk *arena, const gchar *line)
+{
+	gchar **fields;
+	guint n_fields;
+	guint pos, to;
+	gboolean ret = FALSE;
+
+	fields = g_strsplit(line, "\t", -1);
+	n_fields = g_strv_length(fields);
+
+	if (n_fields < 2 || strlen(fields[0]) != 1)
+		goto end;
+
+	switch (fields[0][0]) {
+	case 'I': {
+		GvStationSlot *slot;
+
+		if (n_fields != 6 || fields[2][0] == '\0' ||
+		    !journal_parse_pos(fields[1], stations->len, &pos))
+			goto end;
+
+		slot = gv_station_slot_new();
+		journal_update_station(slot, arena, fields + 2);
+		g_ptr_array_insert(stations, pos, slot);
+		break;
+	}
+	case 'U':
+		if (n_fields != 6 || fields[2][0] == '\0' || stations->len == 0 ||
+		    !journal_parse_pos(fields[1], stations->len - 1, &pos))
+			goto end;
+
+		journal_update_station(g_ptr_array_index(stations, pos), arena, fields + 2);
+		break;
+	case 'R':
+		if (n_fields != 2 || stations->len == 0 ||
+		    !journal_parse_pos(fields[1], stations->len - 1, &pos))
+			goto end;
+
+		g_ptr_array_remove_index(stations, pos);
+		break;
+	case 'M': {
+		gpointer station;
+
+		if (n_fields != 3 || stations->len == 0 ||
+		    !journal_parse_pos(fields[1], stations->len - 1, &pos) ||
+		    !journal_parse_pos(fields[2], stations->len - 1, &to))
+			goto end;
+
+		station = gv_station_slot_ref(g_ptr_array_index(stations, pos));
+		g_ptr_array_remove_index(stations, pos);
+		g_ptr_array_insert(stations, to, station);
+		break;
+	}
+	default:
+		goto end;
+	}
+
+	ret = TRUE;
+
+end:
+	g_strfreev(fields);
+	return ret;
+}
+
+/* Replay the journal on top of the stations that were loaded from the
+ * station list file with the given checksum. Returns TRUE if the journal
+ * applies and could be replayed entirely, in which case we can keep
+ * appending to it. The number of operations replayed is returned anyway.
+ */
+static gboolean
+replay_journal_from_file(const gchar *path, const gchar *checksum,
+                         GPtrArray *stations, GStringChunk *arena,
+                         gsize *size, guint *n_ops)
+{
+	gchar *text = NULL;
+	gchar *header = NULL;
+	gchar **lines = NULL;
+	gsize length;
+	gboolean ret = FALSE;
+	guint i;
+
+	*n_ops = 0;
+
+	if (!g_file_get_contents(path, &text, &length, NULL))
+		goto end;
+
+	lines = g_strsplit(text, "\n", -1);
+	header = g_strconcat(JOURNAL_HEADER, checksum, NULL);
+	if (g_strcmp0(lines[0], header)) {
+		DEBUG("Journal '%s' doesn't apply to the station list", path);
+		goto end;
+	}
+
+	/* The last line is either empty, or it's an operation that
+	 * was not written entirely, that we can't trust.
+	 */
+	for (i = 1; lines[i] && lines[i + 1]; i++) {
+		if (!journal_replay_line(stations, arena, lines[i])) {
+			WARNING("Invalid line in journal '%s': %s", path, lines[i]);
+			goto end;
+		}
+		*n_ops += 1;
+	}
+
+	*size = length;
+	ret = TRUE;
+
+end:
+	g_strfreev(lines);
+	g_free(header);
+	g_free(text);
+	return ret;
+}
+
+static gboolean
+append_to_file(const gchar *path, const gchar *text, GError **err)
+{
+	FILE *file;
+	gboolean ret = TRUE;
+
+	file = g_fopen(path, "a");
+	if (file == NULL) {
+		g_set_error(err, G_FILE_ERROR, g_file_error_from_errno(errno),
+		            "Failed to open file: %s", g_strerror(errno));
+		return FALSE;
+	}
+
+	if (fputs(text, file) == EOF || fflush(file) != 0 || fsync(fileno(file)) != 0) {
+		g_set_error(err, G_FILE_ERROR, g_file_error_from_errno(errno),
+		            "Failed to write file: %s", g_strerror(errno));
+		ret = FALSE;
+	}
+
+	fclose(file);
+	return ret;
+}
+
+/*
+ * Save thread
+ * Saving is done in a thread, as syncing files to disk can be slow. Most
+ * of the time, we just append the pending operations to the journal.
+ * Once the journal becomes too big, it's compacted: the whole list is
+ * serialized from a snapshot and written, along with the binary cache,
+ * then the journal starts over. There's at most one thread at a time,
+ * and saves requested while it runs are coalesced into a single one.
+ */
+
+typedef struct {
+	GWeakRef  *self;
+	gchar     *path;
+	gchar     *journal_path;
+	/* Either some operations to append to the journal,
+	 * or a snapshot of the station list for a compaction.
+	 */
+	gchar     *journal;
+	GPtrArray *records;
+	/* Binary cache. If the checksum is set, the station list file
+	 * is already on disk, and only the cache must be written.
+	 */
+	gchar     *cache_path;
+	gchar     *checksum;
+	/* Result */
+	gsize      snapshot_size;
+	gsize      journal_size;
+	GError    *err;
+} GvSaveJob;
+
+static void
+gv_save_job_free(GvSaveJob *job)
+{
+	if (job->self) {
+		g_weak_ref_clear(job->self);
+		g_free(job->self);
+	}
+	g_free(job->path);
+	g_free(job->journal_path);
+	g_free(job->journal);
+	g_free(job->cache_path);
+	g_free(job->checksum);
+	if (job->records)
+		g_ptr_array_unref(job->records);
+	g_clear_error(&job->err);
+	g_free(job);
+}
+
+/* Create a save job for the changes made so far, or return NULL
+ * if there's nothing to save.
+ */
+static GvSaveJob *
+gv_save_job_new(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GString *ops = priv->journal_ops;
+	GvSaveJob *job;
+
+	if (priv->journal_path && priv->journal_valid &&
+	    priv->journal_size + ops->len <= MAX(JOURNAL_MIN_SIZE, priv->snapshot_size)) {
+		if (ops->len == 0)
+			return NULL;
+
+		job = g_new0(GvSaveJob, 1);
+		job->journal = g_strdup(ops->str);
+		priv->journal_size += ops->len;
+	} else {
+		job = g_new0(GvSaveJob, 1);
+		job->records = make_station_records(priv->stations);
+		priv->journal_valid = TRUE;
+		priv->journal_size = 0;
+	}
+
+	g_string_truncate(ops, 0);
+
+	job->path = g_strdup(priv->save_path);
+	job->journal_path = g_strdup(priv->journal_path);
+	job->cache_path = g_strdup(priv->cache_path);
+
+	return job;
+}
+
+static void
+gv_save_job_run(GvSaveJob *job)
+{
+	gchar *checksum = NULL;
+	gchar *header = NULL;
+	GError *err = NULL;
+
+	/* Write the binary cache only */
+	if (job->checksum) {
+		save_station_list_to_cache(job->records, job->checksum,
+		                           job->cache_path, &job->err);
+		return;
+	}
+
+	/* Append to the journal */
+	if (job->records == NULL) {
+		append_to_file(job->journal_path, job->journal, &job->err);
+		return;
+	}
+
+	/* Compact, ie. save the whole list, then start a new journal */
+	if (!save_station_list_to_file(job->records, job->path, &checksum,
+	                               &job->snapshot_size, &job->err))
+		goto end;
+
+	/* The cache is not critical, failing to write it is not an error */
+	if (job->cache_path &&
+	    !save_station_list_to_cache(job->records, checksum, job->cache_path, &err)) {
+		WARNING("Failed to write cache: %s", err->message);
+		g_clear_error(&err);
+	}
+
+	if (job->journal_path == NULL)
+		goto end;
+
+	header = g_strconcat(JOURNAL_HEADER, checksum, "\n", NULL);
+	if (g_file_set_contents(job->journal_path, header, -1, &job->err))
+		job->journal_size = strlen(header);
+
+end:
+	g_free(header);
+	g_free(checksum);
+}
+
+static void
+gv_station_list_save_done(GvStationList *self, GvSaveJob *job)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (job->checksum) {
+		if (job->err)
+			WARNING("Failed to write cache: %s", job->err->message);
+		else
+			DEBUG("Station list cache written to '%s'", job->cache_path);
+		return;
+	}
+
+	if (job->err) {
+		WARNING("Failed to save station list: %s", job->err->message);
+		if (priv->finalization == FALSE)
+			gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
+			                        _("Failed to save station list"),
+			                        job->err->message);
+		/* The next save will write everything again */
+		priv->journal_valid = FALSE;
+		return;
+	}
+
+	if (job->records) {
+		INFO("Station list saved to '%s'", job->path);
+		priv->snapshot_size = job->snapshot_size;
+		priv->journal_size = job->journal_size;
+	} else {
+		DEBUG("Station list journal appended to '%s'", job->journal_path);
+	}
+}
+
+static gboolean
+when_idle_save_done(gpointer data)
+{
+	GWeakRef *ref = data;
+	GvStationList *self;
+	GvStationListPrivate *priv;
+	GvSaveJob *job;
+
+	/* The station list might be gone already, in which case
+	 * the job was processed on finalization.
+	 */
+	self = g_weak_ref_get(ref);
+	g_weak_ref_clear(ref);
+	g_free(ref);
+	if (self == NULL)
+		return G_SOURCE_REMOVE;
+
+	priv = self->priv;
+	job = g_thread_join(priv->save_thread);
+	priv->save_thread = NULL;
+
+	gv_station_list_save_done(self, job);
+	gv_save_job_free(job);
+
+	/* Run the save that was requested in the meantime */
+	if (priv->save_pending) {
+		priv->save_pending = FALSE;
+		gv_station_list_save(self);
+	}
+
+	g_object_unref(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gpointer
+save_thread_func(gpointer data)
+{
+	GvSaveJob *job = data;
+	GWeakRef *ref;
+
+	gv_save_job_run(job);
+
+	/* The job goes back with the thread, the main loop only needs to
+	 * know that it's done.
+	 */
+	ref = job->self;
+	job->self = NULL;
+	g_idle_add(when_idle_save_done, ref);
+
+	return job;
+}
+
+static void
+gv_station_list_start_save_thread(GvStationList *self, GvSaveJob *job)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	job->self = g_new0(GWeakRef, 1);
+	g_weak_ref_init(job->self, self);
+
+	priv->save_thread = g_thread_new("station-list-save", save_thread_func, job);
+}
+
+/* Write the binary cache for the station list file that was just loaded */
+static void
+gv_station_list_save_cache(GvStationList *self, const gchar *checksum)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvSaveJob *job;
+
+	if (priv->save_thread)
+		return;
+
+	job = g_new0(GvSaveJob, 1);
+	job->records = make_station_records(priv->stations);
+	job->cache_path = g_strdup(priv->cache_path);
+	job->checksum = g_strdup(checksum);
+
+	gv_station_list_start_save_thread(self, job);
+}
+
+/*
+ * Journal recording
+ */
+
+static void
+gv_station_list_journal_station(GvStationList *self, gchar op, guint pos,
+                                GvStationSlot *slot)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->journal_path == NULL || priv->journal_valid == FALSE)
+		return;
+
+	journal_print_station(priv->journal_ops, op, pos, slot);
+}
+
+static void
+gv_station_list_journal_remove(GvStationList *self, guint pos)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->journal_path == NULL || priv->journal_valid == FALSE)
+		return;
+
+	g_string_append_printf(priv->journal_ops, "R\t%u\n", pos);
+}
+
+static void
+gv_station_list_journal_move(GvStationList *self, guint from, guint to)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->journal_path == NULL || priv->journal_valid == FALSE)
+		return;
+
+	g_string_append_printf(priv->journal_ops, "M\t%u\t%u\n", from, to);
+}
+
+/* Add a slot to the list, and take ownership of it. The position is
+ * clamped to the length of the list, a negative one means the end.
+ */
+static void
+gv_station_list_add_slot(GvStationList *self, GvStationSlot *slot, gint pos)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	gv_station_list_unshare_stations(self);
+	if (pos < 0 || (guint) pos >= priv->stations->len)
+		pos = priv->stations->len;
+	g_ptr_array_insert(priv->stations, pos, slot);
+	gv_station_list_renumber(self, pos, priv->stations->len);
+	gv_station_list_index_slot(self, slot);
+	gv_station_list_journal_station(self, 'I', pos, slot);
+	if (priv->shuffled)
+		shuffle_insert(priv->shuffled, slot);
+}
+
+/*
+ * Import
+ * Station directories are playlists of thousands of entries. They're read
+ * chunk by chunk and parsed on the fly, and the entries are kept aside as
+ * plain records. Once reading is over, they're all appended to the list
+ * in a single batch, straight to slots, without creating station objects.
+ * Hence the list is not left in a batch while waiting for the network.
+ * The first chunk is read in full, so that there's enough to tell the
+ * format from the content.
+ */
+
+typedef struct {
+	GvStationList    *station_list;
+	gchar            *uri;
+	SoupMessage      *msg;
+	GInputStream     *stream;
+	GvPlaylistParser *parser;
+	GPtrArray        *entries;
+	gchar            *buf;
+	gint64            start;
+	guint             n_entries;
+	guint             added;
+	gdouble           rate;
+} GvImport;
+
+/* Append an imported entry, unless a station with the same name, or the
+ * same uri, is already part of the list. Same rules as for insertion, see
+ * gv_station_list_find_duplicate(). Must be called within a batch.
+ */
+static gboolean
+gv_station_list_append_entry(GvStationList *self, GvStationRecord *entry)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationSlot *slot, *other;
+	gchar *uid;
+
+	g_assert(priv->batch_depth > 0);
+
+	if (entry->name && g_hash_table_contains(priv->name_index, entry->name))
+		return FALSE;
+
+	other = g_hash_table_lookup(priv->uri_index, entry->uri);
+	if (other && (entry->name || other->name))
+		return FALSE;
+
+	slot = gv_station_slot_new();
+	gv_station_slot_set_fields(slot, priv->arena, entry->uri, entry->name,
+	                           FALSE, NULL);
+	uid = gv_station_make_uid();
+	slot->uid = g_string_chunk_insert(priv->arena, uid);
+	g_free(uid);
+
+	gv_station_list_add_slot(self, slot, -1);
+	gv_station_list_batch_record(self, slot, NULL, BATCH_ADDED);
+
+	return TRUE;
+}
+
+static void
+on_import_entry_found(const gchar *uri, const gchar *name, gpointer user_data)
+{
+	GvImport *import = user_data;
+
+	import->n_entries++;
+
+	if (!is_uri_scheme_supported(uri)) {
+		DEBUG("Ignoring entry '%s': uri scheme not supported", uri);
+		return;
+	}
+
+	g_ptr_array_add(import->entries, gv_station_record_new(uri, name, FALSE, NULL));
+}
+
+static void
+gv_import_free(GvImport *import)
+{
+	if (import == NULL)
+		return;
+
+	g_assert_null(import->parser);
+
+	g_clear_object(&import->msg);
+	g_clear_object(&import->stream);
+	g_ptr_array_unref(import->entries);
+	g_free(import->buf);
+	g_free(import->uri);
+	g_free(import);
+}
+
+static GvImport *
+gv_import_new(GvStationList *station_list, const gchar *uri)
+{
+	GvImport *import;
+
+	import = g_new0(GvImport, 1);
+	import->station_list = station_list;
+	import->start = g_get_monotonic_time();
+	import->buf = g_malloc(IMPORT_CHUNK_SIZE);
+	import->entries = make_station_record_array();
+
+	/* Local paths are accepted as well */
+	if (is_uri_scheme_supported(uri)) {
+		import->uri = g_strdup(uri);
+		import->msg = soup_message_new("GET", uri);
+	} else {
+		GFile *file;
+
+		file = g_file_new_for_commandline_arg(uri);
+		import->uri = g_file_get_uri(file);
+		g_object_unref(file);
+	}
+
+	return import;
+}
+
+static gboolean
+gv_import_check_message(GvImport *import, GError **err)
+{
+	GTlsCertificateFlags errors = 0;
+	SoupMessage *msg = import->msg;
+
+	/* The session doesn't enforce certificate checks, so we do it here */
+	if (soup_message_get_https_status(msg, NULL, &errors) && errors != 0) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_FAILED,
+		            "Invalid certificate");
+		return FALSE;
+	} else if (SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) == FALSE) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_FAILED,
+		            "Failed to download playlist (%u): %s",
+		            msg->status_code, msg->reason_phrase);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* A remote uri that soup can't make a message of is invalid */
+static gboolean
+gv_import_check_uri(GvImport *import, GError **err)
+{
+	if (import->msg == NULL && is_uri_scheme_supported(import->uri)) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+		            "Invalid uri '%s'", import->uri);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Look at the first chunk, and start parsing if it's a playlist */
+static gboolean
+gv_import_begin(GvImport *import, gsize first_len, GError **err)
+{
+	GvPlaylistFormat format;
+
+	/* If the uri doesn't tell the format, the content does */
+	format = gv_playlist_get_format(import->uri);
+	if (format == GV_PLAYLIST_FORMAT_UNKNOWN || format == GV_PLAYLIST_FORMAT_NONE)
+		format = gv_playlist_sniff_format(import->buf, first_len);
+	if (format == GV_PLAYLIST_FORMAT_NONE) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+		            "'%s' is not a playlist", import->uri);
+		return FALSE;
+	}
+
+	/* Parse as we read, there's no need to keep the whole file around */
+	INFO("Importing stations from '%s'", import->uri);
+	import->parser = gv_playlist_parser_new(format, on_import_entry_found, import);
+
+	return TRUE;
+}
+
+static void
+gv_import_feed(GvImport *import, gsize len)
+{
+	gv_playlist_parser_feed(import->parser, import->buf, len);
+}
+
+/* Append the entries found so far, even if reading failed midway */
+static void
+gv_import_end(GvImport *import, gboolean read_ok, GError **err)
+{
+	GvStationList *self = import->station_list;
+	gint64 elapsed;
+	guint i;
+
+	if (import->parser == NULL)
+		return;
+
+	if (read_ok && gv_playlist_parser_end(import->parser) == FALSE &&
+	    import->n_entries == 0)
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+		            "Failed to parse playlist '%s'", import->uri);
+
+	g_clear_pointer(&import->parser, gv_playlist_parser_free);
+
+	gv_station_list_begin(self);
+	for (i = 0; i < import->entries->len; i++) {
+		GvStationRecord *entry = g_ptr_array_index(import->entries, i);
+
+		if (gv_station_list_append_entry(self, entry))
+			import->added++;
+	}
+	gv_station_list_commit(self);
+	g_ptr_array_set_size(import->entries, 0);
+
+	elapsed = MAX(g_get_monotonic_time() - import->start, 1);
+	import->rate = (gdouble) import->n_entries * G_USEC_PER_SEC / elapsed;
+	INFO("%u stations imported out of %u entries, %.0f entries/s",
+	     import->added, import->n_entries, import->rate);
+}
+
+/* Asynchronous import. The task data is the import, and the task returns
+ * a boolean. The number of stations added is kept in the import, so that
+ * it's known even if the import failed midway.
+ */
+
+static void on_import_read(GObject *source, GAsyncResult *result, gpointer user_data);
+
+static void
+gv_import_task_return(GTask *task, GError *err)
+{
+	GvImport *import = g_task_get_task_data(task);
+
+	gv_import_end(import, err == NULL, &err);
+
+	if (err)
+		g_task_return_error(task, err);
+	else
+		g_task_return_boolean(task, TRUE);
+
+	g_object_unref(task);
+}
+
+static void
+gv_import_task_read(GTask *task)
+{
+	GvImport *import = g_task_get_task_data(task);
+
+	g_input_stream_read_async(import->stream, import->buf, IMPORT_CHUNK_SIZE,
+	                          G_PRIORITY_DEFAULT, g_task_get_cancellable(task),
+	                          on_import_read, task);
+}
+
+static void
+on_import_read(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	GTask *task = G_TASK(user_data);
+	GvImport *import = g_task_get_task_data(task);
+	GError *err = NULL;
+	gssize n_read;
+
+	n_read = g_input_stream_read_finish(G_INPUT_STREAM(source), result, &err);
+	if (n_read <= 0) {
+		gv_import_task_return(task, err);
+		return;
+	}
+
+	gv_import_feed(import, n_read);
+	gv_import_task_read(task);
+}
+
+static void
+on_import_first_read(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	GTask *task = G_TASK(user_data);
+	GvImport *import = g_task_get_task_data(task);
+	GError *err = NULL;
+	gsize first_len;
+
+	if (!g_input_stream_read_all_finish(G_INPUT_STREAM(source), result, &first_len, &err) ||
+	    !gv_import_begin(import, first_len, &err)) {
+		gv_import_task_return(task, err);
+		return;
+	}
+
+	if (first_len == 0) {
+		gv_import_task_return(task, NULL);
+		return;
+	}
+
+	gv_import_feed(import, first_len);
+	gv_import_task_read(task);
+}
+
+static void
+gv_import_task_start_reading(GTask *task, GInputStream *stream, GError *err)
+{
+	GvImport *import = g_task_get_task_data(task);
+
+	if (stream == NULL) {
+		gv_import_task_return(task, err);
+		return;
+	}
+
+	import->stream = stream;
+	g_input_stream_read_all_async(stream, import->buf, IMPORT_CHUNK_SIZE,
+	                              G_PRIORITY_DEFAULT, g_task_get_cancellable(task),
+	                              on_import_first_read, task);
+}
+
+static void
+on_import_sent(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	GTask *task = G_TASK(user_data);
+	GvImport *import = g_task_get_task_data(task);
+	GInputStream *stream;
+	GError *err = NULL;
+
+	stream = soup_session_send_finish(SOUP_SESSION(source), result, &err);
+	if (stream && !gv_import_check_message(import, &err))
+		g_clear_object(&stream);
+
+	gv_import_task_start_reading(task, stream, err);
+}
+
+static void
+on_import_file_read(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	GTask *task = G_TASK(user_data);
+	GFileInputStream *stream;
+	GError *err = NULL;
+
+	stream = g_file_read_finish(G_FILE(source), result, &err);
+	gv_import_task_start_reading(task, (GInputStream *) stream, err);
+}
+
+/*
+ * Signal handlers
+ */
+
+static gboolean
+when_timeout_save_station_list(gpointer data)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+
+	gv_station_list_save(self);
+
+	priv->save_timeout_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gv_station_list_save_delayed(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	/* Wait for the batch to be committed */
+	if (priv->batch_depth > 0)
+		return;
+
+	g_clear_handle_id(&priv->save_timeout_id, g_source_remove);
+	priv->save_timeout_id =
+	        g_timeout_add_seconds(SAVE_DELAY, when_timeout_save_station_list, self);
+}
+
+static gboolean
+when_idle_release_stations(gpointer data)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+	gpointer *stations;
+	guint i, n_stations;
+
+	priv->release_source_id = 0;
+
+	/* Nobody holds these stations anymore, only the slots remain */
+	stations = g_hash_table_get_keys_as_array(priv->unused, &n_stations);
+
+	DEBUG("Releasing %u stations", n_stations);
+
+	for (i = 0; i < n_stations; i++) {
+		GvStationSlot *slot;
+
+		slot = gv_station_list_lookup_slot(self, stations[i]);
+		gv_station_list_detach(self, slot);
+	}
+
+	g_free(stations);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Called when the list becomes the last one to hold a station, and when
+ * somebody else takes a reference again.
+ */
+static void
+on_station_toggle_notify(gpointer  data,
+                         GObject  *object,
+                         gboolean  is_last_ref)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+
+	if (is_last_ref == FALSE) {
+		g_hash_table_remove(priv->unused, object);
+		return;
+	}
+
+	g_hash_table_add(priv->unused, object);
+
+	if (priv->release_source_id == 0)
+		priv->release_source_id = g_idle_add(when_idle_release_stations, self);
+}
+
+static void
+on_station_notify(GvStation     *station,
+                  GParamSpec     *pspec,
+                  GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	const gchar *property_name = g_param_spec_get_name(pspec);
+	GvStationSlot *slot;
+
+	TRACE("%s, %s, %p", gv_station_get_uid(station), property_name, self);
+
+	slot = gv_station_list_lookup_slot(self, station);
+	g_return_if_fail(slot != NULL);
+
+	/* Keep the slot and the indexes up to date */
+	if (!g_strcmp0(property_name, "uri") ||
+	    !g_strcmp0(property_name, "name")) {
+		gv_station_list_unindex_slot(self, slot);
+		priv->arena_dead_size += arena_size(slot->uri) + arena_size(slot->name);
+		slot->uri = arena_insert(priv->arena, gv_station_get_uri(station));
+		slot->name = arena_insert(priv->arena, gv_station_get_name(station));
+		gv_station_list_index_slot(self, slot);
+	} else if (!g_strcmp0(property_name, "insecure")) {
+		slot->insecure = gv_station_get_insecure(station);
+	} else if (!g_strcmp0(property_name, "user-agent")) {
+		priv->arena_dead_size += arena_size(slot->user_agent);
+		slot->user_agent = arena_insert(priv->arena, gv_station_get_user_agent(station));
+	}
+
+	/* We might want to save changes */
+	if (!g_strcmp0(property_name, "uri") ||
+	    !g_strcmp0(property_name, "name") ||
+	    !g_strcmp0(property_name, "insecure") ||
 	    !g_strcmp0(property_name, "user-agent")) {
+		gint pos = gv_station_list_index_of(self, station);
+
+		gv_station_list_journal_station(self, 'U', pos, slot);
 		gv_station_list_save_delayed(self);
 	}
 
@@ -807,11 +2563,104 @@ gv_station_list_set_property(GObject      *object,
  * Public functions
  */
 
+/* Start a batch of changes. Until the batch is committed, the stations
+ * inserted, removed and moved don't trigger any signal, nor any save.
+ * Batches can be nested, only the outermost commit has an effect.
+ */
+void
+gv_station_list_begin(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->batch_depth++ > 0)
+		return;
+
+	priv->batch_changes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+	                                            (GDestroyNotify) gv_batch_change_free);
+}
+
+/* Commit a batch of changes. A single 'changed' signal is emitted, with
+ * a diff that describes what happened to the stations during the batch.
+ * Stations added and moved are ordered as they are in the list, they're
+ * created now if needed, and released when idle if nobody takes them.
+ */
+void
+gv_station_list_commit(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationListDiff diff;
+	GHashTable *changes;
+	GHashTableIter iter;
+	gpointer value;
+	guint i;
+
+	g_return_if_fail(priv->batch_depth > 0);
+
+	if (--priv->batch_depth > 0)
+		return;
+
+	changes = priv->batch_changes;
+	priv->batch_changes = NULL;
+
+	if (g_hash_table_size(changes) == 0)
+		goto out;
+
+	/* Build the diff */
+	diff.added = g_ptr_array_new();
+	diff.removed = g_ptr_array_new();
+	diff.moved = g_ptr_array_new();
+
+	for (i = 0; i < priv->stations->len; i++) {
+		GvStationSlot *slot = g_ptr_array_index(priv->stations, i);
+		GvBatchChange *batch_change;
+
+		batch_change = g_hash_table_lookup(changes, slot->uid);
+		if (batch_change == NULL || batch_change->slot != slot)
+			continue;
+
+		switch (batch_change->change) {
+		case BATCH_ADDED:
+			g_ptr_array_add(diff.added, gv_station_list_materialize(self, slot));
+			break;
+		case BATCH_MOVED:
+			g_ptr_array_add(diff.moved, gv_station_list_materialize(self, slot));
+			break;
+		default:
+			break;
+		}
+	}
+
+	g_hash_table_iter_init(&iter, changes);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		GvBatchChange *batch_change = value;
+
+		if (batch_change->change == BATCH_REMOVED)
+			g_ptr_array_add(diff.removed, batch_change->station);
+	}
+
+	INFO("Committing batch: %u added, %u removed, %u moved",
+	     diff.added->len, diff.removed->len, diff.moved->len);
+
+	/* Emit a signal */
+	g_signal_emit(self, signals[SIGNAL_CHANGED], 0, &diff);
+
+	/* Save */
+	gv_station_list_save_delayed(self);
+
+	g_ptr_array_unref(diff.added);
+	g_ptr_array_unref(diff.removed);
+	g_ptr_array_unref(diff.moved);
+
+out:
+	g_hash_table_destroy(changes);
+}
+
 void
 gv_station_list_remove(GvStationList *self, GvStation *station)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	GvStationSlot *slot;
+	gint pos;
 
 	/* Ensure a valid station was given */
 	if (station == NULL) {
@@ -825,42 +2674,57 @@ gv_station_list_remove(GvStationList *self, GvStation *station)
 	/* Check that we own this station at first. If we don't find it
 	 * in our internal list, it's probably a programming error.
 	 */
-	item = g_list_find(priv->stations, station);
-	if (item == NULL) {
+	pos = gv_station_list_index_of(self, station);
+	if (pos == -1) {
 		WARNING("GvStation %p (%s) not found in list",
 		        station, gv_station_get_uid(station));
 		return;
 	}
 
-	/* Disconnect signal handlers */
-	g_signal_handlers_disconnect_by_data(station, self);
+	/* Keep the station alive until we're done */
+	g_object_ref(station);
 
 	/* Remove from list */
-	priv->stations = g_list_remove_link(priv->stations, item);
-	g_list_free(item);
-
-	/* Unown the station */
-	g_object_unref(station);
-
-	/* Rebuild the shuffled station list */
-	if (priv->shuffled) {
-		g_list_free_full(priv->shuffled, g_object_unref);
-		priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-		                 copy_func_object_ref, NULL);
+	gv_station_list_unshare_stations(self);
+	slot = gv_station_slot_ref(g_ptr_array_index(priv->stations, pos));
+	g_ptr_array_remove_index(priv->stations, pos);
+	gv_station_list_renumber(self, pos, priv->stations->len);
+	gv_station_list_unindex_slot(self, slot);
+	gv_station_list_journal_remove(self, pos);
+	if (priv->shuffled)
+		shuffle_remove(priv->shuffled, slot);
+
+	/* Unown the station, its strings are not used anymore */
+	gv_station_list_detach(self, slot);
+	slot->removed = TRUE;
+	priv->arena_dead_size += gv_station_slot_get_size(slot);
+
+	/* In a batch, record the change, and we're done */
+	if (priv->batch_depth > 0) {
+		gv_station_list_batch_record(self, slot, station, BATCH_REMOVED);
+		gv_station_slot_unref(slot);
+		g_object_unref(station);
+		return;
 	}
 
+	/* Free the slot */
+	gv_station_slot_unref(slot);
+
 	/* Emit a signal */
 	g_signal_emit(self, signals[SIGNAL_STATION_REMOVED], 0, station);
 
 	/* Save */
 	gv_station_list_save_delayed(self);
+
+	g_object_unref(station);
 }
 
 void
 gv_station_list_insert(GvStationList *self, GvStation *station, gint pos)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *similar_item;
+	GvStationSlot *slot;
+	GvStation *duplicate;
 
 	g_return_if_fail(station != NULL);
 
@@ -870,28 +2734,37 @@ gv_station_list_insert(GvStationList *self, GvStation *station, gint pos)
 	/* Check that the station is not already part of the list.
 	 * Duplicates are a programming error, we must warn about that.
 	 * Identical fields are an user error.
-	 * Warnings and such are encapsulated in the GCompareFunc used
-	 * here, this is messy but temporary (hopefully).
 	 */
-	similar_item = g_list_find_custom(priv->stations, station,
-	                                  (GCompareFunc) are_stations_similar);
-	if (similar_item)
+	duplicate = gv_station_list_find_duplicate(self, station);
+	if (duplicate == station ||
+	    (duplicate && !g_strcmp0(gv_station_get_uid(duplicate),
+	                             gv_station_get_uid(station)))) {
+		WARNING("Station %p (%s) is already part of the list",
+		        station, gv_station_get_uid(station));
 		return;
+	} else if (duplicate) {
+		DEBUG("Station '%s' is similar to station '%s', not inserting",
+		      gv_station_get_name_or_uri(station),
+		      gv_station_get_name_or_uri(duplicate));
+		return;
+	}
 
-	/* Take ownership of the station */
-	g_object_ref_sink(station);
+	/* Create a slot, and take ownership of the station */
+	slot = gv_station_slot_new();
+	gv_station_slot_set_fields(slot, priv->arena,
+	                           gv_station_get_uri(station),
+	                           gv_station_get_name(station),
+	                           gv_station_get_insecure(station),
+	                           gv_station_get_user_agent(station));
+	gv_station_list_attach(self, slot, station);
 
 	/* Add to the list at the right position */
-	priv->stations = g_list_insert(priv->stations, station, pos);
-
-	/* Connect to notify signal */
-	g_signal_connect_object(station, "notify", G_CALLBACK(on_station_notify), self, 0);
+	gv_station_list_add_slot(self, slot, pos);
 
-	/* Rebuild the shuffled station list */
-	if (priv->shuffled) {
-		g_list_free_full(priv->shuffled, g_object_unref);
-		priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-		                 copy_func_object_ref, NULL);
+	/* In a batch, record the change, and we're done */
+	if (priv->batch_depth > 0) {
+		gv_station_list_batch_record(self, slot, NULL, BATCH_ADDED);
+		return;
 	}
 
 	/* Emit a signal */
@@ -904,12 +2777,11 @@ gv_station_list_insert(GvStationList *self, GvStation *station, gint pos)
 void
 gv_station_list_insert_before(GvStationList *self, GvStation *station, GvStation *before)
 {
-	GvStationListPrivate *priv = self->priv;
 	gint pos;
 
 	g_return_if_fail(before != NULL);
 
-	pos = g_list_index(priv->stations, before);
+	pos = gv_station_list_index_of(self, before);
 	g_return_if_fail(pos != -1);
 
 	gv_station_list_insert(self, station, pos);
@@ -918,12 +2790,11 @@ gv_station_list_insert_before(GvStationList *self, GvStation *station, GvStation
 void
 gv_station_list_insert_after(GvStationList *self, GvStation *station, GvStation *after)
 {
-	GvStationListPrivate *priv = self->priv;
 	gint pos;
 
 	g_return_if_fail(after != NULL);
 
-	pos = g_list_index(priv->stations, after);
+	pos = gv_station_list_index_of(self, after);
 	g_return_if_fail(pos != -1);
 
 	pos += 1;
@@ -946,18 +2817,39 @@ void
 gv_station_list_move(GvStationList *self, GvStation *station, gint pos)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	GvStationSlot *slot;
+	gint old_pos;
 
 	g_return_if_fail(station != NULL);
 
 	/* Find the station */
-	item = g_list_find(priv->stations, station);
-	g_return_if_fail(item != NULL);
+	old_pos = gv_station_list_index_of(self, station);
+	g_return_if_fail(old_pos != -1);
+
+	/* Compute the new position. The position given is understood as
+	 * an index in the list *before* the station is removed from it.
+	 */
+	if (pos < 0 || (guint) pos > priv->stations->len)
+		pos = priv->stations->len;
+	if (old_pos < pos)
+		pos -= 1;
 
 	/* Move it */
-	priv->stations = g_list_insert(priv->stations, station, pos);
-	priv->stations = g_list_remove_link(priv->stations, item);
-	g_list_free(item);
+	slot = g_ptr_array_index(priv->stations, old_pos);
+	if (old_pos != pos) {
+		gv_station_list_unshare_stations(self);
+		gv_station_slot_ref(slot);
+		g_ptr_array_remove_index(priv->stations, old_pos);
+		g_ptr_array_insert(priv->stations, pos, slot);
+		gv_station_list_renumber(self, MIN(old_pos, pos), MAX(old_pos, pos));
+		gv_station_list_journal_move(self, old_pos, pos);
+	}
+
+	/* In a batch, record the change, and we're done */
+	if (priv->batch_depth > 0) {
+		gv_station_list_batch_record(self, slot, NULL, BATCH_MOVED);
+		return;
+	}
 
 	/* Emit a signal */
 	g_signal_emit(self, signals[SIGNAL_STATION_MOVED], 0, station);
@@ -969,12 +2861,11 @@ gv_station_list_move(GvStationList *self, GvStation *station, gint pos)
 void
 gv_station_list_move_before(GvStationList *self, GvStation *station, GvStation *before)
 {
-	GvStationListPrivate *priv = self->priv;
 	gint pos;
 
 	g_return_if_fail(before != NULL);
 
-	pos = g_list_index(priv->stations, before);
+	pos = gv_station_list_index_of(self, before);
 	g_return_if_fail(pos != -1);
 
 	gv_station_list_move(self, station, pos);
@@ -983,12 +2874,11 @@ gv_station_list_move_before(GvStationList *self, GvStation *station, GvStation *
 void
 gv_station_list_move_after(GvStationList *self, GvStation *station, GvStation *after)
 {
-	GvStationListPrivate *priv = self->priv;
 	gint pos;
 
 	g_return_if_fail(after != NULL);
 
-	pos = g_list_index(priv->stations, after);
+	pos = gv_station_list_index_of(self, after);
 	g_return_if_fail(pos != -1);
 
 	pos += 1;
@@ -1012,65 +2902,72 @@ gv_station_list_prev(GvStationList *self, GvStation *station,
                      gboolean repeat, gboolean shuffle)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *stations, *item;
+	GPtrArray *shuffled;
+	GvStationSlot *slot;
+	guint last;
+	gint pos;
 
-	/* Pickup the right station list, create shuffle list if needed */
-	if (shuffle) {
-		if (priv->shuffled == NULL) {
-			priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-			                 copy_func_object_ref, NULL);
-		}
-		stations = priv->shuffled;
-	} else {
-		if (priv->shuffled) {
-			g_list_free_full(priv->shuffled, g_object_unref);
-			priv->shuffled = NULL;
-		}
-		stations = priv->stations;
+	/* Without shuffle, walk the station array */
+	if (shuffle == FALSE) {
+		g_clear_pointer(&priv->shuffled, g_ptr_array_unref);
+
+		/* If the station list is empty, bail out */
+		if (priv->stations->len == 0)
+			return NULL;
+
+		/* Return last station for NULL argument */
+		if (station == NULL)
+			return gv_station_list_last(self);
+
+		/* Try to find station in station list */
+		pos = gv_station_list_index_of(self, station);
+		if (pos == -1)
+			return NULL;
+
+		/* Return previous station if any */
+		if (pos > 0)
+			return gv_station_list_at(self, pos - 1);
+
+		/* With repeat, return the last station */
+		return repeat ? gv_station_list_last(self) : NULL;
 	}
 
+	/* Pickup the shuffled order, create it if needed */
+	if (priv->shuffled == NULL)
+		priv->shuffled = shuffle_new(priv->stations);
+	shuffled = priv->shuffled;
+
 	/* If the station list is empty, bail out */
-	if (stations == NULL)
+	if (shuffled->len == 0)
 		return NULL;
 
 	/* Return last station for NULL argument */
+	last = shuffled->len - 1;
 	if (station == NULL)
-		return g_list_last(stations)->data;
+		return gv_station_list_materialize(self, g_ptr_array_index(shuffled, last));
 
 	/* Try to find station in station list */
-	item = g_list_find(stations, station);
-	if (item == NULL)
+	slot = gv_station_list_lookup_slot(self, station);
+	if (slot == NULL)
 		return NULL;
 
 	/* Return previous station if any */
-	item = item->prev;
-	if (item)
-		return item->data;
+	if (slot->shuffle_pos > 0)
+		return gv_station_list_materialize(self, g_ptr_array_index(shuffled,
+		                                                           slot->shuffle_pos - 1));
 
 	/* Without repeat, there's no more station */
 	if (!repeat)
 		return NULL;
 
-	/* With repeat, we may re-shuffle, then return the last station */
-	if (shuffle) {
-		GList *last_item;
-
-		stations = g_list_shuffle(priv->shuffled);
-
-		/* In case the last station (that we're about to return) happens to be
-		 * the same as the current station, we do a little a magic trick.
-		 */
-		last_item = g_list_last(stations);
-		if (last_item->data == station) {
-			stations = g_list_remove_link(stations, last_item);
-			stations = g_list_prepend(stations, last_item->data);
-			g_list_free(last_item);
-		}
-
-		priv->shuffled = stations;
-	}
+	/* With repeat, we re-shuffle, then return the last station. In case
+	 * it happens to be the current station, it's swapped with the first.
+	 */
+	shuffle_all(shuffled);
+	if (g_ptr_array_index(shuffled, last) == slot)
+		shuffle_swap(shuffled, last, 0);
 
-	return g_list_last(stations)->data;
+	return gv_station_list_materialize(self, g_ptr_array_index(shuffled, last));
 }
 
 GvStation *
@@ -1078,121 +2975,183 @@ gv_station_list_next(GvStationList *self, GvStation *station,
                      gboolean repeat, gboolean shuffle)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *stations, *item;
+	GPtrArray *shuffled;
+	GvStationSlot *slot;
+	guint last;
+	gint pos;
 
-	/* Pickup the right station list, create shuffle list if needed */
-	if (shuffle) {
-		if (priv->shuffled == NULL) {
-			priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-			                 copy_func_object_ref, NULL);
-		}
-		stations = priv->shuffled;
-	} else {
-		if (priv->shuffled) {
-			g_list_free_full(priv->shuffled, g_object_unref);
-			priv->shuffled = NULL;
-		}
-		stations = priv->stations;
+	/* Without shuffle, walk the station array */
+	if (shuffle == FALSE) {
+		g_clear_pointer(&priv->shuffled, g_ptr_array_unref);
+
+		/* If the station list is empty, bail out */
+		if (priv->stations->len == 0)
+			return NULL;
+
+		/* Return first station for NULL argument */
+		if (station == NULL)
+			return gv_station_list_first(self);
+
+		/* Try to find station in station list */
+		pos = gv_station_list_index_of(self, station);
+		if (pos == -1)
+			return NULL;
+
+		/* Return next station if any */
+		if ((guint) pos + 1 < priv->stations->len)
+			return gv_station_list_at(self, pos + 1);
+
+		/* With repeat, return the first station */
+		return repeat ? gv_station_list_first(self) : NULL;
 	}
 
+	/* Pickup the shuffled order, create it if needed */
+	if (priv->shuffled == NULL)
+		priv->shuffled = shuffle_new(priv->stations);
+	shuffled = priv->shuffled;
+
 	/* If the station list is empty, bail out */
-	if (stations == NULL)
+	if (shuffled->len == 0)
 		return NULL;
 
 	/* Return first station for NULL argument */
+	last = shuffled->len - 1;
 	if (station == NULL)
-		return stations->data;
+		return gv_station_list_materialize(self, g_ptr_array_index(shuffled, 0));
 
 	/* Try to find station in station list */
-	item = g_list_find(stations, station);
-	if (item == NULL)
+	slot = gv_station_list_lookup_slot(self, station);
+	if (slot == NULL)
 		return NULL;
 
 	/* Return next station if any */
-	item = item->next;
-	if (item)
-		return item->data;
+	if (slot->shuffle_pos < last)
+		return gv_station_list_materialize(self, g_ptr_array_index(shuffled,
+		                                                           slot->shuffle_pos + 1));
 
 	/* Without repeat, there's no more station */
 	if (!repeat)
 		return NULL;
 
-	/* With repeat, we may re-shuffle, then return the first station */
-	if (shuffle) {
-		GList *first_item;
-
-		stations = g_list_shuffle(priv->shuffled);
-
-		/* In case the first station (that we're about to return) happens to be
-		 * the same as the current station, we do a little a magic trick.
-		 */
-		first_item = g_list_first(stations);
-		if (first_item->data == station) {
-			stations = g_list_remove_link(stations, first_item);
-			stations = g_list_append(stations, first_item->data);
-			g_list_free(first_item);
-		}
-
-		priv->shuffled = stations;
-	}
+	/* With repeat, we re-shuffle, then return the first station. In case
+	 * it happens to be the current station, it's swapped with the last.
+	 */
+	shuffle_all(shuffled);
+	if (g_ptr_array_index(shuffled, 0) == slot)
+		shuffle_swap(shuffled, 0, last);
 
-	return stations->data;
+	return gv_station_list_materialize(self, g_ptr_array_index(shuffled, 0));
 }
 
 GvStation *
 gv_station_list_first(GvStationList *self)
 {
-	GList *stations = self->priv->stations;
+	GPtrArray *stations = self->priv->stations;
 
-	if (stations == NULL)
+	if (stations->len == 0)
 		return NULL;
 
-	return g_list_first(stations)->data;
+	return gv_station_list_at(self, 0);
 }
 
 GvStation *
 gv_station_list_last(GvStationList *self)
 {
-	GList *stations = self->priv->stations;
+	GPtrArray *stations = self->priv->stations;
 
-	if (stations == NULL)
+	if (stations->len == 0)
 		return NULL;
 
-	return g_list_last(stations)->data;
+	return gv_station_list_at(self, stations->len - 1);
 }
 
+/* Stations returned are owned by the list. They're created on demand, and
+ * released when the main loop is idle, unless somebody holds a reference.
+ */
 GvStation *
 gv_station_list_at(GvStationList *self, guint n)
 {
-	GList *stations = self->priv->stations;
-	GList *item;
+	GPtrArray *stations = self->priv->stations;
 
-	if (stations == NULL)
+	if (n >= stations->len)
 		return NULL;
 
-	item = g_list_nth(stations, n);
-	if (item == NULL)
-		return NULL;
+	return gv_station_list_materialize(self, g_ptr_array_index(stations, n));
+}
+
+/* Return the position of a station in the list, or -1 if the station
+ * is not part of the list.
+ */
+gint
+gv_station_list_index_of(GvStationList *self, GvStation *station)
+{
+	GvStationSlot *slot;
+
+	slot = gv_station_list_lookup_slot(self, station);
+	if (slot == NULL || slot->removed)
+		return -1;
 
-	return item->data;
+	return slot->pos;
 }
 
-GvStation *
-gv_station_list_find(GvStationList *self, GvStation *station)
+/* Get the fields of a station, without creating the station object.
+ * Strings returned are owned by the station list, and remain valid until
+ * the list is modified. The name might be NULL.
+ */
+gboolean
+gv_station_list_get_data_at(GvStationList *self, guint n, const gchar **uid,
+                            const gchar **name, const gchar **uri)
+{
+	GPtrArray *stations = self->priv->stations;
+	GvStationSlot *slot;
+
+	if (n >= stations->len)
+		return FALSE;
+
+	slot = g_ptr_array_index(stations, n);
+
+	if (uid)
+		*uid = slot->uid;
+	if (name)
+		*name = slot->name;
+	if (uri)
+		*uri = slot->uri;
+
+	return TRUE;
+}
+
+/* Same as above, the station is found by uid. Return its position in
+ * the list, or -1 if there's no such station.
+ */
+gint
+gv_station_list_get_data_by_uid(GvStationList *self, const gchar *uid,
+                                const gchar **name, const gchar **uri)
 {
-	GList *stations = self->priv->stations;
-	GList *item;
+	GvStationSlot *slot;
 
-	item = g_list_find(stations, station);
+	g_return_val_if_fail(uid != NULL, -1);
 
-	return item ? item->data : NULL;
+	slot = g_hash_table_lookup(self->priv->uid_index, uid);
+	if (slot == NULL)
+		return -1;
+
+	if (name)
+		*name = slot->name;
+	if (uri)
+		*uri = slot->uri;
+
+	return slot->pos;
 }
 
 GvStation *
-gv_station_list_find_by_name(GvStationList *self, const gchar *name)
+gv_station_list_find(GvStationList *self, GvStation *station)
 {
-	GList *item;
+	return gv_station_list_lookup_slot(self, station) ? station : NULL;
+}
 
+GvStation *
+gv_station_list_find_by_name(GvStationList *self, const gchar *name)
+{
 	/* Ensure station name is valid */
 	if (name == NULL) {
 		WARNING("Attempting to find a station with NULL name");
@@ -1203,53 +3162,73 @@ gv_station_list_find_by_name(GvStationList *self, const gchar *name)
 	if (!g_strcmp0(name, ""))
 		return NULL;
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(name, gv_station_get_name(station)))
-			return station;
-	}
-
-	return NULL;
+	return gv_station_list_lookup_index(self, self->priv->name_index, name);
 }
 
 GvStation *
 gv_station_list_find_by_uri(GvStationList *self, const gchar *uri)
 {
-	GList *item;
-
 	/* Ensure station name is valid */
 	if (uri == NULL) {
 		WARNING("Attempting to find a station with NULL uri");
 		return NULL;
 	}
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(uri, gv_station_get_uri(station)))
-			return station;
-	}
-
-	return NULL;
+	return gv_station_list_lookup_index(self, self->priv->uri_index, uri);
 }
 
 GvStation *
 gv_station_list_find_by_uid(GvStationList *self, const gchar *uid)
 {
-	GList *item;
-
 	/* Ensure station name is valid */
 	if (uid == NULL) {
 		WARNING("Attempting to find a station with NULL uid");
 		return NULL;
 	}
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(uid, gv_station_get_uid(station)))
-			return station;
+	return gv_station_list_lookup_index(self, self->priv->uid_index, uid);
+}
+
+/* Find a station of the list that conflicts with the station given, ie.
+ * a station that is the same, or that has the same uid, name or uri.
+ * Stations that both have no name are allowed to share the same uri.
+ * Returns the conflicting station, or NULL if there's none.
+ */
+GvStation *
+gv_station_list_find_duplicate(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	const gchar *uid, *name, *uri;
+	GvStationSlot *other;
+
+	g_return_val_if_fail(station != NULL, NULL);
+
+	/* Same station */
+	if (gv_station_list_lookup_slot(self, station))
+		return station;
+
+	/* Same uid */
+	uid = gv_station_get_uid(station);
+	if (uid) {
+		other = g_hash_table_lookup(priv->uid_index, uid);
+		if (other)
+			return gv_station_list_materialize(self, other);
+	}
+
+	/* Same name */
+	name = gv_station_get_name(station);
+	if (name) {
+		other = g_hash_table_lookup(priv->name_index, name);
+		if (other)
+			return gv_station_list_materialize(self, other);
+	}
+
+	/* Same uri */
+	uri = gv_station_get_uri(station);
+	if (uri) {
+		other = g_hash_table_lookup(priv->uri_index, uri);
+		if (other && (name || other->name))
+			return gv_station_list_materialize(self, other);
 	}
 
 	return NULL;
@@ -1265,37 +3244,210 @@ gv_station_list_find_by_guessing(GvStationList *self, const gchar *string)
 		return gv_station_list_find_by_name(self, string);
 }
 
+/* Download the playlists of the stations that don't know their streams
+ * yet. Downloads run concurrently, within the limits of the http session.
+ * Stations are only created for the playlists that must be downloaded.
+ * Returns the number of downloads started.
+ */
+guint
+gv_station_list_download_playlists(GvStationList *self)
+{
+	GPtrArray *stations = self->priv->stations;
+	guint count = 0;
+	guint i;
+
+	for (i = 0; i < stations->len; i++) {
+		GvStationSlot *slot = g_ptr_array_index(stations, i);
+		GvStation *station;
+
+		/* An audio stream, nothing to download */
+		if (gv_playlist_get_format(slot->uri) == GV_PLAYLIST_FORMAT_NONE)
+			continue;
+
+		/* The streams are known already, from a previous download */
+		if (slot->station == NULL && gv_core_playlist_cache) {
+			GSList *streams;
+			gboolean cached;
+
+			streams = gv_playlist_cache_lookup(gv_core_playlist_cache, slot->uri);
+			cached = streams != NULL;
+			g_slist_free_full(streams, g_free);
+			if (cached)
+				continue;
+		}
+
+		station = gv_station_list_materialize(self, slot);
+		if (gv_station_get_stream_uris(station))
+			continue;
+
+		if (gv_station_download_playlist(station, NULL))
+			count++;
+	}
+
+	DEBUG("Downloading %u playlists", count);
+
+	return count;
+}
+
+/* Import the stations of a playlist, either a local file or a remote one.
+ * The format is told by the uri, or by the first bytes of the playlist.
+ * Stations are appended in a single batch, and duplicates are skipped.
+ * Returns the number of stations added, which might be non-zero even if
+ * an error is set, when reading failed midway. If rate is not NULL, it's
+ * set to the number of playlist entries processed per second.
+ *
+ * This blocks until the whole playlist is read, and should not be used
+ * from the main loop, see gv_station_list_import_async() instead.
+ */
+guint
+gv_station_list_import(GvStationList *self, const gchar *uri, gdouble *rate,
+                       GError **err)
+{
+	GError *import_err = NULL;
+	GvImport *import;
+	gsize first_len;
+	gssize n_read;
+	guint added;
+
+	g_return_val_if_fail(uri != NULL, 0);
+
+	import = gv_import_new(self, uri);
+	if (!gv_import_check_uri(import, &import_err))
+		goto out;
+
+	if (import->msg) {
+		import->stream = soup_session_send(gv_core_soup_session, import->msg,
+		                                   NULL, &import_err);
+		if (import->stream && !gv_import_check_message(import, &import_err))
+			g_clear_object(&import->stream);
+	} else {
+		GFile *file;
+
+		file = g_file_new_for_uri(import->uri);
+		import->stream = (GInputStream *) g_file_read(file, NULL, &import_err);
+		g_object_unref(file);
+	}
+
+	if (import->stream == NULL)
+		goto out;
+
+	if (!g_input_stream_read_all(import->stream, import->buf, IMPORT_CHUNK_SIZE,
+	                             &first_len, NULL, &import_err) ||
+	    !gv_import_begin(import, first_len, &import_err))
+		goto out;
+
+	n_read = first_len;
+	while (n_read > 0) {
+		gv_import_feed(import, n_read);
+		n_read = g_input_stream_read(import->stream, import->buf, IMPORT_CHUNK_SIZE,
+		                             NULL, &import_err);
+	}
+
+	gv_import_end(import, n_read == 0, &import_err);
+
+out:
+	if (rate)
+		*rate = import->rate;
+	if (import_err)
+		g_propagate_error(err, import_err);
+
+	added = import->added;
+	gv_import_free(import);
+
+	return added;
+}
+
+/* Same as gv_station_list_import(), except that the playlist is read
+ * asynchronously. Stations are added to the list as they're parsed, and
+ * the changes are signaled once the whole playlist was read.
+ */
 void
-gv_station_list_save(GvStationList *self)
+gv_station_list_import_async(GvStationList *self, const gchar *uri,
+                             GCancellable *cancellable,
+                             GAsyncReadyCallback callback, gpointer user_data)
 {
-	GvStationListPrivate *priv = self->priv;
-	const gchar *path = priv->save_path;
 	GError *err = NULL;
-	gboolean ret;
+	GvImport *import;
+	GTask *task;
+
+	g_return_if_fail(uri != NULL);
 
-	/* Save the station list */
-	ret = save_station_list_to_file(priv->stations, path, &err);
-	if (ret == TRUE) {
-		INFO("Station list saved to '%s'", path);
+	import = gv_import_new(self, uri);
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_task_data(task, import, (GDestroyNotify) gv_import_free);
+
+	if (!gv_import_check_uri(import, &err)) {
+		gv_import_task_return(task, err);
+		return;
+	}
+
+	if (import->msg) {
+		soup_session_send_async(gv_core_soup_session, import->msg, cancellable,
+		                        on_import_sent, task);
 	} else {
-		WARNING("Failed to save station list: %s", err->message);
-		if (priv->finalization == FALSE)
-			gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
-			                        _("Failed to save station list"), err->message);
-		g_error_free(err);
+		GFile *file;
+
+		file = g_file_new_for_uri(import->uri);
+		g_file_read_async(file, G_PRIORITY_DEFAULT, cancellable,
+		                  on_import_file_read, task);
+		g_object_unref(file);
+	}
+}
+
+guint
+gv_station_list_import_finish(GvStationList *self, GAsyncResult *result,
+                              gdouble *rate, GError **err)
+{
+	GvImport *import;
+
+	g_return_val_if_fail(g_task_is_valid(result, self), 0);
+
+	import = g_task_get_task_data(G_TASK(result));
+	if (rate)
+		*rate = import->rate;
+
+	g_task_propagate_boolean(G_TASK(result), err);
+
+	return import->added;
+}
+
+void
+gv_station_list_save(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvSaveJob *job;
+
+	/* If a save is already in progress, we'll run again afterwards */
+	if (priv->save_thread) {
+		priv->save_pending = TRUE;
+		return;
 	}
+
+	/* Reclaim the strings that are not used anymore */
+	if (priv->finalization == FALSE)
+		gv_station_list_compact_arena(self);
+
+	/* Save the changes in a thread */
+	job = gv_save_job_new(self);
+	if (job == NULL)
+		return;
+
+	gv_station_list_start_save_thread(self, job);
 }
 
 void
 gv_station_list_load(GvStationList *self)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	GPtrArray *records = NULL;
+	gchar *checksum = NULL;
+	gboolean cached = FALSE;
+	guint i;
 
 	TRACE("%p", self);
 
 	/* This should be called only once at startup */
-	g_assert_null(priv->stations);
+	g_assert_cmpuint(priv->stations->len, ==, 0);
 
 	/* If a single load path is defined, try to load the station list
 	 * from there. It must work. Failing to load from this path is a
@@ -1307,7 +3459,9 @@ gv_station_list_load(GvStationList *self)
 		GError *err = NULL;
 		gboolean ret;
 
-		ret = load_station_list_from_file(path, &priv->stations, &err);
+		ret = load_station_list_from_file(path, priv->cache_path, &records,
+		                                  &checksum, &priv->snapshot_size,
+		                                  &cached, &err);
 		if (ret == FALSE) {
 			ERROR("Failed to load station list from '%s': %s",
 			       path, err->message);
@@ -1334,7 +3488,9 @@ gv_station_list_load(GvStationList *self)
 			GError *err = NULL;
 			gboolean ret;
 
-			ret = load_station_list_from_file(path, &priv->stations, &err);
+			ret = load_station_list_from_file(path, priv->cache_path, &records,
+			                                  &checksum, &priv->snapshot_size,
+			                                  &cached, &err);
 			if (ret == FALSE) {
 				if (err->code != G_FILE_ERROR_NOENT)
 					WARNING("Failed to load station list from '%s': %s",
@@ -1358,7 +3514,7 @@ gv_station_list_load(GvStationList *self)
 		gboolean ret;
 
 		ret = load_station_list_from_string(priv->default_stations,
-				&priv->stations, NULL);
+				&records, NULL);
 
 		if (ret == FALSE) {
 			ERROR("Failed to load station list from hard-coded default");
@@ -1370,14 +3526,64 @@ gv_station_list_load(GvStationList *self)
 	}
 
 finish:
+	/* Fill the station array. No station object is created at this
+	 * point, only slots, with the strings interned in the arena.
+	 */
+	gv_station_list_unshare_stations(self);
+	if (records) {
+		for (i = 0; i < records->len; i++) {
+			GvStationRecord *record = g_ptr_array_index(records, i);
+			GvStationSlot *slot;
+
+			slot = gv_station_slot_new();
+			gv_station_slot_set_fields(slot, priv->arena, record->uri,
+			                           record->name, record->insecure,
+			                           record->user_agent);
+			g_ptr_array_add(priv->stations, slot);
+		}
+		g_ptr_array_unref(records);
+	}
+
+	/* Write the binary cache if it was not up to date, so that
+	 * the next load is faster.
+	 */
+	if (checksum && priv->cache_path && cached == FALSE)
+		gv_station_list_save_cache(self, checksum);
+
+	/* Replay the journal, if it applies to the file that was loaded.
+	 * If it doesn't, the next save will write the whole list.
+	 */
+	if (checksum && priv->journal_path) {
+		guint n_ops;
+
+		priv->journal_valid = replay_journal_from_file(priv->journal_path, checksum,
+		                                               priv->stations, priv->arena,
+		                                               &priv->journal_size, &n_ops);
+		DEBUG("Replayed %u operations from journal", n_ops);
+		if (priv->journal_valid == FALSE && n_ops > 0)
+			gv_station_list_save_delayed(self);
+	}
+
+	g_free(checksum);
+
+	gv_station_list_renumber(self, 0, priv->stations->len);
+
 	/* Dump the number of stations */
 	DEBUG("Station list has %u stations", gv_station_list_length(self));
 
-	/* Register a notify handler for each station */
-	for (item = priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
+	/* Give each station an uid, and index it. Uids are unique, there's
+	 * no point in sharing them in the arena.
+	 */
+	for (i = 0; i < priv->stations->len; i++) {
+		GvStationSlot *slot = g_ptr_array_index(priv->stations, i);
+
+		if (slot->uid == NULL) {
+			gchar *uid = gv_station_make_uid();
+			slot->uid = g_string_chunk_insert(priv->arena, uid);
+			g_free(uid);
+		}
 
-		g_signal_connect_object(station, "notify", G_CALLBACK(on_station_notify), self, 0);
+		gv_station_list_index_slot(self, slot);
 	}
 
 	/* Emit a signal to indicate that the list has been loaded */
@@ -1389,7 +3595,7 @@ gv_station_list_length(GvStationList *self)
 {
 	GvStationListPrivate *priv = self->priv;
 
-	return g_list_length(priv->stations);
+	return priv->stations->len;
 }
 
 /* Create a new station list with load paths and save path derived
@@ -1440,32 +3646,81 @@ gv_station_list_finalize(GObject *object)
 {
 	GvStationList *self = GV_STATION_LIST(object);
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	guint i;
 
 	TRACE("%p", object);
 
 	/* Indicate that the object is being finalized */
 	priv->finalization = TRUE;
 
-	/* Run any pending save operation */
-	if (priv->save_timeout_id > 0)
-		when_timeout_save_station_list(self);
+	/* Wait for the save in progress, and process it, as the main loop
+	 * won't do it for us.
+	 */
+	if (priv->save_thread) {
+		GvSaveJob *job;
+
+		job = g_thread_join(priv->save_thread);
+		priv->save_thread = NULL;
+		gv_station_list_save_done(self, job);
+		gv_save_job_free(job);
+	}
+
+	/* Run any pending save operation, and wait for it to complete */
+	if (priv->save_timeout_id > 0 || priv->save_pending) {
+		GvSaveJob *job;
+
+		g_clear_handle_id(&priv->save_timeout_id, g_source_remove);
+		job = gv_save_job_new(self);
+		if (job) {
+			gv_save_job_run(job);
+			gv_station_list_save_done(self, job);
+			gv_save_job_free(job);
+		}
+	}
+
+	/* Free journal */
+	g_string_free(priv->journal_ops, TRUE);
+	g_free(priv->journal_path);
+	g_free(priv->cache_path);
+
+	/* Free shuffled order */
+	if (priv->shuffled)
+		g_ptr_array_unref(priv->shuffled);
+
+	/* Free indexes */
+	g_hash_table_destroy(priv->uid_index);
+	g_hash_table_destroy(priv->name_index);
+	g_hash_table_destroy(priv->uri_index);
 
-	/* Free shuffled station list */
-	g_list_free_full(priv->shuffled, g_object_unref);
+	/* Drop any batch left uncommitted */
+	if (priv->batch_changes)
+		g_hash_table_destroy(priv->batch_changes);
 
 	/* Free station list and ensure no memory is leaked. This works only if the
 	 * station list is the last object to hold references to stations. In other
 	 * words, the station list must be the last object finalized.
 	 */
-	for (item = priv->stations; item; item = item->next) {
-		g_object_add_weak_pointer(G_OBJECT(item->data), &(item->data));
-		g_object_unref(item->data);
-		if (item->data != NULL)
-			WARNING("Station '%s' has not been finalized!",
-			        gv_station_get_name_or_uri(GV_STATION(item->data)));
+	g_clear_handle_id(&priv->release_source_id, g_source_remove);
+	for (i = 0; i < priv->stations->len; i++) {
+		GvStationSlot *slot = g_ptr_array_index(priv->stations, i);
+		gpointer station = slot->station;
+
+		if (station) {
+			g_object_add_weak_pointer(G_OBJECT(station), &station);
+			gv_station_list_detach(self, slot);
+			if (station != NULL) {
+				WARNING("Station '%s' has not been finalized!",
+				        gv_station_get_name_or_uri(GV_STATION(station)));
+				g_object_remove_weak_pointer(G_OBJECT(station), &station);
+			}
+		}
+
+		slot->removed = TRUE;
 	}
-	g_list_free(priv->stations);
+	g_ptr_array_unref(priv->stations);
+	g_hash_table_destroy(priv->materialized);
+	g_hash_table_destroy(priv->unused);
+	g_string_chunk_free(priv->arena);
 
 	/* Free resources */
 	g_free(priv->default_stations);
@@ -1481,9 +3736,30 @@ static void
 gv_station_list_constructed(GObject *object)
 {
 	GvStationList *self = GV_STATION_LIST(object);
+	GvStationListPrivate *priv = self->priv;
 
 	TRACE("%p", self);
 
+	/* Journal and cache, unless we don't save for real */
+	if (priv->save_path && g_strcmp0(priv->save_path, "/dev/null")) {
+		priv->journal_path = g_strconcat(priv->save_path, JOURNAL_SUFFIX, NULL);
+		priv->cache_path = g_strconcat(priv->save_path, CACHE_SUFFIX, NULL);
+	}
+	priv->journal_ops = g_string_new(NULL);
+
+	/* Slot array, shared with iterators */
+	priv->stations = g_ptr_array_new_with_free_func((GDestroyNotify) gv_station_slot_unref);
+	priv->arena = g_string_chunk_new(4096);
+
+	/* Station objects, they're held by a toggle reference */
+	priv->materialized = g_hash_table_new(g_direct_hash, g_direct_equal);
+	priv->unused = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/* Indexes, keys belong to the arena and slots are not owned */
+	priv->uid_index = g_hash_table_new(g_str_hash, g_str_equal);
+	priv->name_index = g_hash_table_new(g_str_hash, g_str_equal);
+	priv->uri_index = g_hash_table_new(g_str_hash, g_str_equal);
+
 	/* Chain up */
 	G_OBJECT_CHAINUP_CONSTRUCTED(gv_station_list, object);
 }
@@ -1555,4 +3831,12 @@ gv_station_list_class_init(GvStationListClass *class)
 	        g_signal_new("station-moved", G_TYPE_FROM_CLASS(class),
 	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
 			     G_TYPE_NONE, 1, G_TYPE_OBJECT);
+
+	/* Emitted when a batch is committed, instead of the signals above.
+	 * The argument is a GvStationListDiff, valid during the emission only.
+	 */
+	signals[SIGNAL_CHANGED] =
+	        g_signal_new("changed", G_TYPE_FROM_CLASS(class),
+	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+			     G_TYPE_NONE, 1, G_TYPE_POINTER);
 }
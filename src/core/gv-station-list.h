@@ -22,6 +22,7 @@
 #pragma once
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include "core/gv-station.h"
 
@@ -35,15 +36,40 @@ G_DECLARE_FINAL_TYPE(GvStationList, gv_station_list, GV, STATION_LIST, GObject)
 
 typedef struct _GvStationListIter GvStationListIter;
 
+/* Changes made during a batch, as arrays of GvStation */
+
+typedef struct {
+	GPtrArray *added;
+	GPtrArray *removed;
+	GPtrArray *moved;
+} GvStationListDiff;
+
 /* Methods */
 
 GvStationList *gv_station_list_new_from_xdg_dirs(const gchar *default_stations);
 GvStationList *gv_station_list_new_from_paths   (const gchar *load_path,
                                                  const gchar *save_path);
 
-void  gv_station_list_load  (GvStationList *self);
-void  gv_station_list_save  (GvStationList *self);
-guint gv_station_list_length(GvStationList *self);
+void  gv_station_list_load              (GvStationList *self);
+void  gv_station_list_save              (GvStationList *self);
+guint gv_station_list_length            (GvStationList *self);
+guint gv_station_list_download_playlists(GvStationList *self);
+guint gv_station_list_import            (GvStationList *self,
+                                         const gchar   *uri,
+                                         gdouble       *rate,
+                                         GError       **err);
+void  gv_station_list_import_async      (GvStationList       *self,
+                                         const gchar         *uri,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         gpointer             user_data);
+guint gv_station_list_import_finish     (GvStationList *self,
+                                         GAsyncResult  *result,
+                                         gdouble       *rate,
+                                         GError       **err);
+
+void gv_station_list_begin (GvStationList *self);
+void gv_station_list_commit(GvStationList *self);
 
 void gv_station_list_prepend      (GvStationList *self, GvStation *station);
 void gv_station_list_append       (GvStationList *self, GvStation *station);
@@ -61,6 +87,11 @@ void gv_station_list_move_last  (GvStationList *self, GvStation *station);
 GvStation *gv_station_list_first(GvStationList *self);
 GvStation *gv_station_list_last (GvStationList *self);
 GvStation *gv_station_list_at   (GvStationList *self, guint n);
+gint       gv_station_list_index_of(GvStationList *self, GvStation *station);
+gboolean   gv_station_list_get_data_at    (GvStationList *self, guint n, const gchar **uid,
+                                           const gchar **name, const gchar **uri);
+gint       gv_station_list_get_data_by_uid(GvStationList *self, const gchar *uid,
+                                           const gchar **name, const gchar **uri);
 GvStation *gv_station_list_prev (GvStationList *self, GvStation *station, gboolean repeat,
                                  gboolean shuffle);
 GvStation *gv_station_list_next (GvStationList *self, GvStation *station, gboolean repeat,
@@ -71,12 +102,16 @@ GvStation *gv_station_list_find_by_name    (GvStationList *self, const gchar *na
 GvStation *gv_station_list_find_by_uri     (GvStationList *self, const gchar *uri);
 GvStation *gv_station_list_find_by_uid     (GvStationList *self, const gchar *uid);
 GvStation *gv_station_list_find_by_guessing(GvStationList *self, const gchar *string);
+GvStation *gv_station_list_find_duplicate  (GvStationList *self, GvStation *station);
 
 /* Iterator methods */
 
 GvStationListIter *gv_station_list_iter_new (GvStationList *self);
 void               gv_station_list_iter_free(GvStationListIter *iter);
 gboolean           gv_station_list_iter_loop(GvStationListIter *iter, GvStation **station);
+gboolean           gv_station_list_iter_loop_data(GvStationListIter *iter, const gchar **uid,
+                                                  const gchar **name, const gchar **uri);
+guint              gv_station_list_get_snapshot_copies(GvStationList *self);
 
 /* Property accessors */
 
@@ -66,6 +66,12 @@ enum {
 
 static guint signals[SIGNAL_N];
 
+/*
+ * Unique ids
+ */
+
+static gint uid_counter = 1;
+
 /*
  * GObject definitions
  */
@@ -85,6 +91,11 @@ struct _GvStationPrivate {
 	gchar  *user_agent;
 	/* Learnt along the way */
 	GSList *stream_uris;
+	/* Playlist downloads in flight, and whether the stream uris are
+	 * the first one found by a download that is not over yet.
+	 */
+	guint   n_downloads;
+	gboolean early_stream_uri;
 };
 
 typedef struct _GvStationPrivate GvStationPrivate;
@@ -108,14 +119,33 @@ copy_func_strdup(gconstpointer src, gpointer data G_GNUC_UNUSED)
 	return g_strdup(src);
 }
 
+static gboolean
+str_list_equal(GSList *a, GSList *b)
+{
+	while (a && b) {
+		if (g_strcmp0(a->data, b->data))
+			return FALSE;
+		a = a->next;
+		b = b->next;
+	}
+
+	return a == NULL && b == NULL;
+}
+
 static void
 gv_station_set_stream_uris(GvStation *self, GSList *uris)
 {
 	GvStationPrivate *priv = self->priv;
 
+	/* Whatever we had, it's not an early stream uri anymore */
+	priv->early_stream_uri = FALSE;
+
 	if (uris == priv->stream_uris)
 		return;
 
+	if (uris && str_list_equal(uris, priv->stream_uris))
+		return;
+
 	if (priv->stream_uris) {
 		g_slist_free_full(priv->stream_uris, g_free);
 		priv->stream_uris = NULL;
@@ -145,15 +175,62 @@ gv_station_set_stream_uri(GvStation *self, const gchar *uri)
  * Signal handlers
  */
 
+static void
+on_playlist_stream_found(GvPlaylist  *playlist,
+                         const gchar *uri,
+                         GvStation   *self)
+{
+	GvStationPrivate *priv = self->priv;
+
+	/* The playlist might have been changed in the meantime */
+	if (g_strcmp0(priv->uri, gv_playlist_get_uri(playlist)))
+		return;
+
+	/* If we have no stream yet, the first one will do for now,
+	 * there's no need to wait for the rest of the playlist.
+	 */
+	if (priv->stream_uris == NULL) {
+		gv_station_set_stream_uri(self, uri);
+		priv->early_stream_uri = TRUE;
+	}
+}
+
 static void
 on_playlist_downloaded(GvPlaylist *playlist,
                        GvStation  *self)
 {
+	GvStationPrivate *priv = self->priv;
+	gboolean early_stream_uri;
 	GSList *streams;
 
+	g_assert(priv->n_downloads > 0);
+	priv->n_downloads--;
+
+	early_stream_uri = priv->early_stream_uri;
+	priv->early_stream_uri = FALSE;
+
+	/* The playlist might have been changed in the meantime */
+	if (g_strcmp0(priv->uri, gv_playlist_get_uri(playlist)))
+		goto end;
+
+	if (gv_core_playlist_cache)
+		gv_playlist_cache_store(gv_core_playlist_cache, playlist);
+
+	/* Nothing new, what we have is still good */
+	if (gv_playlist_get_not_modified(playlist))
+		goto end;
+
+	/* Download failed or cancelled, keep the streams we had before, if
+	 * any. The stream found while downloading doesn't count, the playlist
+	 * it comes from was never fully downloaded.
+	 */
 	streams = gv_playlist_get_stream_list(playlist);
+	if (streams == NULL && priv->stream_uris != NULL && !early_stream_uri)
+		goto end;
+
 	gv_station_set_stream_uris(self, streams);
 
+end:
 	g_object_unref(playlist);
 }
 
@@ -167,6 +244,18 @@ gv_station_get_uid(GvStation *self)
 	return self->priv->uid;
 }
 
+static void
+gv_station_set_uid(GvStation *self, const gchar *uid)
+{
+	GvStationPrivate *priv = self->priv;
+
+	/* This is a construct-only property, NULL means that
+	 * an uid is generated when the object is constructed.
+	 */
+	g_assert_null(priv->uid);
+	priv->uid = g_strdup(uid);
+}
+
 const gchar *
 gv_station_get_name(GvStation *self)
 {
@@ -228,13 +317,20 @@ gv_station_set_uri(GvStation *self, const gchar *uri)
 	priv->uri = g_strdup(uri);
 
 	/* The uri either refers to a playlist, either to an audio stream.
-	 * We "guess" it right now:  if it does not seem to be a playlist,
-	 * then it's probably an audio stream, and so we save it as such.
+	 * We "guess" it right now:  if it's an audio stream, we save it as
+	 * such. If we can't tell, we'll find out when downloading it.
 	 */
-	if (gv_playlist_get_format(uri) == GV_PLAYLIST_FORMAT_UNKNOWN)
+	if (gv_playlist_get_format(uri) == GV_PLAYLIST_FORMAT_NONE) {
 		gv_station_set_stream_uri(self, uri);
-	else
-		gv_station_set_stream_uri(self, NULL);
+	} else {
+		/* We might know the streams already, from a previous download */
+		GSList *streams = NULL;
+
+		if (gv_core_playlist_cache)
+			streams = gv_playlist_cache_lookup(gv_core_playlist_cache, uri);
+		gv_station_set_stream_uris(self, streams);
+		g_slist_free_full(streams, g_free);
+	}
 
 	/* Notify */
 	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_URI]);
@@ -354,6 +450,9 @@ gv_station_set_property(GObject      *object,
 	TRACE_SET_PROPERTY(object, property_id, value, pspec);
 
 	switch (property_id) {
+	case PROP_UID:
+		gv_station_set_uid(self, g_value_get_string(value));
+		break;
 	case PROP_NAME:
 		gv_station_set_name(self, g_value_get_string(value));
 		break;
@@ -377,7 +476,7 @@ gv_station_set_property(GObject      *object,
  */
 
 gboolean
-gv_station_download_playlist(GvStation *self)
+gv_station_download_playlist(GvStation *self, GCancellable *cancellable)
 {
 	GvStationPrivate *priv = self->priv;
 	GvPlaylist *playlist;
@@ -387,20 +486,66 @@ gv_station_download_playlist(GvStation *self)
 		return FALSE;
 	}
 
-	if (gv_playlist_get_format(priv->uri) == GV_PLAYLIST_FORMAT_UNKNOWN) {
+	if (gv_playlist_get_format(priv->uri) == GV_PLAYLIST_FORMAT_NONE) {
 		WARNING("Uri doesn't seem to be a playlist");
 		return FALSE;
 	}
 
-	/* No need to keep track of that, it's unreferenced in the callback */
+	/* No need to keep track of that, it's unreferenced in the callback.
+	 * The playlist holds a reference on the station until then, as
+	 * nobody else might hold the station while it's downloading.
+	 */
 	playlist = gv_playlist_new(priv->uri);
-	g_signal_connect_object(playlist, "downloaded", G_CALLBACK(on_playlist_downloaded), self, 0);
+	if (gv_core_playlist_cache)
+		gv_playlist_cache_prepare(gv_core_playlist_cache, playlist);
+	g_signal_connect_object(playlist, "stream-found", G_CALLBACK(on_playlist_stream_found), self, 0);
+	g_signal_connect_data(playlist, "downloaded", G_CALLBACK(on_playlist_downloaded),
+	                      g_object_ref(self), (GClosureNotify) g_object_unref, 0);
+	priv->n_downloads++;
 	gv_playlist_download(playlist, priv->insecure,
-	                     priv->user_agent ? priv->user_agent : gv_core_user_agent);
+	                     priv->user_agent ? priv->user_agent : gv_core_user_agent,
+	                     cancellable);
 
 	return TRUE;
 }
 
+/* Download the playlist again in the background, if our copy is stale */
+gboolean
+gv_station_revalidate_playlist(GvStation *self, GCancellable *cancellable)
+{
+	GvStationPrivate *priv = self->priv;
+
+	if (priv->uri == NULL)
+		return FALSE;
+
+	/* Only playlists that we downloaded already */
+	switch (gv_playlist_get_format(priv->uri)) {
+	case GV_PLAYLIST_FORMAT_UNKNOWN:
+	case GV_PLAYLIST_FORMAT_NONE:
+		return FALSE;
+	default:
+		break;
+	}
+
+	/* A download in flight will bring the latest anyway */
+	if (priv->n_downloads > 0)
+		return FALSE;
+
+	if (gv_core_playlist_cache &&
+	    gv_playlist_cache_is_fresh(gv_core_playlist_cache, priv->uri))
+		return FALSE;
+
+	DEBUG("Revalidating playlist '%s'", priv->uri);
+	return gv_station_download_playlist(self, cancellable);
+}
+
+/* Return a new unique id, for a station that doesn't exist yet */
+gchar *
+gv_station_make_uid(void)
+{
+	return g_strdup_printf("%u", (guint) g_atomic_int_add(&uid_counter, 1));
+}
+
 gchar *
 gv_station_make_name(GvStation *self, gboolean escape)
 {
@@ -458,8 +603,12 @@ gv_station_constructed(GObject *object)
 
 	TRACE("%p", object);
 
-	/* Initialize properties */
-	priv->uid = g_strdup_printf("%p", self);
+	/* Initialize properties. The uid is a counter rather than the address
+	 * of the object, as the station list creates and destroys stations on
+	 * demand, and addresses get reused.
+	 */
+	if (priv->uid == NULL)
+		priv->uid = gv_station_make_uid();
 	priv->insecure = DEFAULT_INSECURE;
 
 	/* Chain up */
@@ -492,7 +641,7 @@ gv_station_class_init(GvStationClass *class)
 
 	properties[PROP_UID] =
 	        g_param_spec_string("uid", "UID", NULL, NULL,
-	                            GV_PARAM_READABLE);
+	                            GV_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
 
 	properties[PROP_NAME] =
 	        g_param_spec_string("name", "Name", NULL, NULL,
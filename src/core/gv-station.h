@@ -22,6 +22,7 @@
 #pragma once
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 /* GObject declarations */
 
@@ -31,9 +32,11 @@ G_DECLARE_FINAL_TYPE(GvStation, gv_station, GV, STATION, GInitiallyUnowned)
 
 /* Methods */
 
-GvStation *gv_station_new              (const gchar *name, const gchar *uri);
-gchar     *gv_station_make_name        (GvStation *self, gboolean escape);
-gboolean   gv_station_download_playlist(GvStation *self);
+GvStation *gv_station_new                (const gchar *name, const gchar *uri);
+gchar     *gv_station_make_uid           (void);
+gchar     *gv_station_make_name          (GvStation *self, gboolean escape);
+gboolean   gv_station_download_playlist  (GvStation *self, GCancellable *cancellable);
+gboolean   gv_station_revalidate_playlist(GvStation *self, GCancellable *cancellable);
 
 /* Property accessors */
 
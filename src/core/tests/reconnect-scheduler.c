@@ -0,0 +1,285 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2021 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+#include <mutest.h>
+
+#include "base/log.h"
+#include "core/gv-reconnect-scheduler.h"
+
+/*
+ * A network monitor that we control
+ */
+
+#define FAKE_TYPE_NETWORK_MONITOR fake_network_monitor_get_type()
+
+G_DECLARE_FINAL_TYPE(FakeNetworkMonitor, fake_network_monitor, FAKE, NETWORK_MONITOR, GObject)
+
+enum {
+	PROP_0,
+	PROP_NETWORK_AVAILABLE,
+	PROP_NETWORK_METERED,
+	PROP_CONNECTIVITY,
+};
+
+struct _FakeNetworkMonitor {
+	GObject  parent_instance;
+	gboolean available;
+};
+
+static void fake_network_monitor_initable_init(GInitableIface *iface);
+static void fake_network_monitor_iface_init(GNetworkMonitorInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(FakeNetworkMonitor, fake_network_monitor, G_TYPE_OBJECT,
+                        G_IMPLEMENT_INTERFACE(G_TYPE_INITABLE,
+                                              fake_network_monitor_initable_init)
+                        G_IMPLEMENT_INTERFACE(G_TYPE_NETWORK_MONITOR,
+                                              fake_network_monitor_iface_init))
+
+static gboolean
+fake_network_monitor_initable_init_impl(GInitable *initable G_GNUC_UNUSED,
+                                        GCancellable *cancellable G_GNUC_UNUSED,
+                                        GError **error G_GNUC_UNUSED)
+{
+	return TRUE;
+}
+
+static void
+fake_network_monitor_initable_init(GInitableIface *iface)
+{
+	iface->init = fake_network_monitor_initable_init_impl;
+}
+
+static void
+fake_network_monitor_iface_init(GNetworkMonitorInterface *iface G_GNUC_UNUSED)
+{
+}
+
+static void
+fake_network_monitor_get_property(GObject *object, guint property_id,
+                                  GValue *value, GParamSpec *pspec)
+{
+	FakeNetworkMonitor *self = FAKE_NETWORK_MONITOR(object);
+
+	switch (property_id) {
+	case PROP_NETWORK_AVAILABLE:
+		g_value_set_boolean(value, self->available);
+		break;
+	case PROP_NETWORK_METERED:
+		g_value_set_boolean(value, FALSE);
+		break;
+	case PROP_CONNECTIVITY:
+		g_value_set_enum(value, self->available ?
+		                 G_NETWORK_CONNECTIVITY_FULL :
+		                 G_NETWORK_CONNECTIVITY_LOCAL);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+static void
+fake_network_monitor_init(FakeNetworkMonitor *self)
+{
+	self->available = TRUE;
+}
+
+static void
+fake_network_monitor_class_init(FakeNetworkMonitorClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+
+	object_class->get_property = fake_network_monitor_get_property;
+
+	g_object_class_override_property(object_class, PROP_NETWORK_AVAILABLE,
+	                                 "network-available");
+	g_object_class_override_property(object_class, PROP_NETWORK_METERED,
+	                                 "network-metered");
+	g_object_class_override_property(object_class, PROP_CONNECTIVITY,
+	                                 "connectivity");
+}
+
+static void
+fake_network_monitor_set_available(FakeNetworkMonitor *self, gboolean available)
+{
+	self->available = available;
+	g_signal_emit_by_name(self, "network-changed", available);
+}
+
+/*
+ * Tests
+ */
+
+static void
+on_reconnect(GvReconnectScheduler *scheduler G_GNUC_UNUSED, guint *count)
+{
+	*count += 1;
+}
+
+static void
+reconnect_scheduler_backoff(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	FakeNetworkMonitor *monitor;
+	GvReconnectScheduler *s;
+	guint delay1, delay2, delay3;
+
+	monitor = g_object_new(FAKE_TYPE_NETWORK_MONITOR, NULL);
+	s = gv_reconnect_scheduler_new(G_NETWORK_MONITOR(monitor));
+
+	delay1 = gv_reconnect_scheduler_schedule(s, "http://a.example.com/stream");
+	delay2 = gv_reconnect_scheduler_schedule(s, "http://b.example.com/stream");
+	delay3 = gv_reconnect_scheduler_schedule(s, "http://c.example.com/stream");
+
+	mutest_expect("first delay is within jitter bounds",
+			mutest_bool_value(delay1 >= 250 && delay1 <= 500),
+			mutest_to_be_true,
+			NULL);
+
+	mutest_expect("second delay is within jitter bounds",
+			mutest_bool_value(delay2 >= 500 && delay2 <= 1000),
+			mutest_to_be_true,
+			NULL);
+
+	mutest_expect("third delay is within jitter bounds",
+			mutest_bool_value(delay3 >= 1000 && delay3 <= 2000),
+			mutest_to_be_true,
+			NULL);
+
+	mutest_expect("a reconnection is pending",
+			mutest_bool_value(gv_reconnect_scheduler_is_pending(s)),
+			mutest_to_be_true,
+			NULL);
+
+	gv_reconnect_scheduler_succeeded(s, "http://c.example.com/stream");
+	delay1 = gv_reconnect_scheduler_schedule(s, "http://c.example.com/stream");
+
+	mutest_expect("success resets the backoff",
+			mutest_bool_value(delay1 >= 250 && delay1 <= 500),
+			mutest_to_be_true,
+			NULL);
+
+	gv_reconnect_scheduler_cancel(s);
+
+	mutest_expect("no reconnection is pending after cancel",
+			mutest_bool_value(gv_reconnect_scheduler_is_pending(s)),
+			mutest_to_be_false,
+			NULL);
+
+	g_object_unref(s);
+	g_object_unref(monitor);
+}
+
+static void
+reconnect_scheduler_circuit_breaker(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	FakeNetworkMonitor *monitor;
+	GvReconnectScheduler *s;
+	guint delay = 0;
+	guint i;
+
+	monitor = g_object_new(FAKE_TYPE_NETWORK_MONITOR, NULL);
+	s = gv_reconnect_scheduler_new(G_NETWORK_MONITOR(monitor));
+
+	for (i = 0; i < 5; i++)
+		delay = gv_reconnect_scheduler_schedule(s, "http://a.example.com/stream");
+
+	mutest_expect("a failing host is left alone for a while",
+			mutest_bool_value(delay > 50000 && delay <= 60000),
+			mutest_to_be_true,
+			NULL);
+
+	delay = gv_reconnect_scheduler_schedule(s, "http://b.example.com/stream");
+
+	mutest_expect("other hosts are not affected",
+			mutest_bool_value(delay <= 20000),
+			mutest_to_be_true,
+			NULL);
+
+	g_object_unref(s);
+	g_object_unref(monitor);
+}
+
+static void
+reconnect_scheduler_network(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	FakeNetworkMonitor *monitor;
+	GvReconnectScheduler *s;
+	guint count = 0;
+	guint delay;
+
+	monitor = g_object_new(FAKE_TYPE_NETWORK_MONITOR, NULL);
+	s = gv_reconnect_scheduler_new(G_NETWORK_MONITOR(monitor));
+	g_signal_connect(s, "reconnect", G_CALLBACK(on_reconnect), &count);
+
+	fake_network_monitor_set_available(monitor, FALSE);
+	delay = gv_reconnect_scheduler_schedule(s, "http://a.example.com/stream");
+
+	mutest_expect("wait for the network when it's down",
+			mutest_bool_value(delay == GV_RECONNECT_SCHEDULER_WAIT_NETWORK),
+			mutest_to_be_true,
+			NULL);
+
+	mutest_expect("a reconnection is pending",
+			mutest_bool_value(gv_reconnect_scheduler_is_pending(s)),
+			mutest_to_be_true,
+			NULL);
+
+	fake_network_monitor_set_available(monitor, TRUE);
+
+	mutest_expect("reconnect as soon as the network is back",
+			mutest_int_value(count),
+			mutest_to_be, 1,
+			NULL);
+
+	mutest_expect("no reconnection is pending anymore",
+			mutest_bool_value(gv_reconnect_scheduler_is_pending(s)),
+			mutest_to_be_false,
+			NULL);
+
+	delay = gv_reconnect_scheduler_schedule(s, "http://a.example.com/stream");
+	fake_network_monitor_set_available(monitor, FALSE);
+	fake_network_monitor_set_available(monitor, TRUE);
+
+	mutest_expect("a pending reconnection survives a network outage",
+			mutest_int_value(count),
+			mutest_to_be, 2,
+			NULL);
+
+	g_object_unref(s);
+	g_object_unref(monitor);
+}
+
+static void
+reconnect_scheduler_suite(mutest_suite_t *suite G_GNUC_UNUSED)
+{
+	mutest_it("back off exponentially, with jitter", reconnect_scheduler_backoff);
+	mutest_it("open the circuit for a failing host", reconnect_scheduler_circuit_breaker);
+	mutest_it("follow the network state", reconnect_scheduler_network);
+}
+
+MUTEST_MAIN(
+	log_init(NULL, TRUE, NULL);
+	g_setenv("GOODVIBES_IN_TEST_SUITE", "1", TRUE);
+	mutest_describe("gv-reconnect-scheduler", reconnect_scheduler_suite);
+)
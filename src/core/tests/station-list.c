@@ -19,6 +19,8 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <glib-object.h>
@@ -26,6 +28,7 @@
 
 #include "default-stations.h"
 #include "base/log.h"
+#include "core/gv-playlist.h"
 #include "core/gv-station-list.h"
 
 #define TOUCHTMP(tmpl) g_close(g_mkstemp(tmpl), NULL)
@@ -76,7 +79,7 @@ static void
 station_list_load_save_empty(mutest_spec_t *spec G_GNUC_UNUSED)
 {
 	GvStationList *s;
-	gchar *input, *output;
+	gchar *input, *output, *journal, *cache;
 	gchar template[] = "/tmp/gv-station-list-XXXXXX.xml";
 
 	TOUCHTMP(template);
@@ -165,6 +168,12 @@ station_list_load_save_empty(mutest_spec_t *spec G_GNUC_UNUSED)
 			mutest_to_be_null,
 			NULL);
 
+	journal = g_strconcat(output, ".journal", NULL);
+	g_unlink(journal);
+	g_free(journal);
+	cache = g_strconcat(output, ".cache", NULL);
+	g_unlink(cache);
+	g_free(cache);
 	g_unlink(output);
 }
 
@@ -183,7 +192,8 @@ match_station_list_against_array(mutest_expect_t *e,
 		GvStation *a = (GvStation *) g_ptr_array_index(array, i);
 		GvStation *b = gv_station_list_at(s, i);
 
-		if (a != b) {
+		/* Positions must be kept up to date along the way */
+		if (a != b || gv_station_list_index_of(s, a) != (gint) i) {
 			ret = FALSE;
 			break;
 		}
@@ -215,6 +225,92 @@ make_station_array(GvStation *stations[], ...)
 	return array;
 }
 
+/* Create stations named s0, s1... with uris http://sta0.com... */
+static void
+make_stations(GvStation *stations[], guint n)
+{
+	guint i;
+
+	for (i = 0; i < n; i++) {
+		gchar *name = g_strdup_printf("s%u", i);
+		gchar *url = g_strdup_printf("http://sta%u.com", i);
+		stations[i] = gv_station_new(name, url);
+		g_free(name);
+		g_free(url);
+	}
+}
+
+static void
+station_list_journal(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *ss[3];
+	gchar *journal, *cache;
+	gchar template[] = "/tmp/gv-station-list-XXXXXX.xml";
+	gsize length;
+	guint i;
+
+	TOUCHTMP(template);
+	journal = g_strconcat(template, ".journal", NULL);
+	cache = g_strconcat(template, ".cache", NULL);
+
+	/* Save a station list, the first save writes the whole list */
+	s = gv_station_list_new_from_paths("/dev/null", template);
+	gv_station_list_load(s);
+	make_stations(ss, 3);
+	for (i = 0; i < 3; i++)
+		gv_station_list_append(s, ss[i]);
+	gv_station_list_save(s);
+	g_object_unref(s);
+
+	length = get_file_length(template);
+	mutest_expect("journal was created",
+			mutest_bool_value(g_file_test(journal, G_FILE_TEST_EXISTS)),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("cache was created",
+			mutest_bool_value(g_file_test(cache, G_FILE_TEST_EXISTS)),
+			mutest_to_be_true,
+			NULL);
+
+	/* Reload it, modify it, changes should go to the journal */
+	s = gv_station_list_new_from_paths(template, template);
+	gv_station_list_load(s);
+	gv_station_set_name(gv_station_list_at(s, 1), "renamed");
+	gv_station_list_move_last(s, gv_station_list_first(s));
+	gv_station_list_remove(s, gv_station_list_at(s, 1));
+	gv_station_list_prepend(s, gv_station_new("s3", "http://sta3.com"));
+	g_object_unref(s);
+
+	mutest_expect("station list file was not rewritten",
+			mutest_int_value(get_file_length(template)),
+			mutest_to_be, (gint) length,
+			NULL);
+
+	/* Reload it again, and check that the journal was replayed */
+	s = gv_station_list_new_from_paths(template, template);
+	gv_station_list_load(s);
+
+	mutest_expect("list has 3 stations",
+			mutest_int_value(gv_station_list_length(s)),
+			mutest_to_be, 3,
+			NULL);
+	mutest_expect("list is [s3, renamed, s0]",
+			mutest_bool_value(gv_station_list_at(s, 0) == gv_station_list_find_by_name(s, "s3") &&
+			                  gv_station_list_at(s, 1) == gv_station_list_find_by_name(s, "renamed") &&
+			                  gv_station_list_at(s, 2) == gv_station_list_find_by_name(s, "s0")),
+			mutest_to_be_true,
+			NULL);
+
+	g_object_unref(s);
+
+	g_unlink(cache);
+	g_unlink(journal);
+	g_unlink(template);
+	g_free(cache);
+	g_free(journal);
+}
+
 static void
 station_list_add_move_remove(mutest_spec_t *spec G_GNUC_UNUSED)
 {
@@ -235,14 +331,9 @@ station_list_add_move_remove(mutest_spec_t *spec G_GNUC_UNUSED)
 	 * array, so that at the end of the test, we can check that the array
 	 * is completely NULL.
 	 */
-	for (i = 0; i < 7; i++) {
-		gchar *name = g_strdup_printf("s%u", i);
-		gchar *url = g_strdup_printf("http://sta%u.com", i);
-		ss[i] = gv_station_new(name, url);
+	make_stations(ss, 7);
+	for (i = 0; i < 7; i++)
 		g_object_add_weak_pointer(G_OBJECT(ss[i]), (gpointer *) &ss[i]);
-		g_free(name);
-		g_free(url);
-	}
 
 	/* Station list is empty to start with */
 	mutest_expect("list is []",
@@ -363,6 +454,20 @@ station_list_add_move_remove(mutest_spec_t *spec G_GNUC_UNUSED)
 			mutest_pointer(make_station_array(ss, 1, 2, 3, 5, 6, -1)),
 			NULL);
 
+	/* Check positions */
+	mutest_expect("ss[5] is at position 3",
+			mutest_int_value(gv_station_list_index_of(s, ss[5])),
+			mutest_to_be, 3,
+			NULL);
+	mutest_expect("position 4 is ss[6]",
+			mutest_bool_value(gv_station_list_at(s, 4) == ss[6]),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("there is no position 5",
+			mutest_pointer(gv_station_list_at(s, 5)),
+			mutest_to_be_null,
+			NULL);
+
 	/* Time to remove stations one by one */
 	gv_station_list_remove(s, ss[1]);
 	mutest_expect("list is [2, 3, 5, 6]",
@@ -402,6 +507,671 @@ station_list_add_move_remove(mutest_spec_t *spec G_GNUC_UNUSED)
 	g_assert_null(s);
 }
 
+static void
+station_list_find(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *ss[3];
+	guint i;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+
+	make_stations(ss, 3);
+	for (i = 0; i < 3; i++)
+		gv_station_list_append(s, ss[i]);
+
+	mutest_expect("find_by_uid() finds the station",
+			mutest_bool_value(gv_station_list_find_by_uid(s, gv_station_get_uid(ss[1])) == ss[1]),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("find_by_name() finds the station",
+			mutest_bool_value(gv_station_list_find_by_name(s, "s2") == ss[2]),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("find_by_uri() finds the station",
+			mutest_bool_value(gv_station_list_find_by_uri(s, "http://sta0.com") == ss[0]),
+			mutest_to_be_true,
+			NULL);
+
+	/* Rename a station */
+	gv_station_set_name(ss[2], "renamed");
+	gv_station_set_uri(ss[2], "http://renamed.com");
+	mutest_expect("find_by_name() doesn't find the old name",
+			mutest_pointer(gv_station_list_find_by_name(s, "s2")),
+			mutest_to_be_null,
+			NULL);
+	mutest_expect("find_by_name() finds the new name",
+			mutest_bool_value(gv_station_list_find_by_name(s, "renamed") == ss[2]),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("find_by_uri() finds the new uri",
+			mutest_bool_value(gv_station_list_find_by_uri(s, "http://renamed.com") == ss[2]),
+			mutest_to_be_true,
+			NULL);
+
+	/* Give a station the name of another, then remove the latter */
+	gv_station_set_name(ss[0], "s1");
+	gv_station_list_remove(s, ss[1]);
+	mutest_expect("find_by_name() finds the duplicate",
+			mutest_bool_value(gv_station_list_find_by_name(s, "s1") == ss[0]),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("find_by_uri() doesn't find the removed station",
+			mutest_pointer(gv_station_list_find_by_uri(s, "http://sta1.com")),
+			mutest_to_be_null,
+			NULL);
+
+	g_object_unref(s);
+
+	mutest_expect("finalize() was called",
+			mutest_pointer(s),
+			mutest_to_be_null,
+			NULL);
+}
+
+static void
+station_list_find_duplicate(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *a, *b, *c;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+
+	a = gv_station_new("a", "http://a.com");
+	gv_station_list_append(s, a);
+
+	mutest_expect("find_duplicate() finds the station itself",
+			mutest_bool_value(gv_station_list_find_duplicate(s, a) == a),
+			mutest_to_be_true,
+			NULL);
+
+	b = g_object_ref_sink(gv_station_new("a", "http://b.com"));
+	mutest_expect("find_duplicate() finds a station with the same name",
+			mutest_bool_value(gv_station_list_find_duplicate(s, b) == a),
+			mutest_to_be_true,
+			NULL);
+	gv_station_set_name(b, "b");
+	mutest_expect("find_duplicate() finds nothing after a rename",
+			mutest_pointer(gv_station_list_find_duplicate(s, b)),
+			mutest_to_be_null,
+			NULL);
+	gv_station_list_append(s, b);
+	mutest_expect("list has 2 stations",
+			mutest_int_value(gv_station_list_length(s)),
+			mutest_to_be, 2,
+			NULL);
+	g_object_unref(b);
+
+	c = g_object_ref_sink(gv_station_new("c", "http://b.com"));
+	mutest_expect("find_duplicate() finds a station with the same uri",
+			mutest_bool_value(gv_station_list_find_duplicate(s, c) == b),
+			mutest_to_be_true,
+			NULL);
+	gv_station_list_append(s, c);
+	mutest_expect("a duplicate is not inserted",
+			mutest_int_value(gv_station_list_length(s)),
+			mutest_to_be, 2,
+			NULL);
+	g_object_unref(c);
+
+	g_object_unref(s);
+
+	mutest_expect("finalize() was called",
+			mutest_pointer(s),
+			mutest_to_be_null,
+			NULL);
+}
+
+static void
+on_station_list_changed(GvStationList *station_list G_GNUC_UNUSED,
+                        GvStationListDiff *diff, GvStationListDiff *copy)
+{
+	copy->added = g_ptr_array_ref(diff->added);
+	copy->removed = g_ptr_array_ref(diff->removed);
+	copy->moved = g_ptr_array_ref(diff->moved);
+}
+
+static void
+on_station_list_station_added(GvStationList *station_list G_GNUC_UNUSED,
+                              GvStation *station G_GNUC_UNUSED, guint *count)
+{
+	*count += 1;
+}
+
+static void
+station_list_batch(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStationListDiff diff = { NULL, NULL, NULL };
+	GvStation *ss[4];
+	guint n_added = 0;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+	g_signal_connect(s, "changed", G_CALLBACK(on_station_list_changed), &diff);
+	g_signal_connect(s, "station-added", G_CALLBACK(on_station_list_station_added), &n_added);
+
+	make_stations(ss, 4);
+
+	/* Add a station, outside of a batch */
+	gv_station_list_append(s, ss[0]);
+
+	/* Add 3 stations, remove one of them, move another */
+	gv_station_list_begin(s);
+	gv_station_list_append(s, ss[1]);
+	gv_station_list_append(s, ss[2]);
+	gv_station_list_append(s, ss[3]);
+	gv_station_list_remove(s, ss[2]);
+	gv_station_list_move_last(s, ss[0]);
+	mutest_expect("no signal is emitted before commit",
+			mutest_bool_value(diff.added == NULL && n_added == 1),
+			mutest_to_be_true,
+			NULL);
+	gv_station_list_commit(s);
+
+	mutest_expect("changed was emitted",
+			mutest_pointer(diff.added),
+			mutest_not, mutest_to_be_null,
+			NULL);
+	mutest_expect("station-added was not emitted",
+			mutest_int_value(n_added),
+			mutest_to_be, 1,
+			NULL);
+	mutest_expect("2 stations were added",
+			mutest_int_value(diff.added->len),
+			mutest_to_be, 2,
+			NULL);
+	mutest_expect("stations added are ordered",
+			mutest_bool_value(g_ptr_array_index(diff.added, 0) == ss[1] &&
+			                  g_ptr_array_index(diff.added, 1) == ss[3]),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("no station was removed",
+			mutest_int_value(diff.removed->len),
+			mutest_to_be, 0,
+			NULL);
+	mutest_expect("1 station was moved",
+			mutest_int_value(diff.moved->len),
+			mutest_to_be, 1,
+			NULL);
+	mutest_expect("list is [1, 3, 0]",
+			mutest_bool_value(gv_station_list_at(s, 0) == ss[1] &&
+			                  gv_station_list_at(s, 1) == ss[3] &&
+			                  gv_station_list_at(s, 2) == ss[0]),
+			mutest_to_be_true,
+			NULL);
+
+	g_ptr_array_unref(diff.added);
+	g_ptr_array_unref(diff.removed);
+	g_ptr_array_unref(diff.moved);
+
+	g_object_unref(s);
+
+	mutest_expect("finalize() was called",
+			mutest_pointer(s),
+			mutest_to_be_null,
+			NULL);
+}
+
+static guint
+count_shuffled_stations(GvStationList *s)
+{
+	GHashTable *seen;
+	GvStation *station = NULL;
+	guint n;
+
+	seen = g_hash_table_new(g_direct_hash, g_direct_equal);
+	while ((station = gv_station_list_next(s, station, FALSE, TRUE)) != NULL) {
+		if (!g_hash_table_add(seen, station))
+			break;
+	}
+	n = g_hash_table_size(seen);
+	g_hash_table_destroy(seen);
+
+	return n;
+}
+
+static void
+station_list_shuffle(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *ss[6];
+	GvStation *station;
+	guint i;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+
+	make_stations(ss, 6);
+
+	for (i = 0; i < 5; i++)
+		gv_station_list_append(s, ss[i]);
+
+	mutest_expect("shuffle visits each station once",
+			mutest_int_value(count_shuffled_stations(s)),
+			mutest_to_be, 5,
+			NULL);
+
+	gv_station_list_remove(s, ss[2]);
+	gv_station_list_append(s, ss[5]);
+
+	mutest_expect("shuffle is updated on insert and remove",
+			mutest_int_value(count_shuffled_stations(s)),
+			mutest_to_be, 5,
+			NULL);
+
+	station = gv_station_list_next(s, NULL, FALSE, TRUE);
+	mutest_expect("repeat never plays the same station twice in a row",
+			mutest_bool_value(gv_station_list_prev(s, station, TRUE, TRUE) != station),
+			mutest_to_be_true,
+			NULL);
+
+	g_object_unref(s);
+
+	mutest_expect("finalize() was called",
+			mutest_pointer(s),
+			mutest_to_be_null,
+			NULL);
+}
+
+static void
+station_list_iter(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStationListIter *iter;
+	GvStation *ss[3];
+	GvStation *seen[3];
+	GvStation *station;
+	guint n;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+
+	make_stations(ss, 3);
+
+	gv_station_list_append(s, ss[0]);
+	gv_station_list_append(s, ss[1]);
+
+	/* Iterate without modifying the list */
+	iter = gv_station_list_iter_new(s);
+	while (gv_station_list_iter_loop(iter, &station));
+	gv_station_list_iter_free(iter);
+	gv_station_list_append(s, ss[2]);
+
+	mutest_expect("iterating does not copy the stations",
+			mutest_int_value(gv_station_list_get_snapshot_copies(s)),
+			mutest_to_be, 0,
+			NULL);
+
+	/* Modify the list while iterating */
+	iter = gv_station_list_iter_new(s);
+	for (n = 0; gv_station_list_iter_loop(iter, &station); n++) {
+		if (n == 0)
+			gv_station_list_move_first(s, ss[2]);
+		if (n < 3)
+			seen[n] = station;
+	}
+	gv_station_list_iter_free(iter);
+
+	mutest_expect("iterating while modifying copies the stations once",
+			mutest_int_value(gv_station_list_get_snapshot_copies(s)),
+			mutest_to_be, 1,
+			NULL);
+	mutest_expect("iterator sees the stations as they were",
+			mutest_bool_value(n == 3 && seen[0] == ss[0] &&
+			                  seen[1] == ss[1] && seen[2] == ss[2]),
+			mutest_to_be_true,
+			NULL);
+
+	g_object_unref(s);
+
+	mutest_expect("finalize() was called",
+			mutest_pointer(s),
+			mutest_to_be_null,
+			NULL);
+}
+
+static void
+station_list_materialize(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStationListIter *iter;
+	GvStation *a, *b;
+	const gchar *first_uid, *name, *uri;
+	gchar *uid;
+
+	s = gv_station_list_new_from_xdg_dirs(DEFAULT_STATIONS);
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+	gv_station_list_load(s);
+
+	/* Station data can be read before the station is created */
+	first_uid = name = uri = NULL;
+	iter = gv_station_list_iter_new(s);
+	gv_station_list_iter_loop_data(iter, &first_uid, &name, &uri);
+	gv_station_list_iter_free(iter);
+
+	mutest_expect("stations have an uid once loaded",
+			mutest_bool_value(first_uid != NULL && uri != NULL),
+			mutest_to_be_true,
+			NULL);
+
+	a = gv_station_list_at(s, 0);
+	mutest_expect("station created has the uid it was loaded with",
+			mutest_bool_value(!g_strcmp0(gv_station_get_uid(a), first_uid) &&
+			                  !g_strcmp0(gv_station_get_uri(a), uri)),
+			mutest_to_be_true,
+			NULL);
+
+	mutest_expect("at() returns the same station twice",
+			mutest_bool_value(a != NULL && gv_station_list_at(s, 0) == a),
+			mutest_to_be_true,
+			NULL);
+	uid = g_strdup(gv_station_get_uid(a));
+	g_object_add_weak_pointer(G_OBJECT(a), (gpointer *) &a);
+
+	b = g_object_ref(gv_station_list_at(s, 1));
+
+	/* Stations that nobody holds are released when idle */
+	while (g_main_context_iteration(NULL, FALSE));
+
+	mutest_expect("station not held was released",
+			mutest_pointer(a),
+			mutest_to_be_null,
+			NULL);
+	mutest_expect("station held was kept",
+			mutest_bool_value(gv_station_list_at(s, 1) == b),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("station released can be found by uid",
+			mutest_bool_value(!g_strcmp0(gv_station_get_uid(gv_station_list_find_by_uid(s, uid)),
+			                             uid)),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("station released is the same as before",
+			mutest_int_value(gv_station_list_index_of(s, gv_station_list_find_by_uid(s, uid))),
+			mutest_to_be, 0,
+			NULL);
+
+	g_free(uid);
+	g_object_unref(b);
+	g_object_unref(s);
+
+	mutest_expect("finalize() was called",
+			mutest_pointer(s),
+			mutest_to_be_null,
+			NULL);
+}
+
+static void
+station_list_compact_arena(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *ss[100];
+	GvStation *kept;
+	const gchar *kept_name = NULL;
+	gchar *padding;
+	guint i;
+
+	s = gv_station_list_new_from_paths("/dev/null", "/dev/null");
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+
+	/* Add stations with long names, then remove them */
+	padding = g_strnfill(1024, 'x');
+	for (i = 0; i < 100; i++) {
+		gchar *name = g_strdup_printf("%s%u", padding, i);
+		gchar *url = g_strdup_printf("http://sta%u.com", i);
+		ss[i] = gv_station_new(name, url);
+		gv_station_list_append(s, ss[i]);
+		g_free(name);
+		g_free(url);
+	}
+	g_free(padding);
+
+	kept = gv_station_new("kept", "http://kept.com");
+	gv_station_list_append(s, kept);
+
+	for (i = 0; i < 100; i++)
+		gv_station_list_remove(s, ss[i]);
+
+	/* Saving reclaims the strings of the removed stations */
+	gv_station_list_save(s);
+
+	gv_station_list_get_data_at(s, 0, NULL, &kept_name, NULL);
+	mutest_expect("station data survives compaction",
+			mutest_bool_value(!g_strcmp0(kept_name, "kept")),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("indexes survive compaction",
+			mutest_bool_value(gv_station_list_find_by_name(s, "kept") == kept &&
+			                  gv_station_list_find_by_uri(s, "http://kept.com") == kept &&
+			                  gv_station_list_find_by_uid(s, gv_station_get_uid(kept)) == kept &&
+			                  gv_station_list_find_by_uri(s, "http://sta0.com") == NULL),
+			mutest_to_be_true,
+			NULL);
+
+	gv_station_set_name(kept, "renamed");
+	mutest_expect("station can be renamed after compaction",
+			mutest_bool_value(gv_station_list_find_by_name(s, "renamed") == kept &&
+			                  gv_station_list_find_by_name(s, "kept") == NULL),
+			mutest_to_be_true,
+			NULL);
+
+	g_object_unref(s);
+
+	mutest_expect("finalize() was called",
+			mutest_pointer(s),
+			mutest_to_be_null,
+			NULL);
+}
+
+static void
+on_import_done(GObject *source G_GNUC_UNUSED, GAsyncResult *result, gpointer user_data)
+{
+	GAsyncResult **ret = user_data;
+
+	*ret = g_object_ref(result);
+}
+
+static void
+station_list_import(mutest_spec_t *spec G_GNUC_UNUSED)
+{
+	GvStationList *s;
+	GvStation *station;
+	GError *err = NULL;
+	gchar *journal, *cache;
+	gchar output[] = "/tmp/gv-station-list-XXXXXX.xml";
+	gchar m3u[] = "/tmp/gv-station-list-XXXXXX.m3u";
+	gchar pls[] = "/tmp/gv-station-list-XXXXXX.pls";
+	gchar txt[] = "/tmp/gv-station-list-XXXXXX.txt";
+	gchar noext[] = "/tmp/gv-station-list-XXXXXX";
+	gchar hls[] = "/tmp/gv-station-list-XXXXXX";
+	gchar m3u8[] = "/tmp/gv-station-list-XXXXXX.m3u8";
+	GvStationListDiff diff = { NULL, NULL, NULL };
+	GAsyncResult *result = NULL;
+	const gchar *hls_content =
+		"#EXTM3U\n"
+		"#EXT-X-STREAM-INF:BANDWIDTH=128000,CODECS=\"mp4a.40.2\"\n"
+		"chunklist_128.m3u8\n"
+		"#EXT-X-STREAM-INF:BANDWIDTH=64000,CODECS=\"mp4a.40.5\"\n"
+		"http://six.example.com/chunklist_64.m3u8\n";
+	gdouble rate;
+	guint n;
+
+	TOUCHTMP(output);
+	TOUCHTMP(m3u);
+	TOUCHTMP(pls);
+	TOUCHTMP(txt);
+	TOUCHTMP(noext);
+	TOUCHTMP(hls);
+	TOUCHTMP(m3u8);
+
+	g_file_set_contents(m3u,
+	                    "#EXTM3U\r\n"
+	                    "#EXTINF:-1 group-title=\"Rock, Pop\",Radio One\r\n"
+	                    "http://one.example.com/stream\r\n"
+	                    "http://two.example.com/stream\r\n"
+	                    "#EXTINF:-1,Radio One Again\r\n"
+	                    "http://one.example.com/stream\r\n"
+	                    "file:///not/a/radio.mp3",
+	                    -1, NULL);
+	g_file_set_contents(pls,
+	                    "[playlist]\n"
+	                    "File1=http://three.example.com/stream\n"
+	                    "Title1=Radio Three\n"
+	                    "File2=http://four.example.com/stream\n"
+	                    "NumberOfEntries=2\n",
+	                    -1, NULL);
+	g_file_set_contents(noext,
+	                    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	                    "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n"
+	                    "  <title>Directory</title>\n"
+	                    "  <trackList>\n"
+	                    "    <track>\n"
+	                    "      <location>http://five.example.com/stream</location>\n"
+	                    "      <title>Radio Five</title>\n"
+	                    "    </track>\n"
+	                    "  </trackList>\n"
+	                    "</playlist>\n",
+	                    -1, NULL);
+
+	g_file_set_contents(hls, hls_content, -1, NULL);
+	g_file_set_contents(m3u8, hls_content, -1, NULL);
+
+	mutest_expect("HLS playlists are streams, not playlists",
+			mutest_bool_value(gv_playlist_sniff_format(hls_content,
+			                                           strlen(hls_content)) ==
+			                  GV_PLAYLIST_FORMAT_NONE &&
+			                  gv_playlist_get_format("http://six.example.com/live.m3u8") ==
+			                  GV_PLAYLIST_FORMAT_NONE),
+			mutest_to_be_true,
+			NULL);
+
+	s = gv_station_list_new_from_paths("/dev/null", output);
+	g_object_add_weak_pointer(G_OBJECT(s), (gpointer *) &s);
+	gv_station_list_load(s);
+
+	n = gv_station_list_import(s, m3u, &rate, &err);
+	mutest_expect("import() of a m3u playlist succeeds",
+			mutest_pointer(err),
+			mutest_to_be_null,
+			NULL);
+	mutest_expect("import() skips duplicates and unsupported uris",
+			mutest_int_value(n),
+			mutest_to_be, 2,
+			NULL);
+	mutest_expect("import() reports a rate",
+			mutest_bool_value(rate > 0),
+			mutest_to_be_true,
+			NULL);
+
+	station = gv_station_list_at(s, 0);
+	mutest_expect("station name comes from #EXTINF",
+			mutest_bool_value(!g_strcmp0(gv_station_get_name(station), "Radio One") &&
+			                  !g_strcmp0(gv_station_get_uri(station),
+			                             "http://one.example.com/stream")),
+			mutest_to_be_true,
+			NULL);
+	station = gv_station_list_at(s, 1);
+	mutest_expect("station without #EXTINF has no name",
+			mutest_pointer((gpointer) gv_station_get_name(station)),
+			mutest_to_be_null,
+			NULL);
+
+	n = gv_station_list_import(s, pls, NULL, &err);
+	mutest_expect("import() of a pls playlist appends stations",
+			mutest_bool_value(err == NULL && n == 2 && gv_station_list_length(s) == 4),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("station name comes from TitleN",
+			mutest_bool_value(!g_strcmp0(gv_station_get_name(gv_station_list_at(s, 2)),
+			                             "Radio Three")),
+			mutest_to_be_true,
+			NULL);
+	mutest_expect("station without TitleN has no name",
+			mutest_pointer((gpointer) gv_station_get_name(gv_station_list_at(s, 3))),
+			mutest_to_be_null,
+			NULL);
+
+	n = gv_station_list_import(s, txt, NULL, &err);
+	mutest_expect("import() of an unknown format fails",
+			mutest_bool_value(err != NULL && n == 0 && gv_station_list_length(s) == 4),
+			mutest_to_be_true,
+			NULL);
+	g_clear_error(&err);
+
+	n = gv_station_list_import(s, noext, NULL, &err);
+	mutest_expect("import() tells the format from the content",
+			mutest_bool_value(err == NULL && n == 1 &&
+			                  !g_strcmp0(gv_station_get_name(gv_station_list_at(s, 4)),
+			                             "Radio Five")),
+			mutest_to_be_true,
+			NULL);
+
+	n = gv_station_list_import(s, hls, NULL, &err);
+	mutest_expect("import() of a HLS playlist fails",
+			mutest_bool_value(err != NULL && n == 0 && gv_station_list_length(s) == 5),
+			mutest_to_be_true,
+			NULL);
+	g_clear_error(&err);
+
+	n = gv_station_list_import(s, m3u8, NULL, &err);
+	mutest_expect("import() of a m3u8 playlist fails",
+			mutest_bool_value(err != NULL && n == 0 && gv_station_list_length(s) == 5),
+			mutest_to_be_true,
+			NULL);
+	g_clear_error(&err);
+
+	g_file_set_contents(pls,
+	                    "[playlist]\n"
+	                    "File1=http://seven.example.com/stream\n"
+	                    "Title1=Radio Seven\n"
+	                    "NumberOfEntries=1\n",
+	                    -1, NULL);
+	g_signal_connect(s, "changed", G_CALLBACK(on_station_list_changed), &diff);
+	gv_station_list_import_async(s, pls, NULL, on_import_done, &result);
+	while (result == NULL)
+		g_main_context_iteration(NULL, TRUE);
+	n = gv_station_list_import_finish(s, result, NULL, &err);
+	g_object_unref(result);
+	mutest_expect("import_async() commits the stations in one batch",
+			mutest_bool_value(diff.added != NULL && diff.added->len == 1 &&
+			                  diff.removed->len == 0 && diff.moved->len == 0),
+			mutest_to_be_true,
+			NULL);
+	g_clear_pointer(&diff.added, g_ptr_array_unref);
+	g_clear_pointer(&diff.removed, g_ptr_array_unref);
+	g_clear_pointer(&diff.moved, g_ptr_array_unref);
+	mutest_expect("import_async() appends stations",
+			mutest_bool_value(err == NULL && n == 1 && gv_station_list_length(s) == 6 &&
+			                  !g_strcmp0(gv_station_get_name(gv_station_list_at(s, 5)),
+			                             "Radio Seven")),
+			mutest_to_be_true,
+			NULL);
+
+	g_object_unref(s);
+
+	mutest_expect("finalize() was called",
+			mutest_pointer(s),
+			mutest_to_be_null,
+			NULL);
+
+	journal = g_strconcat(output, ".journal", NULL);
+	g_unlink(journal);
+	g_free(journal);
+	cache = g_strconcat(output, ".cache", NULL);
+	g_unlink(cache);
+	g_free(cache);
+	g_unlink(output);
+	g_unlink(m3u);
+	g_unlink(pls);
+	g_unlink(txt);
+	g_unlink(noext);
+	g_unlink(hls);
+	g_unlink(m3u8);
+}
+
 static void
 station_list_suite(mutest_suite_t *suite G_GNUC_UNUSED)
 {
@@ -422,7 +1192,16 @@ station_list_suite(mutest_suite_t *suite G_GNUC_UNUSED)
 
 	mutest_it("load the default station list", station_list_load_default);
 	mutest_it("load and save an empty station list", station_list_load_save_empty);
+	mutest_it("journal the changes made to a station list", station_list_journal);
 	mutest_it("add, move and remove stations", station_list_add_move_remove);
+	mutest_it("find stations by uid, name and uri", station_list_find);
+	mutest_it("find duplicate stations", station_list_find_duplicate);
+	mutest_it("apply changes in a batch", station_list_batch);
+	mutest_it("walk stations in shuffled order", station_list_shuffle);
+	mutest_it("iterate over a snapshot of the stations", station_list_iter);
+	mutest_it("create stations on demand", station_list_materialize);
+	mutest_it("reclaim the strings of removed stations", station_list_compact_arena);
+	mutest_it("import stations from playlists", station_list_import);
 
 	g_assert_true(g_rmdir(tmpdir) == 0);
 	g_free(tmpdir);
@@ -158,6 +158,10 @@ static const gchar *DBUS_INTROSPECTION =
 struct _GvDbusServerMpris2 {
 	/* Parent instance structure */
 	GvDbusServer parent_instance;
+	/* Cached views of the station list, NULL when invalid */
+	GVariant   *tracks;
+	GPtrArray  *playlists;
+	GHashTable *playlists_by_uid;
 };
 
 G_DEFINE_TYPE(GvDbusServerMpris2, gv_dbus_server_mpris2, GV_TYPE_DBUS_SERVER)
@@ -167,16 +171,16 @@ G_DEFINE_TYPE(GvDbusServerMpris2, gv_dbus_server_mpris2, GV_TYPE_DBUS_SERVER)
  */
 
 static gchar *
-make_playlist_id(GvStation *station)
+make_playlist_id(const gchar *station_uid)
 {
 	/* As suggested in the MPRIS2 specifications, "/" should be used if NULL.
 	 * https://specifications.freedesktop.org/mpris-spec/latest/
 	 * Playlists_Interface.html#Struct:Maybe_Playlist
 	 */
-	if (station == NULL)
+	if (station_uid == NULL)
 		return g_strdup("/");
 
-	return g_strdup_printf(PLAYLISTID_PATH "/%s", gv_station_get_uid(station));
+	return g_strdup_printf(PLAYLISTID_PATH "/%s", station_uid);
 }
 
 static gboolean
@@ -203,13 +207,19 @@ parse_playlist_id(const gchar    *playlist_id,
 	return TRUE;
 }
 
+static gchar *
+make_track_id_from_uid(const gchar *station_uid)
+{
+	return g_strdup_printf(TRACKID_PATH "/%s", station_uid);
+}
+
 static gchar *
 make_track_id(GvStation *station)
 {
 	if (station == NULL)
 		return g_strdup(DBUS_PATH "/TrackList/NoTrack");
 
-	return g_strdup_printf(TRACKID_PATH "/%s", gv_station_get_uid(station));
+	return make_track_id_from_uid(gv_station_get_uid(station));
 }
 
 static gboolean
@@ -236,87 +246,20 @@ parse_track_id(const gchar     *track_id,
 	return TRUE;
 }
 
-static gint
-compare_alphabetically(GvStation *a, GvStation *b)
-{
-	const gchar *str1 = gv_station_get_name_or_uri(a);
-	const gchar *str2 = gv_station_get_name_or_uri(b);
-
-	return g_strcmp0(str1, str2);
-}
-
-static GList *
-build_station_list(GvStationList *station_list, gboolean alphabetical,
-                   gboolean reverse, guint start_index, guint max_count)
-{
-	GvStationListIter *iter;
-	GvStation *station;
-	GList *list = NULL;
-
-	/* Build a GList */
-	iter = gv_station_list_iter_new(station_list);
-
-	while (gv_station_list_iter_loop(iter, &station))
-		list = g_list_append(list, station);
-
-	gv_station_list_iter_free(iter);
-
-	/* Order alphabetically if needed */
-	if (alphabetical)
-		list = g_list_sort(list, (GCompareFunc) compare_alphabetically);
-
-	/* Reverse order if needed */
-	if (reverse)
-		list = g_list_reverse(list);
-
-	/* Handle start index */
-	while (start_index > 0) {
-		if (list == NULL)
-			break;
-
-		list = g_list_delete_link(list, list);
-		start_index--;
-	}
-
-	/* Handle max count */
-	GList *tmp = list;
-
-	while (max_count > 0) {
-		if (tmp == NULL)
-			break;
-
-		tmp = tmp->next;
-		max_count--;
-	}
-
-	if (tmp != NULL) {
-		if (tmp == list) {
-			g_list_free(list);
-			list = NULL;
-		} else {
-			tmp->prev->next = NULL;
-			tmp->prev = NULL;
-			g_list_free(tmp);
-		}
-	}
-
-	return list;
-}
-
 /*
  * GVariant helpers for MPRIS2 types
  */
 
 static GVariant *
-g_variant_new_playlist(GvStation *station)
+g_variant_new_playlist_from_data(const gchar *station_uid, const gchar *station_name)
 {
 	gchar *playlist_id;
 
-	playlist_id = make_playlist_id(station);
+	playlist_id = make_playlist_id(station_uid);
 
 	GVariant *tuples[] = {
 		g_variant_new_object_path(playlist_id),
-		g_variant_new_string(station ? gv_station_get_name_or_uri(station) : ""),
+		g_variant_new_string(station_name ? station_name : ""),
 		g_variant_new_string("")
 	};
 
@@ -325,6 +268,16 @@ g_variant_new_playlist(GvStation *station)
 	return g_variant_new_tuple(tuples, 3);
 }
 
+static GVariant *
+g_variant_new_playlist(GvStation *station)
+{
+	if (station == NULL)
+		return g_variant_new_playlist_from_data(NULL, NULL);
+
+	return g_variant_new_playlist_from_data(gv_station_get_uid(station),
+	                                        gv_station_get_name_or_uri(station));
+}
+
 static GVariant *
 g_variant_new_maybe_playlist(GvStation *station)
 {
@@ -474,6 +427,217 @@ g_variant_new_can_go_next(GvPlayer *player)
 	return g_variant_new_boolean(has_next);
 }
 
+/*
+ * Cached views
+ *
+ * Clients might read the tracks, or page through the playlists, quite
+ * often, while the station list rarely changes. So we keep the 'Tracks'
+ * array around until the station list changes, and we maintain an index
+ * of the playlists in alphabetical order, which is updated station by
+ * station, and dropped altogether when a batch of changes is committed.
+ */
+
+struct _GvPlaylistEntry {
+	gchar    *uid;
+	gchar    *name;
+	GVariant *playlist;
+};
+
+typedef struct _GvPlaylistEntry GvPlaylistEntry;
+
+static GvPlaylistEntry *
+gv_playlist_entry_new(const gchar *uid, const gchar *name)
+{
+	GvPlaylistEntry *entry;
+
+	entry = g_new0(GvPlaylistEntry, 1);
+	entry->uid = g_strdup(uid);
+	entry->name = g_strdup(name);
+	entry->playlist = g_variant_ref_sink(g_variant_new_playlist_from_data(uid, name));
+
+	return entry;
+}
+
+static void
+gv_playlist_entry_free(GvPlaylistEntry *entry)
+{
+	if (entry == NULL)
+		return;
+
+	g_free(entry->uid);
+	g_free(entry->name);
+	g_variant_unref(entry->playlist);
+	g_free(entry);
+}
+
+static gint
+gv_playlist_entry_compare(const GvPlaylistEntry *a, const GvPlaylistEntry *b)
+{
+	gint ret;
+
+	/* Stations with the same name are ordered by uid, so that the order
+	 * doesn't depend on the order of insertion.
+	 */
+	ret = g_strcmp0(a->name, b->name);
+	if (ret != 0)
+		return ret;
+
+	return g_strcmp0(a->uid, b->uid);
+}
+
+static gint
+gv_playlist_entry_compare_indirect(gconstpointer a, gconstpointer b)
+{
+	return gv_playlist_entry_compare(*(GvPlaylistEntry **) a,
+	                                 *(GvPlaylistEntry **) b);
+}
+
+static guint
+gv_dbus_server_mpris2_search_playlist(GvDbusServerMpris2 *self, GvPlaylistEntry *entry)
+{
+	GPtrArray *playlists = self->playlists;
+	guint lo = 0, hi = playlists->len;
+
+	/* Return the position of the first entry that is not lower */
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (gv_playlist_entry_compare(g_ptr_array_index(playlists, mid), entry) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void
+gv_dbus_server_mpris2_index_station(GvDbusServerMpris2 *self, GvStation *station)
+{
+	GvPlaylistEntry *entry;
+	guint pos;
+
+	if (self->playlists == NULL)
+		return;
+
+	entry = gv_playlist_entry_new(gv_station_get_uid(station),
+	                              gv_station_get_name_or_uri(station));
+	pos = gv_dbus_server_mpris2_search_playlist(self, entry);
+	g_ptr_array_insert(self->playlists, pos, entry);
+	g_hash_table_insert(self->playlists_by_uid, entry->uid, entry);
+}
+
+static void
+gv_dbus_server_mpris2_unindex_station(GvDbusServerMpris2 *self, GvStation *station)
+{
+	GvPlaylistEntry *entry;
+	guint pos;
+
+	if (self->playlists == NULL)
+		return;
+
+	entry = g_hash_table_lookup(self->playlists_by_uid, gv_station_get_uid(station));
+	if (entry == NULL)
+		return;
+
+	pos = gv_dbus_server_mpris2_search_playlist(self, entry);
+	g_assert(pos < self->playlists->len);
+	g_assert(g_ptr_array_index(self->playlists, pos) == entry);
+
+	g_hash_table_remove(self->playlists_by_uid, entry->uid);
+	g_ptr_array_remove_index(self->playlists, pos);
+}
+
+static void
+gv_dbus_server_mpris2_reindex_station(GvDbusServerMpris2 *self, GvStation *station)
+{
+	GvPlaylistEntry *entry;
+
+	if (self->playlists == NULL)
+		return;
+
+	/* Only the name matters, both for the order and for the playlist */
+	entry = g_hash_table_lookup(self->playlists_by_uid, gv_station_get_uid(station));
+	if (entry && !g_strcmp0(entry->name, gv_station_get_name_or_uri(station)))
+		return;
+
+	gv_dbus_server_mpris2_unindex_station(self, station);
+	gv_dbus_server_mpris2_index_station(self, station);
+}
+
+static GPtrArray *
+gv_dbus_server_mpris2_get_playlists(GvDbusServerMpris2 *self)
+{
+	GvStationList *station_list = gv_core_station_list;
+	GvStationListIter *iter;
+	const gchar *uid, *name, *uri;
+	guint i;
+
+	if (self->playlists)
+		return self->playlists;
+
+	/* (Re)build the alphabetical index */
+	self->playlists = g_ptr_array_new_full(gv_station_list_length(station_list),
+	                                       (GDestroyNotify) gv_playlist_entry_free);
+	self->playlists_by_uid = g_hash_table_new(g_str_hash, g_str_equal);
+
+	/* Only the station data is needed, no need to create the stations */
+	iter = gv_station_list_iter_new(station_list);
+	while (gv_station_list_iter_loop_data(iter, &uid, &name, &uri))
+		g_ptr_array_add(self->playlists, gv_playlist_entry_new(uid, name ? name : uri));
+	gv_station_list_iter_free(iter);
+
+	g_ptr_array_sort(self->playlists, gv_playlist_entry_compare_indirect);
+
+	for (i = 0; i < self->playlists->len; i++) {
+		GvPlaylistEntry *entry = g_ptr_array_index(self->playlists, i);
+		g_hash_table_insert(self->playlists_by_uid, entry->uid, entry);
+	}
+
+	return self->playlists;
+}
+
+static GVariant *
+gv_dbus_server_mpris2_get_tracks(GvDbusServerMpris2 *self)
+{
+	GvStationList *station_list = gv_core_station_list;
+	GvStationListIter *iter;
+	const gchar *uid;
+	GVariantBuilder b;
+
+	if (self->tracks)
+		return self->tracks;
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("ao"));
+	iter = gv_station_list_iter_new(station_list);
+
+	while (gv_station_list_iter_loop_data(iter, &uid, NULL, NULL)) {
+		gchar *track_id;
+		track_id = make_track_id_from_uid(uid);
+		g_variant_builder_add(&b, "o", track_id);
+		g_free(track_id);
+	}
+
+	gv_station_list_iter_free(iter);
+
+	self->tracks = g_variant_ref_sink(g_variant_builder_end(&b));
+
+	return self->tracks;
+}
+
+static void
+gv_dbus_server_mpris2_invalidate_tracks(GvDbusServerMpris2 *self)
+{
+	g_clear_pointer(&self->tracks, g_variant_unref);
+}
+
+static void
+gv_dbus_server_mpris2_invalidate_playlists(GvDbusServerMpris2 *self)
+{
+	g_clear_pointer(&self->playlists_by_uid, g_hash_table_destroy);
+	g_clear_pointer(&self->playlists, g_ptr_array_unref);
+}
+
 /*
  * Dbus method handlers
  */
@@ -500,9 +664,9 @@ method_quit(GvDbusServer  *dbus_server G_GNUC_UNUSED,
 }
 
 static GvDbusMethod root_methods[] = {
-	{ "Raise", method_raise },
-	{ "Quit",  method_quit  },
-	{ NULL,    NULL         }
+	{ "Raise", method_raise, NULL },
+	{ "Quit",  method_quit,  NULL },
+	{ NULL,    NULL,         NULL }
 };
 
 static GVariant *
@@ -603,16 +767,16 @@ method_open_uri(GvDbusServer  *dbus_server G_GNUC_UNUSED,
 }
 
 static GvDbusMethod player_methods[] = {
-	{ "Play",        method_play     },
-	{ "Pause",       method_stop     },
-	{ "PlayPause",   method_toggle   },
-	{ "Stop",        method_stop     },
-	{ "Next",        method_next     },
-	{ "Previous",    method_prev     },
-	{ "Seek",        NULL            },
-	{ "SetPosition", NULL            },
-	{ "OpenUri",     method_open_uri },
-	{ NULL,          NULL            }
+	{ "Play",        method_play,     NULL },
+	{ "Pause",       method_stop,     NULL },
+	{ "PlayPause",   method_toggle,   NULL },
+	{ "Stop",        method_stop,     NULL },
+	{ "Next",        method_next,     NULL },
+	{ "Previous",    method_prev,     NULL },
+	{ "Seek",        NULL,            NULL },
+	{ "SetPosition", NULL,            NULL },
+	{ "OpenUri",     method_open_uri, NULL },
+	{ NULL,          NULL,            NULL }
 };
 
 static GVariant *
@@ -737,11 +901,11 @@ method_go_to(GvDbusServer  *dbus_server G_GNUC_UNUSED,
 }
 
 static GvDbusMethod tracklist_methods[] = {
-	{ "GetTracksMetadata", method_get_tracks_metadata },
-	{ "AddTrack",          method_add_track           },
-	{ "RemoveTrack",       method_remove_track        },
-	{ "GoTo",              method_go_to               },
-	{ NULL,                NULL                       }
+	{ "GetTracksMetadata", method_get_tracks_metadata, NULL },
+	{ "AddTrack",          method_add_track,           NULL },
+	{ "RemoveTrack",       method_remove_track,        NULL },
+	{ "GoTo",              method_go_to,               NULL },
+	{ NULL,                NULL,                       NULL }
 };
 
 static GVariant *
@@ -772,49 +936,54 @@ method_activate_playlist(GvDbusServer  *dbus_server G_GNUC_UNUSED,
 }
 
 static GVariant *
-method_get_playlists(GvDbusServer  *dbus_server G_GNUC_UNUSED,
+method_get_playlists(GvDbusServer  *dbus_server,
                      GVariant      *params,
                      GError       **err G_GNUC_UNUSED)
 {
+	GvDbusServerMpris2 *self = GV_DBUS_SERVER_MPRIS2(dbus_server);
 	GvStationList *station_list = gv_core_station_list;
+	GPtrArray *playlists = NULL;
 	GVariantBuilder b;
-	GList *list, *item;
 	guint32 start_index, max_count;
 	const gchar *order;
 	gboolean reverse_order;
-	gboolean alphabetical;
+	guint i, n, len;
 
 	g_variant_get(params, "(uu&sb)", &start_index, &max_count, &order, &reverse_order);
 
-	/* We only support 'Alphabetical' */
-	if (!g_strcmp0(order, "Alphabetical"))
-		alphabetical = TRUE;
-	else
-		alphabetical = FALSE;
-
-	/* Make a list */
-	list = build_station_list(station_list, alphabetical, reverse_order,
-	                          start_index, max_count);
+	/* Besides 'UserDefined', we only support 'Alphabetical' */
+	if (!g_strcmp0(order, "Alphabetical")) {
+		playlists = gv_dbus_server_mpris2_get_playlists(self);
+		len = playlists->len;
+	} else {
+		len = gv_station_list_length(station_list);
+	}
 
-	/* Make a GVariant */
+	/* Only walk the page that was asked for */
 	g_variant_builder_init(&b, G_VARIANT_TYPE("a(oss)"));
 
-	for (item = list; item; item = item->next) {
-		GvStation *station = item->data;
-		g_variant_builder_add_value(&b, g_variant_new_playlist(station));
-	}
+	n = start_index < len ? MIN(max_count, len - start_index) : 0;
 
-	/* Cleanup */
-	g_list_free(list);
+	for (i = start_index; i < start_index + n; i++) {
+		guint pos = reverse_order ? len - 1 - i : i;
+
+		if (playlists) {
+			GvPlaylistEntry *entry = g_ptr_array_index(playlists, pos);
+			g_variant_builder_add_value(&b, entry->playlist);
+		} else {
+			GvStation *station = gv_station_list_at(station_list, pos);
+			g_variant_builder_add_value(&b, g_variant_new_playlist(station));
+		}
+	}
 
 	/* Return */
 	return g_variant_builder_end(&b);
 }
 
 static GvDbusMethod playlists_methods[] = {
-	{ "ActivatePlaylist",  method_activate_playlist },
-	{ "GetPlaylists",      method_get_playlists     },
-	{ NULL,                NULL                     }
+	{ "ActivatePlaylist", method_activate_playlist, NULL },
+	{ "GetPlaylists",     method_get_playlists,     NULL },
+	{ NULL,               NULL,                     NULL }
 };
 
 /*
@@ -1048,25 +1217,11 @@ static GvDbusProperty player_properties[] = {
 };
 
 static GVariant *
-prop_get_tracks(GvDbusServer *dbus_server G_GNUC_UNUSED)
+prop_get_tracks(GvDbusServer *dbus_server)
 {
-	GvStationList *station_list = gv_core_station_list;
-	GvStationListIter *iter;
-	GvStation *station;
-	GVariantBuilder b;
-
-	g_variant_builder_init(&b, G_VARIANT_TYPE("ao"));
-	iter = gv_station_list_iter_new(station_list);
-
-	while (gv_station_list_iter_loop(iter, &station)) {
-		gchar *track_id;
-		track_id = make_track_id(station);
-		g_variant_builder_add(&b, "o", track_id);
-		g_free(track_id);
-	}
+	GvDbusServerMpris2 *self = GV_DBUS_SERVER_MPRIS2(dbus_server);
 
-	gv_station_list_iter_free(iter);
-	return g_variant_builder_end(&b);
+	return g_variant_ref(gv_dbus_server_mpris2_get_tracks(self));
 }
 
 static GvDbusProperty tracklist_properties[] = {
@@ -1162,22 +1317,18 @@ on_player_notify(GvPlayer           *player,
 		(dbus_server, DBUS_IFACE_PLAYER, "Metadata",
 		 g_variant_new_metadata_map(station, metadata));
 
-		/* This signal should be sent only if there was a change */
+		/* Values that didn't change are dropped by the dbus server */
 		gv_dbus_server_emit_signal_property_changed
 		(dbus_server, DBUS_IFACE_PLAYER, "CanGoPrevious",
 		 g_variant_new_can_go_prev(player));
 
-		/* This signal should be sent only if there was a change */
 		gv_dbus_server_emit_signal_property_changed
 		(dbus_server, DBUS_IFACE_PLAYER, "CanGoNext",
 		 g_variant_new_can_go_next(player));
 
-		/* This signal should be send only if the station's name
-		 * or the station's icon was changed.
-		 */
 		gv_dbus_server_emit_signal_property_changed
-		(dbus_server, DBUS_IFACE_PLAYLISTS, "PlaylistChanged",
-		 g_variant_new_playlist(station));
+		(dbus_server, DBUS_IFACE_PLAYLISTS, "ActivePlaylist",
+		 g_variant_new_maybe_playlist(station));
 
 	} else if (!g_strcmp0(property_name, "metadata")) {
 		GvStation *station = gv_player_get_station(player);
@@ -1199,6 +1350,9 @@ on_station_list_station_added(GvStationList      *station_list,
 	GvStation *after_station;
 	gchar *after_track_id;
 
+	gv_dbus_server_mpris2_invalidate_tracks(self);
+	gv_dbus_server_mpris2_index_station(self, station);
+
 	after_station = gv_station_list_prev(station_list, station, FALSE, FALSE);
 	after_track_id = make_track_id(after_station);
 
@@ -1221,6 +1375,9 @@ on_station_list_station_removed(GvStationList      *station_list G_GNUC_UNUSED,
 	GVariantBuilder b;
 	gchar *track_id;
 
+	gv_dbus_server_mpris2_invalidate_tracks(self);
+	gv_dbus_server_mpris2_unindex_station(self, station);
+
 	track_id = make_track_id(station);
 
 	g_variant_builder_init(&b, G_VARIANT_TYPE("(o)"));
@@ -1241,6 +1398,8 @@ on_station_list_station_modified(GvStationList      *station_list G_GNUC_UNUSED,
 	GVariantBuilder b;
 	gchar *track_id;
 
+	gv_dbus_server_mpris2_reindex_station(self, station);
+
 	track_id = make_track_id(station);
 
 	g_variant_builder_init(&b, G_VARIANT_TYPE("(oa{sv})"));
@@ -1253,6 +1412,54 @@ on_station_list_station_modified(GvStationList      *station_list G_GNUC_UNUSED,
 	g_free(track_id);
 }
 
+static void
+on_station_list_station_moved(GvStationList      *station_list G_GNUC_UNUSED,
+                              GvStation          *station G_GNUC_UNUSED,
+                              GvDbusServerMpris2 *self)
+{
+	/* The alphabetical order doesn't care */
+	gv_dbus_server_mpris2_invalidate_tracks(self);
+}
+
+static void
+on_station_list_loaded(GvStationList      *station_list G_GNUC_UNUSED,
+                       GvDbusServerMpris2 *self)
+{
+	gv_dbus_server_mpris2_invalidate_tracks(self);
+	gv_dbus_server_mpris2_invalidate_playlists(self);
+}
+
+static void
+on_station_list_changed(GvStationList      *station_list G_GNUC_UNUSED,
+                        GvStationListDiff  *diff G_GNUC_UNUSED,
+                        GvDbusServerMpris2 *self)
+{
+	GvDbusServer *dbus_server = GV_DBUS_SERVER(self);
+	GvPlayer *player = gv_core_player;
+	GVariantBuilder b;
+	gchar *track_id;
+
+	/* Many stations might have changed at once, so it's cheaper to
+	 * rebuild the cached views than to update them.
+	 */
+	gv_dbus_server_mpris2_invalidate_tracks(self);
+	gv_dbus_server_mpris2_invalidate_playlists(self);
+
+	/* Likewise, rather than sending a signal for each station,
+	 * we tell that the whole list was replaced.
+	 */
+	track_id = make_track_id(gv_player_get_station(player));
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("(aoo)"));
+	g_variant_builder_add_value(&b, gv_dbus_server_mpris2_get_tracks(self));
+	g_variant_builder_add(&b, "o", track_id);
+
+	gv_dbus_server_emit_signal(dbus_server, DBUS_IFACE_TRACKLIST, "TrackListReplaced",
+	                           g_variant_builder_end(&b));
+
+	g_free(track_id);
+}
+
 /*
  * GvFeature methods
  */
@@ -1260,6 +1467,7 @@ on_station_list_station_modified(GvStationList      *station_list G_GNUC_UNUSED,
 static void
 gv_dbus_server_mpris2_disable(GvFeature *feature)
 {
+	GvDbusServerMpris2 *self = GV_DBUS_SERVER_MPRIS2(feature);
 	GvPlayer *player = gv_core_player;
 	GvStationList *station_list = gv_core_station_list;
 
@@ -1267,6 +1475,10 @@ gv_dbus_server_mpris2_disable(GvFeature *feature)
 	g_signal_handlers_disconnect_by_data(station_list, feature);
 	g_signal_handlers_disconnect_by_data(player, feature);
 
+	/* Without the signals, the cached views can't be kept up to date */
+	gv_dbus_server_mpris2_invalidate_tracks(self);
+	gv_dbus_server_mpris2_invalidate_playlists(self);
+
 	/* Chain up */
 	GV_FEATURE_CHAINUP_DISABLE(gv_dbus_server_mpris2, feature);
 }
@@ -1288,6 +1500,12 @@ gv_dbus_server_mpris2_enable(GvFeature *feature)
 	                        G_CALLBACK(on_station_list_station_removed), feature, 0);
 	g_signal_connect_object(station_list, "station-modified",
 	                        G_CALLBACK(on_station_list_station_modified), feature, 0);
+	g_signal_connect_object(station_list, "station-moved",
+	                        G_CALLBACK(on_station_list_station_moved), feature, 0);
+	g_signal_connect_object(station_list, "loaded",
+	                        G_CALLBACK(on_station_list_loaded), feature, 0);
+	g_signal_connect_object(station_list, "changed",
+	                        G_CALLBACK(on_station_list_changed), feature, 0);
 }
 
 /*
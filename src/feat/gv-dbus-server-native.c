@@ -36,6 +36,8 @@
 #define DBUS_IFACE_PLAYER   DBUS_IFACE_ROOT ".Player"
 #define DBUS_IFACE_STATIONS DBUS_IFACE_ROOT ".Stations"
 
+#define MAX_CHANGES 4096
+
 static const gchar *DBUS_INTROSPECTION =
         "<node>"
         "    <interface name='"DBUS_IFACE_ROOT"'>"
@@ -59,8 +61,20 @@ static const gchar *DBUS_INTROSPECTION =
         "    </interface>"
         "    <interface name='"DBUS_IFACE_STATIONS"'>"
         "        <method name='List'>"
+        "            <arg direction='in'  name='Offset'        type='u'/>"
+        "            <arg direction='in'  name='Limit'         type='u'/>"
+        "            <arg direction='in'  name='Fields'        type='as'/>"
+        "            <arg direction='out' name='Generation'    type='t'/>"
         "            <arg direction='out' name='Stations'      type='aa{sv}'/>"
         "        </method>"
+        "        <method name='Changes'>"
+        "            <arg direction='in'  name='Since'         type='t'/>"
+        "            <arg direction='in'  name='Fields'        type='as'/>"
+        "            <arg direction='out' name='Generation'    type='t'/>"
+        "            <arg direction='out' name='Reset'         type='b'/>"
+        "            <arg direction='out' name='Changed'       type='aa{sv}'/>"
+        "            <arg direction='out' name='Removed'       type='as'/>"
+        "        </method>"
         "        <method name='Add'>"
         "            <arg direction='in'  name='StationUri'    type='s'/>"
         "            <arg direction='in'  name='StationName'   type='s'/>"
@@ -79,6 +93,11 @@ static const gchar *DBUS_INTROSPECTION =
         "            <arg direction='in'  name='Where'         type='s'/>"
         "            <arg direction='in'  name='AroundStation' type='s'/>"
         "        </method>"
+        "        <method name='Import'>"
+        "            <arg direction='in'  name='PlaylistUri'   type='s'/>"
+        "            <arg direction='out' name='Result'        type='(ud)'/>"
+        "        </method>"
+        "        <property name='Generation' type='t' access='read'/>"
         "    </interface>"
         "</node>";
 
@@ -89,6 +108,10 @@ static const gchar *DBUS_INTROSPECTION =
 struct _GvDbusServerNative {
 	/* Parent instance structure */
 	GvDbusServer parent_instance;
+	/* Station list changes, so that clients can keep a copy in sync */
+	guint64     generation;
+	guint64     oldest_generation;
+	GHashTable *changes;
 };
 
 G_DEFINE_TYPE(GvDbusServerNative, gv_dbus_server_native, GV_TYPE_DBUS_SERVER)
@@ -97,6 +120,66 @@ G_DEFINE_TYPE(GvDbusServerNative, gv_dbus_server_native, GV_TYPE_DBUS_SERVER)
  * Helpers
  */
 
+enum {
+	FIELD_UID  = 1 << 0,
+	FIELD_URI  = 1 << 1,
+	FIELD_NAME = 1 << 2,
+	FIELD_ALL  = FIELD_UID | FIELD_URI | FIELD_NAME
+};
+
+static gboolean
+parse_fields(const gchar **fields, guint *mask, GError **err)
+{
+	const gchar **field;
+
+	/* No field means all fields */
+	if (fields == NULL || fields[0] == NULL) {
+		*mask = FIELD_ALL;
+		return TRUE;
+	}
+
+	*mask = 0;
+
+	for (field = fields; *field; field++) {
+		if (!g_strcmp0(*field, "uid"))
+			*mask |= FIELD_UID;
+		else if (!g_strcmp0(*field, "uri"))
+			*mask |= FIELD_URI;
+		else if (!g_strcmp0(*field, "name"))
+			*mask |= FIELD_NAME;
+		else {
+			g_set_error(err, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS,
+			            "Invalid field '%s'.", *field);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static GVariant *
+g_variant_new_station_fields(const gchar *uid, const gchar *uri, const gchar *name,
+                             guint mask, gint position)
+{
+	GVariantBuilder b;
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
+
+	if (uid && (mask & FIELD_UID))
+		g_variant_builder_add_dictentry_string(&b, "uid", uid);
+
+	if (uri && (mask & FIELD_URI))
+		g_variant_builder_add_dictentry_string(&b, "uri", uri);
+
+	if (name && (mask & FIELD_NAME))
+		g_variant_builder_add_dictentry_string(&b, "name", name);
+
+	if (position >= 0)
+		g_variant_builder_add(&b, "{sv}", "position", g_variant_new_uint32(position));
+
+	return g_variant_builder_end(&b);
+}
+
 static GVariant *
 g_variant_new_station(GvStation *station, GvMetadata *metadata)
 {
@@ -156,6 +239,86 @@ end:
 	return g_variant_builder_end(&b);
 }
 
+/*
+ * Station list changes
+ *
+ * Every change to the station list bumps the generation number, and the
+ * uid of the station is recorded along with the generation. This way,
+ * clients that keep a copy of the list can ask for the changes since the
+ * generation they know, rather than downloading the whole list again.
+ *
+ * Only the latest change is kept for each station, and at most MAX_CHANGES
+ * stations are remembered. Beyond that, the log is dropped and clients
+ * have to start over. The generation starts from the wall-clock time, so
+ * that it keeps increasing across restarts.
+ */
+
+struct _GvStationChange {
+	guint64  generation;
+	gboolean removed;
+};
+
+typedef struct _GvStationChange GvStationChange;
+
+static void
+gv_dbus_server_native_forget_changes(GvDbusServerNative *self)
+{
+	g_hash_table_remove_all(self->changes);
+	self->oldest_generation = self->generation;
+}
+
+static void
+gv_dbus_server_native_bump_generation(GvDbusServerNative *self)
+{
+	self->generation++;
+
+	gv_dbus_server_emit_signal_property_changed
+	(GV_DBUS_SERVER(self), DBUS_IFACE_STATIONS, "Generation",
+	 g_variant_new_uint64(self->generation));
+}
+
+static void
+gv_dbus_server_native_record_change(GvDbusServerNative *self, GvStation *station,
+                                    gboolean removed)
+{
+	const gchar *uid = gv_station_get_uid(station);
+	GvStationChange *change;
+
+	change = g_hash_table_lookup(self->changes, uid);
+	if (change == NULL && g_hash_table_size(self->changes) >= MAX_CHANGES) {
+		DEBUG("Too many changes, forgetting about them");
+		gv_dbus_server_native_forget_changes(self);
+	}
+
+	gv_dbus_server_native_bump_generation(self);
+
+	if (change == NULL) {
+		change = g_new0(GvStationChange, 1);
+		g_hash_table_insert(self->changes, g_strdup(uid), change);
+	}
+
+	change->generation = self->generation;
+	change->removed = removed;
+}
+
+struct _GvPositionedStation {
+	gint         position;
+	const gchar *uid;
+	const gchar *uri;
+	const gchar *name;
+};
+
+typedef struct _GvPositionedStation GvPositionedStation;
+
+static gint
+compare_positions(gconstpointer a, gconstpointer b)
+{
+	const GvPositionedStation *ps1 = a;
+	const GvPositionedStation *ps2 = b;
+
+	return ps1->position - ps2->position;
+}
+
 /*
  * Dbus method handlers
  */
@@ -171,8 +334,8 @@ method_quit(GvDbusServer  *dbus_server G_GNUC_UNUSED,
 }
 
 static GvDbusMethod root_methods[] = {
-	{ "Quit", method_quit },
-	{ NULL,   NULL        }
+	{ "Quit", method_quit, NULL },
+	{ NULL,   NULL,        NULL }
 };
 
 static GVariant *
@@ -264,32 +427,133 @@ method_prev(GvDbusServer  *dbus_server G_GNUC_UNUSED,
 }
 
 static GvDbusMethod player_methods[] = {
-	{ "Play",     method_play      },
-	{ "Stop",     method_stop      },
-	{ "PlayStop", method_play_stop },
-	{ "Next",     method_next      },
-	{ "Previous", method_prev      },
-	{ NULL,       NULL             }
+	{ "Play",     method_play,      NULL },
+	{ "Stop",     method_stop,      NULL },
+	{ "PlayStop", method_play_stop, NULL },
+	{ "Next",     method_next,      NULL },
+	{ "Previous", method_prev,      NULL },
+	{ NULL,       NULL,             NULL }
 };
 
 static GVariant *
-method_list(GvDbusServer  *dbus_server G_GNUC_UNUSED,
-            GVariant       *params G_GNUC_UNUSED,
-            GError        **err G_GNUC_UNUSED)
+method_list(GvDbusServer  *dbus_server,
+            GVariant       *params,
+            GError        **err)
 {
+	GvDbusServerNative *self = GV_DBUS_SERVER_NATIVE(dbus_server);
 	GvStationList *station_list = gv_core_station_list;
-	GvStationListIter *iter;
-	GvStation *station;
 	GVariantBuilder b;
+	const gchar **fields;
+	guint32 offset, limit;
+	guint i, n, len, mask;
+
+	g_variant_get(params, "(uu^a&s)", &offset, &limit, &fields);
+
+	if (!parse_fields(fields, &mask, err)) {
+		g_free(fields);
+		return NULL;
+	}
+
+	g_free(fields);
+
+	/* A limit of zero means no limit */
+	len = gv_station_list_length(station_list);
+	n = offset < len ? len - offset : 0;
+	if (limit > 0 && limit < n)
+		n = limit;
 
 	g_variant_builder_init(&b, G_VARIANT_TYPE("aa{sv}"));
-	iter = gv_station_list_iter_new(station_list);
 
-	while (gv_station_list_iter_loop(iter, &station))
-		g_variant_builder_add_value(&b, g_variant_new_station(station, NULL));
+	for (i = offset; i < offset + n; i++) {
+		const gchar *uid, *name, *uri;
 
-	gv_station_list_iter_free(iter);
-	return g_variant_builder_end(&b);
+		gv_station_list_get_data_at(station_list, i, &uid, &name, &uri);
+		g_variant_builder_add_value(&b, g_variant_new_station_fields(uid, uri, name,
+		                                                             mask, -1));
+	}
+
+	/* Generation of the list, and the stations asked for */
+	return g_variant_new("(t@aa{sv})", self->generation, g_variant_builder_end(&b));
+}
+
+static GVariant *
+method_changes(GvDbusServer  *dbus_server,
+               GVariant       *params,
+               GError        **err)
+{
+	GvDbusServerNative *self = GV_DBUS_SERVER_NATIVE(dbus_server);
+	GvStationList *station_list = gv_core_station_list;
+	GVariantBuilder changed, removed;
+	GHashTableIter iter;
+	GArray *stations;
+	const gchar **fields;
+	gpointer key, value;
+	guint64 since;
+	gboolean reset;
+	guint i, mask;
+
+	g_variant_get(params, "(t^a&s)", &since, &fields);
+
+	if (!parse_fields(fields, &mask, err)) {
+		g_free(fields);
+		return NULL;
+	}
+
+	g_free(fields);
+
+	g_variant_builder_init(&changed, G_VARIANT_TYPE("aa{sv}"));
+	g_variant_builder_init(&removed, G_VARIANT_TYPE("as"));
+
+	/* If we don't know about this generation, the client must start over */
+	reset = since < self->oldest_generation || since > self->generation;
+	if (reset)
+		goto out;
+
+	/* Collect the stations that changed since then */
+	stations = g_array_new(FALSE, FALSE, sizeof(GvPositionedStation));
+
+	g_hash_table_iter_init(&iter, self->changes);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		GvStationChange *change = value;
+		GvPositionedStation ps;
+
+		if (change->generation <= since)
+			continue;
+
+		ps.uid = key;
+		ps.uri = ps.name = NULL;
+		ps.position = -1;
+		if (change->removed == FALSE)
+			ps.position = gv_station_list_get_data_by_uid(station_list, key,
+			                                              &ps.name, &ps.uri);
+
+		if (ps.position == -1) {
+			g_variant_builder_add(&removed, "s", key);
+			continue;
+		}
+
+		g_array_append_val(stations, ps);
+	}
+
+	/* Changed stations come with their position, in ascending order,
+	 * so that clients can insert them one after another.
+	 */
+	g_array_sort(stations, compare_positions);
+
+	for (i = 0; i < stations->len; i++) {
+		GvPositionedStation *ps = &g_array_index(stations, GvPositionedStation, i);
+		g_variant_builder_add_value(&changed,
+		                            g_variant_new_station_fields(ps->uid, ps->uri,
+		                                                         ps->name, mask,
+		                                                         ps->position));
+	}
+
+	g_array_free(stations, TRUE);
+
+out:
+	return g_variant_new("(tb@aa{sv}@as)", self->generation, reset,
+	                     g_variant_builder_end(&changed),
+	                     g_variant_builder_end(&removed));
 }
 
 static GVariant *
@@ -417,13 +681,65 @@ method_move(GvDbusServer  *dbus_server G_GNUC_UNUSED,
 	return NULL;
 }
 
+static void
+on_import_done(GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+	GDBusMethodInvocation *invocation = G_DBUS_METHOD_INVOCATION(user_data);
+	GError *import_err = NULL;
+	GError *err = NULL;
+	const gchar *uri;
+	gdouble rate;
+	guint n;
+
+	g_variant_get(g_dbus_method_invocation_get_parameters(invocation), "(&s)", &uri);
+
+	n = gv_station_list_import_finish(GV_STATION_LIST(source), result, &rate, &import_err);
+
+	/* Stations might have been added before the import failed */
+	if (import_err) {
+		if (n > 0)
+			g_set_error(&err, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+			            "Failed to import '%s', %u stations imported: %s",
+			            uri, n, import_err->message);
+		else
+			g_set_error(&err, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+			            "Failed to import '%s': %s", uri, import_err->message);
+		g_error_free(import_err);
+		gv_dbus_server_return_method_call(invocation, NULL, err);
+		return;
+	}
+
+	/* Number of stations imported, and entries processed per second */
+	gv_dbus_server_return_method_call(invocation, g_variant_new("(ud)", n, rate), NULL);
+}
+
+static void
+method_import(GvDbusServer          *dbus_server G_GNUC_UNUSED,
+              GVariant              *params,
+              GDBusMethodInvocation *invocation)
+{
+	GvStationList *station_list = gv_core_station_list;
+	const gchar *uri;
+
+	g_variant_get(params, "(&s)", &uri);
+
+	/* Downloading and parsing a playlist takes a while, so we return
+	 * when it's done, rather than blocking the main loop.
+	 */
+	gv_station_list_import_async(station_list, uri, NULL, on_import_done, invocation);
+}
+
 static GvDbusMethod stations_methods[] = {
-	{ "List",   method_list   },
-	{ "Add",    method_add    },
-	{ "Remove", method_remove },
-	{ "Rename", method_rename },
-	{ "Move",   method_move   },
-	{ NULL,     NULL          }
+	{ "List",    method_list,    NULL          },
+	{ "Changes", method_changes, NULL          },
+	{ "Add",     method_add,     NULL          },
+	{ "Remove",  method_remove,  NULL          },
+	{ "Rename",  method_rename,  NULL          },
+	{ "Move",    method_move,    NULL          },
+	{ "Import",  NULL,           method_import },
+	{ NULL,      NULL,           NULL          }
 };
 
 /*
@@ -577,17 +893,121 @@ static GvDbusProperty player_properties[] = {
 	{ NULL,      NULL,                        NULL  }
 };
 
+static GVariant *
+prop_get_generation(GvDbusServer *dbus_server)
+{
+	GvDbusServerNative *self = GV_DBUS_SERVER_NATIVE(dbus_server);
+
+	return g_variant_new_uint64(self->generation);
+}
+
+static GvDbusProperty stations_properties[] = {
+	{ "Generation", prop_get_generation, NULL },
+	{ NULL,         NULL,                NULL }
+};
+
 /*
  * Dbus interfaces
  */
 
 static GvDbusInterface dbus_interfaces[] = {
-	{ DBUS_IFACE_ROOT,     root_methods,      root_properties   },
-	{ DBUS_IFACE_PLAYER,   player_methods,    player_properties },
-	{ DBUS_IFACE_STATIONS, stations_methods,  NULL              },
-	{ NULL,                NULL,              NULL              }
+	{ DBUS_IFACE_ROOT,     root_methods,      root_properties     },
+	{ DBUS_IFACE_PLAYER,   player_methods,    player_properties   },
+	{ DBUS_IFACE_STATIONS, stations_methods,  stations_properties },
+	{ NULL,                NULL,              NULL                }
 };
 
+/*
+ * Signal handlers & callbacks
+ */
+
+static void
+on_station_list_loaded(GvStationList      *station_list G_GNUC_UNUSED,
+                       GvDbusServerNative *self)
+{
+	/* Everything might have changed */
+	gv_dbus_server_native_bump_generation(self);
+	gv_dbus_server_native_forget_changes(self);
+}
+
+static void
+on_station_list_station_changed(GvStationList      *station_list G_GNUC_UNUSED,
+                                GvStation          *station,
+                                GvDbusServerNative *self)
+{
+	/* Added, modified or moved */
+	gv_dbus_server_native_record_change(self, station, FALSE);
+}
+
+static void
+on_station_list_station_removed(GvStationList      *station_list G_GNUC_UNUSED,
+                                GvStation          *station,
+                                GvDbusServerNative *self)
+{
+	gv_dbus_server_native_record_change(self, station, TRUE);
+}
+
+static void
+on_station_list_changed(GvStationList      *station_list G_GNUC_UNUSED,
+                        GvStationListDiff  *diff,
+                        GvDbusServerNative *self)
+{
+	guint i;
+
+	for (i = 0; i < diff->added->len; i++)
+		gv_dbus_server_native_record_change(self, diff->added->pdata[i], FALSE);
+
+	for (i = 0; i < diff->moved->len; i++)
+		gv_dbus_server_native_record_change(self, diff->moved->pdata[i], FALSE);
+
+	for (i = 0; i < diff->removed->len; i++)
+		gv_dbus_server_native_record_change(self, diff->removed->pdata[i], TRUE);
+}
+
+/*
+ * GvFeature methods
+ */
+
+static void
+gv_dbus_server_native_disable(GvFeature *feature)
+{
+	GvStationList *station_list = gv_core_station_list;
+
+	/* Signal handlers */
+	g_signal_handlers_disconnect_by_data(station_list, feature);
+
+	/* Chain up */
+	GV_FEATURE_CHAINUP_DISABLE(gv_dbus_server_native, feature);
+}
+
+static void
+gv_dbus_server_native_enable(GvFeature *feature)
+{
+	GvDbusServerNative *self = GV_DBUS_SERVER_NATIVE(feature);
+	GvStationList *station_list = gv_core_station_list;
+
+	/* Chain up */
+	GV_FEATURE_CHAINUP_ENABLE(gv_dbus_server_native, feature);
+
+	/* Changes were not recorded while we were disabled */
+	gv_dbus_server_native_bump_generation(self);
+	gv_dbus_server_native_forget_changes(self);
+
+	/* Signal handlers */
+	g_signal_connect_object(station_list, "loaded",
+	                        G_CALLBACK(on_station_list_loaded), feature, 0);
+	g_signal_connect_object(station_list, "station-added",
+	                        G_CALLBACK(on_station_list_station_changed), feature, 0);
+	g_signal_connect_object(station_list, "station-removed",
+	                        G_CALLBACK(on_station_list_station_removed), feature, 0);
+	g_signal_connect_object(station_list, "station-modified",
+	                        G_CALLBACK(on_station_list_station_changed), feature, 0);
+	g_signal_connect_object(station_list, "station-moved",
+	                        G_CALLBACK(on_station_list_station_changed), feature, 0);
+	g_signal_connect_object(station_list, "changed",
+	                        G_CALLBACK(on_station_list_changed), feature, 0);
+}
+
 /*
  * Public methods
  */
@@ -602,6 +1022,20 @@ gv_dbus_server_native_new(void)
  * GObject methods
  */
 
+static void
+gv_dbus_server_native_finalize(GObject *object)
+{
+	GvDbusServerNative *self = GV_DBUS_SERVER_NATIVE(object);
+
+	TRACE("%p", object);
+
+	/* Free changes */
+	g_hash_table_destroy(self->changes);
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_FINALIZE(gv_dbus_server_native, object);
+}
+
 static void
 gv_dbus_server_native_constructed(GObject *object)
 {
@@ -620,15 +1054,26 @@ static void
 gv_dbus_server_native_init(GvDbusServerNative *self)
 {
 	TRACE("%p", self);
+
+	/* Initialize station list changes */
+	self->generation = g_get_real_time();
+	self->oldest_generation = self->generation;
+	self->changes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
 }
 
 static void
 gv_dbus_server_native_class_init(GvDbusServerNativeClass *class)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS(class);
+	GvFeatureClass *feature_class = GV_FEATURE_CLASS(class);
 
 	TRACE("%p", class);
 
 	/* Override GObject methods */
+	object_class->finalize = gv_dbus_server_native_finalize;
 	object_class->constructed = gv_dbus_server_native_constructed;
+
+	/* Override GvFeature methods */
+	feature_class->enable = gv_dbus_server_native_enable;
+	feature_class->disable = gv_dbus_server_native_disable;
 }
@@ -66,6 +66,9 @@ struct _GvDbusServerPrivate {
 	guint             bus_owner_id;
 	GDBusConnection  *bus_connection;
 	guint             registration_ids[MAX_INTERFACES + 1];
+	/* Property changes, per interface */
+	GHashTable       *batches;
+	guint             flush_batches_source_id;
 };
 
 typedef struct _GvDbusServerPrivate GvDbusServerPrivate;
@@ -243,6 +246,12 @@ handle_method_call(GDBusConnection       *connection,
 			if (g_strcmp0(method->name, method_name))
 				continue;
 
+			/* Asynchronous methods return by themselves */
+			if (method->call_async) {
+				method->call_async(self, parameters, invocation);
+				return;
+			}
+
 			if (method->call)
 				ret = method->call(self, parameters, &err);
 			else
@@ -265,19 +274,7 @@ handle_method_call(GDBusConnection       *connection,
 		g_set_error(&err, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_INTERFACE,
 		            "Interface not found.");
 
-	/* Return with error if any */
-	if (err) {
-		g_dbus_method_invocation_return_gerror(invocation, err);
-		g_error_free(err);
-		return;
-	}
-
-	/* Return value if any */
-	if (ret == NULL)
-		g_dbus_method_invocation_return_value(invocation, NULL);
-	else
-		g_dbus_method_invocation_return_value(invocation,
-		                                      g_variant_new_tuple(&ret, 1));
+	gv_dbus_server_return_method_call(invocation, ret, err);
 }
 
 static GVariant *
@@ -392,6 +389,106 @@ GDBusInterfaceVTable interface_vtable = {
 	.set_property = handle_set_property,
 };
 
+/*
+ * Property batches
+ *
+ * Property changes are not sent right away. They're accumulated per
+ * interface, and flushed when the main loop goes idle, so that clients
+ * get one PropertiesChanged signal per interface, rather than one per
+ * property. Values that didn't change since the last emission are dropped.
+ */
+
+struct _GvPropertyBatch {
+	GHashTable *pending;
+	GHashTable *emitted;
+};
+
+typedef struct _GvPropertyBatch GvPropertyBatch;
+
+static GvPropertyBatch *
+gv_property_batch_new(void)
+{
+	GvPropertyBatch *batch;
+
+	batch = g_new0(GvPropertyBatch, 1);
+	batch->pending = g_hash_table_new_full(g_str_hash, g_str_equal,
+	                                       g_free, (GDestroyNotify) g_variant_unref);
+	batch->emitted = g_hash_table_new_full(g_str_hash, g_str_equal,
+	                                       g_free, (GDestroyNotify) g_variant_unref);
+
+	return batch;
+}
+
+static void
+gv_property_batch_free(GvPropertyBatch *batch)
+{
+	if (batch == NULL)
+		return;
+
+	g_hash_table_destroy(batch->pending);
+	g_hash_table_destroy(batch->emitted);
+	g_free(batch);
+}
+
+static void
+gv_dbus_server_flush_batch(GvDbusServer *self, const gchar *interface_name,
+                           GvPropertyBatch *batch)
+{
+	GHashTableIter iter;
+	GVariantBuilder b;
+	gpointer key, value;
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
+
+	g_hash_table_iter_init(&iter, batch->pending);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		g_variant_builder_add(&b, "{sv}", key, value);
+		g_hash_table_iter_steal(&iter);
+		g_hash_table_replace(batch->emitted, key, value);
+	}
+
+	GVariant *tuples[] = {
+		g_variant_new_string(interface_name),
+		g_variant_builder_end(&b),
+		g_variant_new_strv(NULL, 0)
+	};
+
+	gv_dbus_server_emit_signal(self, "org.freedesktop.DBus.Properties",
+	                           "PropertiesChanged", g_variant_new_tuple(tuples, 3));
+}
+
+static gboolean
+when_idle_flush_batches(gpointer data)
+{
+	GvDbusServer *self = GV_DBUS_SERVER(data);
+	GvDbusServerPrivate *priv = gv_dbus_server_get_instance_private(self);
+	GHashTableIter iter;
+	gpointer key, value;
+
+	priv->flush_batches_source_id = 0;
+
+	g_hash_table_iter_init(&iter, priv->batches);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		GvPropertyBatch *batch = value;
+
+		if (g_hash_table_size(batch->pending) == 0)
+			continue;
+
+		gv_dbus_server_flush_batch(self, key, batch);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gv_dbus_server_clear_batches(GvDbusServer *self)
+{
+	GvDbusServerPrivate *priv = gv_dbus_server_get_instance_private(self);
+
+	g_clear_handle_id(&priv->flush_batches_source_id, g_source_remove);
+	g_hash_table_remove_all(priv->batches);
+}
+
 /*
  * Private methods
  */
@@ -557,6 +654,34 @@ gv_dbus_server_set_property(GObject      *object,
  * Public methods
  */
 
+/* Return from a method call, either with an error, or with a value that
+ * might be NULL. Both the value and the error are consumed. For a method
+ * that has several out args, the value must be a tuple of these args.
+ */
+void
+gv_dbus_server_return_method_call(GDBusMethodInvocation *invocation,
+                                  GVariant *value, GError *err)
+{
+	const GDBusMethodInfo *info;
+
+	/* Return with error if any */
+	if (err) {
+		g_dbus_method_invocation_return_gerror(invocation, err);
+		g_error_free(err);
+		return;
+	}
+
+	/* Return value if any */
+	info = g_dbus_method_invocation_get_method_info(invocation);
+	if (value == NULL)
+		g_dbus_method_invocation_return_value(invocation, NULL);
+	else if (info && info->out_args && info->out_args[0] && info->out_args[1])
+		g_dbus_method_invocation_return_value(invocation, value);
+	else
+		g_dbus_method_invocation_return_value(invocation,
+		                                      g_variant_new_tuple(&value, 1));
+}
+
 void
 gv_dbus_server_emit_signal(GvDbusServer *self, const gchar *interface_name,
                            const gchar *signal_name, GVariant *parameters)
@@ -585,19 +710,39 @@ void
 gv_dbus_server_emit_signal_property_changed(GvDbusServer *self, const gchar *interface_name,
                 const gchar *property_name, GVariant *value)
 {
-	GVariantBuilder b;
+	GvDbusServerPrivate *priv = gv_dbus_server_get_instance_private(self);
+	GvPropertyBatch *batch;
+	GVariant *emitted;
 
-	g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
-	g_variant_builder_add(&b, "{sv}", property_name, value);
+	g_variant_ref_sink(value);
 
-	GVariant *tuples[] = {
-		g_variant_new_string(interface_name),
-		g_variant_builder_end(&b),
-		g_variant_new_strv(NULL, 0)
-	};
+	/* No connection, nobody to tell */
+	if (priv->bus_connection == NULL)
+		goto out;
 
-	gv_dbus_server_emit_signal(self, "org.freedesktop.DBus.Properties",
-	                           "PropertiesChanged", g_variant_new_tuple(tuples, 3));
+	batch = g_hash_table_lookup(priv->batches, interface_name);
+	if (batch == NULL) {
+		batch = gv_property_batch_new();
+		g_hash_table_insert(priv->batches, g_strdup(interface_name), batch);
+	}
+
+	/* Back to the value that clients already know? Then there's nothing
+	 * to send, and whatever was pending for this property is obsolete.
+	 */
+	emitted = g_hash_table_lookup(batch->emitted, property_name);
+	if (emitted && g_variant_equal(emitted, value)) {
+		g_hash_table_remove(batch->pending, property_name);
+		goto out;
+	}
+
+	g_hash_table_replace(batch->pending, g_strdup(property_name),
+	                     g_variant_ref(value));
+
+	if (priv->flush_batches_source_id == 0)
+		priv->flush_batches_source_id = g_idle_add(when_idle_flush_batches, self);
+
+out:
+	g_variant_unref(value);
 }
 
 GvDbusServer *
@@ -616,6 +761,9 @@ gv_dbus_server_disable(GvFeature *feature)
 	GvDbusServer *self = GV_DBUS_SERVER(feature);
 	GvDbusServerPrivate *priv = gv_dbus_server_get_instance_private(self);
 
+	/* Drop property changes, clients will have to ask again anyway */
+	gv_dbus_server_clear_batches(self);
+
 	/* Unref DBus connection & objects registered */
 	if (priv->bus_connection != NULL) {
 		gv_dbus_server_unregister_objects(self);
@@ -681,6 +829,10 @@ gv_dbus_server_finalize(GObject *object)
 
 	TRACE("%p", object);
 
+	/* Free property batches */
+	gv_dbus_server_clear_batches(self);
+	g_hash_table_destroy(priv->batches);
+
 	/* Unref introspection data */
 	if (priv->introspection_data != NULL)
 		g_dbus_node_info_unref(priv->introspection_data);
@@ -722,7 +874,13 @@ gv_dbus_server_constructed(GObject *object)
 static void
 gv_dbus_server_init(GvDbusServer *self)
 {
+	GvDbusServerPrivate *priv = gv_dbus_server_get_instance_private(self);
+
 	TRACE("%p", self);
+
+	/* Initialize property batches */
+	priv->batches = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+	                                      (GDestroyNotify) gv_property_batch_free);
 }
 
 static void
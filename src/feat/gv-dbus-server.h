@@ -22,6 +22,7 @@
 #pragma once
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include "base/gv-feature.h"
 
@@ -39,12 +40,18 @@ struct _GvDbusServerClass {
 };
 
 typedef GVariant *(*GvDbusMethodCall)  (GvDbusServer *, GVariant *, GError **);
+typedef void      (*GvDbusMethodCallAsync) (GvDbusServer *, GVariant *,
+                                          GDBusMethodInvocation *);
 typedef GVariant *(*GvDbusPropertyGet) (GvDbusServer *);
 typedef gboolean  (*GvDbusPropertySet) (GvDbusServer *, GVariant *, GError **);
 
+/* A method either returns right away, or is asynchronous. In the latter
+ * case, it must return later with gv_dbus_server_return_method_call().
+ */
 struct _GvDbusMethod {
-	const gchar             *name;
-	const GvDbusMethodCall  call;
+	const gchar                 *name;
+	const GvDbusMethodCall       call;
+	const GvDbusMethodCallAsync  call_async;
 };
 
 typedef struct _GvDbusMethod GvDbusMethod;
@@ -69,6 +76,10 @@ typedef struct _GvDbusInterface GvDbusInterface;
 
 GvDbusServer *gv_dbus_server_new(void);
 
+void gv_dbus_server_return_method_call(GDBusMethodInvocation *invocation,
+                                      GVariant *value,
+                                      GError *err);
+
 void gv_dbus_server_emit_signal(GvDbusServer *self,
                                 const gchar *interface_name,
                                 const gchar *signal_name,
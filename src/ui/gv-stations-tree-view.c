@@ -51,7 +51,7 @@ struct _GvStationsTreeViewPrivate {
 	GtkWidget *context_menu;
 	/* Dragging operation in progress */
 	gboolean is_dragging;
-	GvStation *station_dragged;
+	gchar *station_uid_dragged;
 	gint station_new_pos;
 };
 
@@ -71,7 +71,7 @@ G_DEFINE_TYPE_WITH_PRIVATE(GvStationsTreeView, gv_stations_tree_view, GTK_TYPE_T
  */
 
 enum {
-	STATION_COLUMN,
+	STATION_UID_COLUMN,
 	STATION_NAME_COLUMN,
 	STATION_WEIGHT_COLUMN,
 	STATION_STYLE_COLUMN,
@@ -90,21 +90,22 @@ on_player_notify_station(GvPlayer           *player,
 	GtkTreeView *tree_view = GTK_TREE_VIEW(self);
 	GtkTreeModel *tree_model = gtk_tree_view_get_model(tree_view);
 	GvStation *station = gv_player_get_station(player);
+	const gchar *station_uid = station ? gv_station_get_uid(station) : NULL;
 	GtkTreeIter iter;
 	gboolean can_iter;
 
 	can_iter = gtk_tree_model_get_iter_first(tree_model, &iter);
 
 	while (can_iter) {
-		GvStation *iter_station;
+		gchar *iter_station_uid;
 
-		/* Get station from model */
+		/* Get station uid from model */
 		gtk_tree_model_get(tree_model, &iter,
-		                   STATION_COLUMN, &iter_station,
+		                   STATION_UID_COLUMN, &iter_station_uid,
 		                   -1);
 
 		/* Make the current station bold */
-		if (station == iter_station)
+		if (station_uid && !g_strcmp0(station_uid, iter_station_uid))
 			gtk_list_store_set(GTK_LIST_STORE(tree_model), &iter,
 			                   STATION_WEIGHT_COLUMN, PANGO_WEIGHT_BOLD,
 			                   -1);
@@ -113,9 +114,8 @@ on_player_notify_station(GvPlayer           *player,
 			                   STATION_WEIGHT_COLUMN, PANGO_WEIGHT_NORMAL,
 			                   -1);
 
-		/* Unref the station */
-		if (iter_station)
-			g_object_unref(iter_station);
+		/* Free the uid */
+		g_free(iter_station_uid);
 
 		/* Next! */
 		can_iter = gtk_tree_model_iter_next(tree_model, &iter);
@@ -147,12 +147,23 @@ on_station_list_station_event(GvStationList *station_list,
 	gv_stations_tree_view_populate(self);
 }
 
+static void
+on_station_list_changed(GvStationList      *station_list,
+                        GvStationListDiff  *diff G_GNUC_UNUSED,
+                        GvStationsTreeView *self)
+{
+	TRACE("%p, %p", station_list, self);
+
+	gv_stations_tree_view_populate(self);
+}
+
 static GSignalHandler station_list_handlers[] = {
 	{ "loaded",           G_CALLBACK(on_station_list_loaded)        },
 	{ "station-added",    G_CALLBACK(on_station_list_station_event) },
 	{ "station-removed",  G_CALLBACK(on_station_list_station_event) },
 	{ "station-modified", G_CALLBACK(on_station_list_station_event) },
 	{ "station-moved",    G_CALLBACK(on_station_list_station_event) },
+	{ "changed",          G_CALLBACK(on_station_list_changed)       },
 	{ NULL,               NULL                                      }
 };
 
@@ -174,12 +185,16 @@ on_tree_view_row_activated(GvStationsTreeView *self,
 	GtkTreeModel *tree_model = gtk_tree_view_get_model(tree_view);
 	GtkTreeIter iter;
 	GvStation *station;
+	gchar *station_uid;
 
 	/* Get station from model */
 	gtk_tree_model_get_iter(tree_model, &iter, path);
 	gtk_tree_model_get(tree_model, &iter,
-	                   STATION_COLUMN, &station,
+	                   STATION_UID_COLUMN, &station_uid,
 	                   -1);
+	station = station_uid ?
+	          gv_station_list_find_by_uid(gv_core_station_list, station_uid) : NULL;
+	g_free(station_uid);
 
 	/* Play station */
 	if (station) {
@@ -187,7 +202,6 @@ on_tree_view_row_activated(GvStationsTreeView *self,
 
 		gv_player_set_station(player, station);
 		gv_player_play(player);
-		g_object_unref(station);
 	}
 
 	DEBUG("Row activated");
@@ -200,9 +214,11 @@ when_idle_tree_view_row_activated(GvStationsTreeView *self)
 	GtkTreeView *tree_view = GTK_TREE_VIEW(self);
 	GtkTreeSelection *tree_selection = gtk_tree_view_get_selection(tree_view);
 	GtkTreeModel *tree_model = gtk_tree_view_get_model(tree_view);
+	GvStationList *station_list = gv_core_station_list;
 	GvPlayer *player = gv_core_player;
 	GtkTreeIter iter;
 	GvStation *station;
+	gchar *station_uid;
 
 	/* Check if a drag operation is in progress */
 	if (priv->is_dragging) {
@@ -210,13 +226,20 @@ when_idle_tree_view_row_activated(GvStationsTreeView *self)
 		return FALSE;
 	}
 
-	/* Get station */
+	/* Get station uid */
 	gtk_tree_selection_get_selected(tree_selection, &tree_model, &iter);
 	gtk_tree_model_get(tree_model, &iter,
-	                   STATION_COLUMN, &station,
+	                   STATION_UID_COLUMN, &station_uid,
 	                   -1);
 
-	/* Station might be NULL if the station list is empty */
+	/* Uid might be NULL if the station list is empty */
+	if (station_uid == NULL)
+		return FALSE;
+
+	/* Get station, it's created on demand by the station list */
+	station = gv_station_list_find_by_uid(station_list, station_uid);
+	g_free(station_uid);
+
 	if (station == NULL)
 		return FALSE;
 
@@ -224,9 +247,6 @@ when_idle_tree_view_row_activated(GvStationsTreeView *self)
 	gv_player_set_station(player, station);
 	gv_player_play(player);
 
-	/* Cleanup */
-	g_object_unref(station);
-
 	return FALSE;
 }
 
@@ -287,6 +307,7 @@ on_tree_view_button_press_event(GvStationsTreeView *self,
 	GtkTreeModel *tree_model = gtk_tree_view_get_model(tree_view);
 	GtkTreePath *path;
 	GvStation *station;
+	gchar *station_uid;
 	GtkWidget *context_menu;
 
 	DEBUG("Button pressed: %d", event->button);
@@ -322,14 +343,16 @@ on_tree_view_button_press_event(GvStationsTreeView *self,
 		GtkTreeIter iter;
 		gtk_tree_model_get_iter(tree_model, &iter, path);
 		gtk_tree_model_get(tree_model, &iter,
-		                   STATION_COLUMN, &station,
+		                   STATION_UID_COLUMN, &station_uid,
 		                   -1);
+		if (station_uid)
+			station = gv_station_list_find_by_uid(gv_core_station_list, station_uid);
+		g_free(station_uid);
 	}
 
 	/* Create the context menu */
 	if (station) {
 		context_menu = gv_station_context_menu_new_with_station(station);
-		g_object_unref(station);
 	} else {
 		context_menu = gv_station_context_menu_new();
 	}
@@ -435,7 +458,7 @@ on_list_store_row_inserted(GtkTreeModel        *tree_model G_GNUC_UNUSED,
 	}
 
 	/* We expect a clean status */
-	if (priv->station_dragged != NULL || priv->station_new_pos != -1) {
+	if (priv->station_uid_dragged != NULL || priv->station_new_pos != -1) {
 		WARNING("Current state is not clean, ignoring");
 		return;
 	}
@@ -455,7 +478,7 @@ on_list_store_row_changed(GtkTreeModel        *tree_model,
                           GvStationsTreeView *self)
 {
 	GvStationsTreeViewPrivate *priv = self->priv;
-	GvStation *station;
+	gchar *station_uid;
 	gint *indices;
 	gint position;
 
@@ -474,16 +497,13 @@ on_list_store_row_changed(GtkTreeModel        *tree_model,
 		return;
 	}
 
-	/* Get station */
+	/* Get station uid, and save it */
 	gtk_tree_model_get(tree_model, iter,
-	                   STATION_COLUMN, &station,
+	                   STATION_UID_COLUMN, &station_uid,
 	                   -1);
 
-	/* Save it */
-	priv->station_dragged = station;
-
-	/* Freedom for the braves */
-	g_object_unref(station);
+	g_free(priv->station_uid_dragged);
+	priv->station_uid_dragged = station_uid;
 
 	DEBUG("Row changed at %d", position);
 }
@@ -501,21 +521,26 @@ on_list_store_row_deleted(GtkTreeModel        *tree_model G_GNUC_UNUSED,
 	guint indice_inserted;
 
 	/* End of drag operation, let's commit that to station list */
-	station = priv->station_dragged;
-	if (station == NULL) {
+	if (priv->station_uid_dragged == NULL) {
 		WARNING("Station dragged is null, wtf?");
 		return;
 	}
 
+	station = gv_station_list_find_by_uid(station_list, priv->station_uid_dragged);
+
 	/* Move station in the station list */
 	indice_inserted = priv->station_new_pos;
-	g_signal_handlers_block(station_list, station_list_handlers, self);
-	gv_station_list_move(station_list, station, indice_inserted);
-	g_signal_handlers_unblock(station_list, station_list_handlers, self);
-	DEBUG("Row deleted, station moved at %d", indice_inserted);
+	if (station) {
+		g_signal_handlers_block(station_list, station_list_handlers, self);
+		gv_station_list_move(station_list, station, indice_inserted);
+		g_signal_handlers_unblock(station_list, station_list_handlers, self);
+		DEBUG("Row deleted, station moved at %d", indice_inserted);
+	} else {
+		WARNING("Station dragged is no longer in the list");
+	}
 
 	/* Clean status */
-	priv->station_dragged = NULL;
+	g_clear_pointer(&priv->station_uid_dragged, g_free);
 	priv->station_new_pos = -1;
 
 	/* Reset selection, as GTK doesn't do it itself, hence the column that
@@ -596,7 +621,7 @@ gv_stations_tree_view_populate(GvStationsTreeView *self)
 		/* Populate */
 		gtk_list_store_append(list_store, &tree_iter);
 		gtk_list_store_set(list_store, &tree_iter,
-		                   STATION_COLUMN, NULL,
+		                   STATION_UID_COLUMN, NULL,
 		                   STATION_NAME_COLUMN, "Right click to add station",
 		                   STATION_WEIGHT_COLUMN, PANGO_WEIGHT_NORMAL,
 		                   STATION_STYLE_COLUMN, PANGO_STYLE_ITALIC,
@@ -608,28 +633,30 @@ gv_stations_tree_view_populate(GvStationsTreeView *self)
 
 	} else {
 		GvStation *current_station = gv_player_get_station(player);
-		GvStation *station;
+		const gchar *current_uid;
+		const gchar *uid, *name, *uri;
 		GvStationListIter *iter;
 
-		/* Populate menu with every station */
+		current_uid = current_station ? gv_station_get_uid(current_station) : NULL;
+
+		/* Populate menu with every station. Only the station data is
+		 * needed, stations are created when the user picks one.
+		 */
 		iter = gv_station_list_iter_new(station_list);
 
-		while (gv_station_list_iter_loop(iter, &station)) {
+		while (gv_station_list_iter_loop_data(iter, &uid, &name, &uri)) {
 			GtkTreeIter tree_iter;
-			const gchar *station_name;
 			PangoWeight weight;
 
-			station_name = gv_station_get_name_or_uri(station);
-
-			if (station == current_station)
+			if (current_uid && !g_strcmp0(uid, current_uid))
 				weight = PANGO_WEIGHT_BOLD;
 			else
 				weight = PANGO_WEIGHT_NORMAL;
 
 			gtk_list_store_append(list_store, &tree_iter);
 			gtk_list_store_set(list_store, &tree_iter,
-			                   STATION_COLUMN, station,
-			                   STATION_NAME_COLUMN, station_name,
+			                   STATION_UID_COLUMN, uid,
+			                   STATION_NAME_COLUMN, name ? name : uri,
 			                   STATION_WEIGHT_COLUMN, weight,
 			                   STATION_STYLE_COLUMN, PANGO_STYLE_NORMAL,
 			                   -1);
@@ -666,6 +693,21 @@ gv_stations_tree_view_new(void)
  * GObject methods
  */
 
+static void
+gv_stations_tree_view_finalize(GObject *object)
+{
+	GvStationsTreeView *self = GV_STATIONS_TREE_VIEW(object);
+	GvStationsTreeViewPrivate *priv = self->priv;
+
+	TRACE("%p", object);
+
+	/* Free resources */
+	g_free(priv->station_uid_dragged);
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_FINALIZE(gv_stations_tree_view, object);
+}
+
 static void
 gv_stations_tree_view_constructed(GObject *object)
 {
@@ -700,7 +742,7 @@ gv_stations_tree_view_constructed(GObject *object)
 
 	/*
 	 * Create the stations list store. It has 4 columns:
-	 * - the station object
+	 * - the station uid
 	 * - the station represented by a string (for displaying)
 	 * - the station's font weight (bold characters for current station)
 	 * - the station's font style (italic characters if no station)
@@ -708,7 +750,7 @@ gv_stations_tree_view_constructed(GObject *object)
 
 	/* Create a new list store */
 	GtkListStore *list_store;
-	list_store = gtk_list_store_new(4, G_TYPE_OBJECT, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_UINT);
+	list_store = gtk_list_store_new(4, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_UINT, G_TYPE_UINT);
 
 	/* Associate it with the tree view */
 	gtk_tree_view_set_model(tree_view, GTK_TREE_MODEL(list_store));
@@ -795,6 +837,7 @@ gv_stations_tree_view_class_init(GvStationsTreeViewClass *class)
 	TRACE("%p", class);
 
 	/* Override GObject methods */
+	object_class->finalize = gv_stations_tree_view_finalize;
 	object_class->constructed = gv_stations_tree_view_constructed;
 
 	/* Signals */